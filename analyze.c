@@ -9,6 +9,8 @@
 #include "globals.h"
 #include "symtab.h"
 #include "analyze.h"
+#include "util.h"
+#include "incr.h"
 
 /* counter for variable memory locations */
 static int location = 0;
@@ -23,6 +25,10 @@ static void deleteProc(TreeNode *t) {
   }
 }
 
+static void finish( TreeNode * t,
+		    void (* preProc) (TreeNode *),
+		    void (* postProc) (TreeNode *) );
+
 /* Procedure traverse is a generic recursive 
  * syntax tree traversal routine:
  * it applies preProc in preorder and postProc 
@@ -36,33 +42,41 @@ static void traverse( TreeNode * t,
     { 
       if (t->scope > depth) depth = t->scope;
       if (t->nodekind == StmtK) {
-	if (t->kind.stmt == IfK || t->kind.stmt == WhileK || t->kind.stmt == CompoundK)
+	if (t->kind == IfK || t->kind == WhileK || t->kind == CompoundK)
 	  location = 0;
       }
       preProc(t);
-      { int i;
-	for (i=0; i < MAXCHILDREN; i++) {
-	  if (t->child[i] == NULL) continue;
-	  if ( t->nodekind == StmtK && t->kind.stmt == CompoundK) {
-	    t->child[i]->scope = t->scope + 1;
-	  } 
-	  else if(t->nodekind == DeclK && t->kind.decl == funK){
-	    t->child[1]->scope = t->scope+1;
-	    return_type = t->child[0]->type;
-	  }
-	  else {
-	    t->child[i]->scope = t->scope;
-	  }
-	  traverse(t->child[i],preProc,postProc);
-	}
-      }
-      deleteProc(t);
-      postProc(t);
+      finish(t,preProc,postProc);
       if (t->sibling != NULL) t->sibling->scope = t->scope;
       traverse(t->sibling, preProc, postProc);
     }
 }
 
+/* Procedure finish traverses the children of t and
+ * applies postProc to t
+ */
+static void finish( TreeNode * t,
+		    void (* preProc) (TreeNode *),
+		    void (* postProc) (TreeNode *) )
+{ int i;
+  for (i=0; i < MAXCHILDREN; i++) {
+    if (t->child[i] == NULL) continue;
+    if ( t->nodekind == StmtK && t->kind == CompoundK) {
+      t->child[i]->scope = t->scope + 1;
+    } 
+    else if(t->nodekind == DeclK && t->kind == funK){
+      t->child[1]->scope = t->scope+1;
+      return_type = t->child[0]->type;
+    }
+    else {
+      t->child[i]->scope = t->scope;
+    }
+    traverse(t->child[i],preProc,postProc);
+  }
+  deleteProc(t);
+  postProc(t);
+}
+
 /* Procedure insertNode inserts 
  * identifiers stored in t into 
  * the symbol table 
@@ -71,10 +85,14 @@ static void insertNode( TreeNode * t)
 { switch (t->nodekind)
     {
     case ExpK:
-      switch (t->kind.exp)
+      switch (t->kind)
 	{ case IdK:
-	    if (st_lookup(t->attr.name) == -1)
-	      printf("Id wasn't declared.\n");
+	    /* its decl stays NULL, which nothing after the
+	     * analysis can take */
+	    if (st_lookup(t->attr.name) == -1) {
+	      fprintf(listing,"Id wasn't declared.\n");
+	      Error = TRUE;
+	    }
 	    else
 	      st_insert(t, 0, 0);
 	    break;
@@ -83,11 +101,12 @@ static void insertNode( TreeNode * t)
 	}
       break;
     case DeclK:
-      if (t->array_size >= 0) { // if variable is not void
+      if (arraySize(t) >= 0) { // if variable is not void
 	if (st_advanced_lookup(t->attr.name, t->scope) == -1) {
 	  st_insert(t, location++, 1);
 	} else {
-	  printf("Declation Error %s\n",t->attr.name); location--;
+	  fprintf(listing,"Declation Error %s\n",t->attr.name); location--;
+	  Error = TRUE;
 	}
       }
       break;
@@ -97,7 +116,9 @@ static void insertNode( TreeNode * t)
 }
 
 static void typeError(TreeNode * t, char * message)
-{ fprintf(listing,"Type error at line %d: %s\n",t->lineno,message);
+{ fprintf(listing,"Type error at line ");
+  listLine(t->lineno,0);
+  fprintf(listing,": %s\n",message);
   Error = TRUE;
 }
 
@@ -114,7 +135,7 @@ static void checkNode(TreeNode * t)
   switch (t->nodekind)
     {
     case DeclK:
-      switch (t->kind.decl){
+      switch (t->kind){
       case varK:
 	if(t->child[0] != NULL){
 	  if(t->child[0]->type == Integer){
@@ -152,22 +173,23 @@ static void checkNode(TreeNode * t)
 	}
 	break;
       case paramK:
-	if(t->array_size != -1){
+	if(arraySize(t) != -1){
 	  t->type = t->child[0]->type;
 	}
 	break;
       }
       break;
     case ExpK:
-      switch (t->kind.exp)
+      switch (t->kind)
 	{
 	case IdK:
 	  l = st_type_lookup (t->attr.name);
 	  if (l == NULL) break;
-	  if ( l->tnode_p->array_size > 0 ) { // should be array
+	  t->decl = l->tnode_p;
+	  if ( arraySize(l->tnode_p) > 0 ) { // should be array
 	    /* can't compare 't->array_size == 0' because t can be used for array pointer */
-	    if (t->array_size > 0) {
-	      if(t->child[0]->nodekind == ExpK && t->child[0]->kind.exp == ConstK){
+	    if (arraySize(t) > 0) {
+	      if(t->child[0]->nodekind == ExpK && t->child[0]->kind == ConstK){
 		if(t->child[0]->attr.val < 0){
 		  typeError(t,"Negative Subscript Error");
 		}
@@ -176,8 +198,8 @@ static void checkNode(TreeNode * t)
 		typeError(t,"Array Index Type Error");
 	      }
 	    }
-	  } else if ( l->tnode_p->array_size == 0) { // should be var
-	    if (t->array_size > 0) {
+	  } else if ( arraySize(l->tnode_p) == 0) { // should be var
+	    if (arraySize(t) > 0) {
 	      typeError(t,"Wrong type!");
 	    }
 	  }
@@ -194,7 +216,7 @@ static void checkNode(TreeNode * t)
 	}
       break;
     case StmtK:
-      switch (t->kind.stmt)
+      switch (t->kind)
 	{
 	case IfK:
 	  if(t->child[0]->attr.val != 0 && t->child[0]->attr.val != 1){
@@ -204,7 +226,7 @@ static void checkNode(TreeNode * t)
 	case AssignK:
 	  l = r = NULL;
 	  l = st_type_lookup(t->child[0]->attr.name);
-	  if(t->child[1]->kind.exp == IdK){
+	  if(t->child[1]->kind == IdK){
 	    r = st_type_lookup(t->child[1]->attr.name);
 	  }
 	  if(l == NULL){
@@ -212,7 +234,7 @@ static void checkNode(TreeNode * t)
 	  } else {
 	    if (l->tnode_p->type != Integer) {
 	      typeError(t->child[0],"not integer");
-	    } else if (l->tnode_p->array_size > 0 && t->child[0]->array_size == 0) {
+	    } else if (arraySize(l->tnode_p) > 0 && arraySize(t->child[0]) == 0) {
 	      typeError(t,"L is array but using without []");
 	    }
 	  }
@@ -224,8 +246,8 @@ static void checkNode(TreeNode * t)
 	    if (r->tnode_p->type != Integer) {
 	      typeError(t->child[1],"not integer");
 	    }
-	    if(t->child[1]->nodekind == ExpK && t->child[1]->kind.exp == IdK){//var = var
-	      if(r->tnode_p->array_size > 0 && t->child[1]->array_size == 0){
+	    if(t->child[1]->nodekind == ExpK && t->child[1]->kind == IdK){//var = var
+	      if(arraySize(r->tnode_p) > 0 && arraySize(t->child[1]) == 0){
 		typeError(t,"R is array but using without []");
 	      }
 	    }
@@ -249,14 +271,14 @@ static void checkNode(TreeNode * t)
 	  else{//data return
 	    if (return_type == Void)
 	      typeError(t,"Function has return value, but the function is void type");
-	    if(t->child[0]->kind.stmt == CallK) {
+	    if(t->child[0]->kind == CallK) {
 	      l = st_type_lookup(t->child[0]->attr.name);
 	      if(l != NULL && l->tnode_p->type != Integer){
 	    	typeError(t,"return type error");
 	      }
-	    } else if (t->child[0]->kind.exp == IdK) {
+	    } else if (t->child[0]->kind == IdK) {
 	      l = st_type_lookup(t->child[0]->attr.name);
-	      if (l->tnode_p->array_size > 0 && t->child[0]->array_size == 0) {
+	      if (l != NULL && arraySize(l->tnode_p) > 0 && arraySize(t->child[0]) == 0) {
 	    	typeError(t,"return type error");
 	      } // case : return array
 	    } else{
@@ -274,13 +296,14 @@ static void checkNode(TreeNode * t)
 	  }
 	  else{
 	    t->type = l->tnode_p->type;
-	    if(l->tnode_p->paramnum == -1){//is not function name
+	    t->decl = l->tnode_p;
+	    if(paramNum(l->tnode_p) == -1){//is not function name
 	      typeError(t,"is not function name");
 	    }
 	    else{
 	      i=0;
 	      if(t->child[0] == NULL){//no argument
-		if(l->tnode_p->paramnum != 0){
+		if(paramNum(l->tnode_p) != 0){
 		  typeError(t,"arguments not match");
 		}
 	      }
@@ -290,7 +313,7 @@ static void checkNode(TreeNode * t)
 		  i++;
 		  s = s->sibling;
 		}
-		if(l->tnode_p->paramnum == i){
+		if(paramNum(l->tnode_p) == i){
 		  s = t->child[0];
 		  p = l->tnode_p->child[1];
 
@@ -298,15 +321,16 @@ static void checkNode(TreeNode * t)
 		    if(s->type != p->type){
 		      typeError(s,"argument type is not matched");
 		    }
-		    if (s->nodekind == ExpK && s->kind.exp == IdK) {
+		    if (s->nodekind == ExpK && s->kind == IdK &&
+			st_type_lookup(s->attr.name) != NULL) { // undeclared: reported already
 		      BucketList tmp = st_type_lookup(s->attr.name);
-		      if (p->array_size == 0) { // should be var
-			if (tmp->tnode_p->array_size > 0 && s->array_size == 0) {
+		      if (arraySize(p) == 0) { // should be var
+			if (arraySize(tmp->tnode_p) > 0 && arraySize(s) == 0) {
 			  typeError(s,"argument type is not matched(array to var)");
 			}
-		      } else if (p->array_size > 0) { // should be array pointer
-			if ( tmp->tnode_p->array_size == 0 ||
-			     (tmp->tnode_p->array_size > 0 && s->array_size > 0) )
+		      } else if (arraySize(p) > 0) { // should be array pointer
+			if ( arraySize(tmp->tnode_p) == 0 ||
+			     (arraySize(tmp->tnode_p) > 0 && arraySize(s) > 0) )
 			  typeError(s,"argument type is not matched(var to array)");
 		      }
 		    }
@@ -329,18 +353,162 @@ static void checkNode(TreeNode * t)
 
     }
 }
-/* Function buildSymtab constructs the symbol 
- * table by preorder traversal of the syntax tree
+/* Function builtinFun makes the declaration of a
+ * predefined function; it lives below the global
+ * scope so it is never listed or deleted
  */
-void buildSymtab(TreeNode * syntaxTree)
-{ 
-  syntaxTree->scope = 0;
+static TreeNode * builtinFun(char * name, ExpType type, int hasParam)
+{ TreeNode * t = newDeclNode(funK);
+  TreeNode * p = newDeclNode(paramK);
+  t->attr.name = name;
+  t->child[0] = newExpNode(TypeK);
+  t->child[0]->type = type;
+  t->child[1] = p;
+  t->scope = -1;
+  t->flags = F_BUILTIN;
+  if (hasParam) {
+    p->attr.name = "x";
+    p->child[0] = newExpNode(TypeK);
+    p->child[0]->type = Integer;
+    declInfo(p)->array_size = 0;
+    p->type = Integer;
+  } else {
+    declInfo(p)->array_size = -1;
+    p->type = Void;
+  }
+  p->scope = 0;
+  st_insert(t, 0, 1);
+  return t;
+}
+
+/* main as analyzed by analyzeDecl before anything
+ * following it was parsed, for which checkNode could
+ * not tell if it is the last function
+ */
+static TreeNode * mainDecl;
+
+/* Procedure beginSymtab starts the symbol table of
+ * a program and the heading of its listing
+ */
+void beginSymtab(void)
+{ static int builtins = FALSE;
+  if (!builtins) {
+    builtinFun("input", Integer, FALSE);
+    builtinFun("output", Void, TRUE);
+    builtins = TRUE;
+  }
+  location = 0;
+  depth = 0;
+  mainDecl = NULL;
   fprintf(listing,"Scope  Variable Name Location Type isArr ArrSize isFunc isParam Line Numbers\n");
   fprintf(listing,"-----  ------------- -------- ---- ----- ------- ------ ------- ------------\n");
-  traverse(syntaxTree,insertNode,checkNode);
-  if (TraceAnalyze)
+}
+
+/* Procedure analyzeDecl inserts and checks the
+ * top-level declaration t, whose sibling need not be
+ * parsed yet; the locals of a function are listed
+ * and dropped from the table when it is done
+ */
+void analyzeDecl(TreeNode * t)
+{ if (mainDecl != NULL) {
+    typeError(mainDecl,"main is not the last function");
+    mainDecl = NULL;
+  }
+  t->scope = 0;
+  insertNode(t);
+  if (Incremental && t->nodekind == DeclK && t->kind == funK) {
+    /* functions are taken from the cache one by one */
+    if (incrReuse(t,&location)) return;
+    incrBegin(t,location);
+    finish(t,insertNode,checkNode);
+    incrEnd(t,location);
+  }
+  else finish(t,insertNode,checkNode);
+  if (t->nodekind == DeclK && t->kind == funK &&
+      t->sibling == NULL && strcmp(t->attr.name,"main") == 0)
+    mainDecl = t;
+}
+
+/* Procedure endSymtab lists and drops the globals */
+void endSymtab(void)
+{ if (TraceAnalyze)
     { //fprintf(listing,"\nSymbol table:\n\n");
       //printSymTab(listing);
       st_delete(-1);
     }
 }
+
+/* Function buildSymtab constructs the symbol 
+ * table by preorder traversal of the syntax tree
+ */
+void buildSymtab(TreeNode * syntaxTree)
+{ 
+  TreeNode * t;
+  beginSymtab();
+  if (Incremental)
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+      analyzeDecl(t);
+  else {
+    syntaxTree->scope = 0;
+    traverse(syntaxTree,insertNode,checkNode);
+  }
+  endSymtab();
+}
+
+/* Function impureNode returns TRUE if the subtree t
+ * touches a global, calls a builtin or calls a
+ * function not (yet) known to be pure
+ */
+static int impureNode(TreeNode * t)
+{ int i;
+  while (t != NULL) {
+    if (t->nodekind == ExpK && t->kind == IdK) {
+      /* reading a global is as bad as writing one:
+       * the cached result would go stale */
+      if (t->decl == NULL || t->decl->scope == 0) return TRUE;
+    }
+    else if (t->nodekind == StmtK && t->kind == CallK) {
+      if (t->decl == NULL || !(t->decl->flags & F_PURE)) return TRUE;
+    }
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (impureNode(t->child[i])) return TRUE;
+    t = t->sibling;
+  }
+  return FALSE;
+}
+
+/* Procedure findPure sets F_PURE on every function
+ * that has no array parameters, no global accesses,
+ * no I/O and calls only pure functions. Functions
+ * start out pure so that recursion does not block
+ * the proof; impure ones are removed until nothing
+ * changes.
+ */
+void findPure(TreeNode * syntaxTree)
+{ TreeNode * t;
+  TreeNode * p;
+  int changed = TRUE;
+  for (t = syntaxTree; t != NULL; t = t->sibling) {
+    if (t->nodekind != DeclK || t->kind != funK) continue;
+    t->flags |= F_PURE;
+    for (p = t->child[1]; p != NULL; p = p->sibling)
+      if (arraySize(p) > 0) t->flags &= ~F_PURE;
+  }
+  while (changed) {
+    changed = FALSE;
+    for (t = syntaxTree; t != NULL; t = t->sibling) {
+      if (t->nodekind != DeclK || t->kind != funK) continue;
+      if ((t->flags & F_PURE) && impureNode(t->child[2])) {
+        t->flags &= ~F_PURE;
+        changed = TRUE;
+      }
+    }
+  }
+  if (TraceAnalyze) {
+    fprintf(listing,"\nPure functions:");
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+      if (t->nodekind == DeclK && t->kind == funK && (t->flags & F_PURE))
+        fprintf(listing," %s",t->attr.name);
+    fprintf(listing,"\n");
+  }
+}
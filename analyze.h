@@ -13,9 +13,22 @@
  */
 void buildSymtab(TreeNode *);
 
+/* buildSymtab is beginSymtab, analyzeDecl on each
+ * top-level declaration in order, and endSymtab;
+ * a program can so be analyzed as it is parsed
+ */
+void beginSymtab(void);
+void analyzeDecl(TreeNode *);
+void endSymtab(void);
+
 /* Procedure typeCheck performs type checking 
  * by a postorder syntax tree traversal
  */
 void typeCheck(TreeNode *);
 
+/* Procedure findPure marks (F_PURE) the functions
+ * whose result depends on their arguments only
+ */
+void findPure(TreeNode *);
+
 #endif
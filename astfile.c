@@ -0,0 +1,329 @@
+/****************************************************/
+/* File: astfile.c                                  */
+/* Binary syntax tree files for the C- compiler     */
+/* The nodes are numbered in preorder (a node, its  */
+/* children, then its next sibling); declarations   */
+/* outside the tree, the builtin functions, come    */
+/* after them. The same numbering is used to write  */
+/* the file and to check it against the tree.       */
+/****************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "globals.h"
+#include "astfile.h"
+
+/* the numbered nodes */
+static TreeNode ** order = NULL;
+static int norder = 0, maxorder = 0;
+
+/* index of a node, by address */
+static TreeNode ** mapKeys = NULL;
+static int * mapVals = NULL;
+static int mapSize = 0;
+
+/* the symbols: declarations and the nodes referring
+ * to them, as they go into the file
+ */
+static AstSym * syms = NULL;
+static int nsyms = 0;
+static int * refs = NULL;
+static int nrefs = 0;
+static int * symOf = NULL;   /* symbol of a node, or AST_NONE */
+
+/* the string table */
+static char * strtab = NULL;
+static int strsize = 0, maxstr = 0;
+static int * strSlots = NULL;
+static int nstrSlots = 0, nstrs = 0;
+
+/* Function isNamed is TRUE if attr of t holds a name */
+static int isNamed(TreeNode * t)
+{ if (t->nodekind == ExpK) return t->kind == IdK;
+  if (t->nodekind == StmtK) return t->kind == CallK;
+  return t->kind != paramK || arraySize(t) >= 0;
+}
+
+static unsigned mapSlot(TreeNode * t)
+{ return (unsigned) (((unsigned long) t >> 4) * 2654435761u) & (mapSize - 1); }
+
+static void mapPut(TreeNode * t, int k)
+{ unsigned h;
+  for (h = mapSlot(t); mapKeys[h] != NULL; h = (h + 1) & (mapSize - 1))
+    ;
+  mapKeys[h] = t;
+  mapVals[h] = k;
+}
+
+static int mapFind(TreeNode * t)
+{ unsigned h;
+  if (t == NULL) return AST_NONE;
+  for (h = mapSlot(t); mapKeys[h] != NULL; h = (h + 1) & (mapSize - 1))
+    if (mapKeys[h] == t) return mapVals[h];
+  return AST_NONE;
+}
+
+static void addNode(TreeNode * t)
+{ int k;
+  if (norder == maxorder) {
+    maxorder = maxorder ? 2 * maxorder : 1024;
+    order = (TreeNode **) realloc(order, sizeof(TreeNode *) * maxorder);
+  }
+  order[norder++] = t;
+  if (2 * norder > mapSize) {
+    mapSize = mapSize ? 2 * mapSize : 2048;
+    mapKeys = (TreeNode **) realloc(mapKeys, sizeof(TreeNode *) * mapSize);
+    mapVals = (int *) realloc(mapVals, sizeof(int) * mapSize);
+    memset(mapKeys,0,sizeof(TreeNode *) * mapSize);
+    for (k = 0; k < norder; k++) mapPut(order[k],k);
+  }
+  else mapPut(t,norder - 1);
+}
+
+static void number(TreeNode * t)
+{ int i;
+  while (t != NULL) {
+    addNode(t);
+    for (i = 0; i < MAXCHILDREN; i++) number(t->child[i]);
+    t = t->sibling;
+  }
+}
+
+/* Procedure numberTree numbers the nodes of the tree
+ * and of the declarations it refers to
+ */
+static void numberTree(TreeNode * syntaxTree)
+{ int k;
+  norder = 0;
+  if (mapSize > 0) memset(mapKeys,0,sizeof(TreeNode *) * mapSize);
+  number(syntaxTree);
+  for (k = 0; k < norder; k++)
+    if (order[k]->decl != NULL && mapFind(order[k]->decl) == AST_NONE)
+      number(order[k]->decl);
+}
+
+static unsigned long hashName(char * s)
+{ unsigned long h = 14695981039346656037UL;
+  while (*s) h = (h ^ (unsigned char) *s++) * 1099511628211UL;
+  return h;
+}
+
+/* Function addString returns the offset of s in the
+ * string table, adding it once
+ */
+static int addString(char * s)
+{ int n = strlen(s) + 1;
+  int k, off;
+  unsigned h;
+  if (2 * (nstrs + 1) > nstrSlots) {
+    int * old = strSlots;
+    int nold = nstrSlots;
+    nstrSlots = nstrSlots ? 2 * nstrSlots : 1024;
+    strSlots = (int *) malloc(sizeof(int) * nstrSlots);
+    for (k = 0; k < nstrSlots; k++) strSlots[k] = AST_NONE;
+    for (k = 0; k < nold; k++)
+      if (old[k] != AST_NONE) {
+        for (h = hashName(strtab + old[k]) & (nstrSlots - 1); strSlots[h] != AST_NONE;
+             h = (h + 1) & (nstrSlots - 1))
+          ;
+        strSlots[h] = old[k];
+      }
+    free(old);
+  }
+  for (h = hashName(s) & (nstrSlots - 1); (off = strSlots[h]) != AST_NONE;
+       h = (h + 1) & (nstrSlots - 1))
+    if (strcmp(strtab + off,s) == 0) return off;
+  while (strsize + n > maxstr) {
+    maxstr = maxstr ? 2 * maxstr : 4096;
+    strtab = (char *) realloc(strtab, maxstr);
+  }
+  memcpy(strtab + strsize,s,n);
+  strSlots[h] = strsize;
+  nstrs++;
+  strsize += n;
+  return strSlots[h];
+}
+
+/* Procedure collectSyms makes the symbols of the
+ * numbered nodes
+ */
+static void collectSyms(void)
+{ int k, s;
+  symOf = (int *) realloc(symOf, sizeof(int) * (norder + 1));
+  syms = (AstSym *) realloc(syms, sizeof(AstSym) * (norder + 1));
+  refs = (int *) realloc(refs, sizeof(int) * (norder + 1));
+  nsyms = nrefs = 0;
+  for (k = 0; k < norder; k++) {
+    symOf[k] = AST_NONE;
+    if (order[k]->nodekind == DeclK && isNamed(order[k])) {
+      symOf[k] = nsyms;
+      syms[nsyms].name = addString(order[k]->attr.name);
+      syms[nsyms].node = k;
+      syms[nsyms].first = 0;
+      syms[nsyms++].nrefs = 0;
+    }
+  }
+  for (k = 0; k < norder; k++)
+    if (order[k]->decl != NULL && (s = symOf[mapFind(order[k]->decl)]) != AST_NONE)
+      syms[s].nrefs++;
+  for (s = 0; s < nsyms; s++) {
+    syms[s].first = nrefs;
+    nrefs += syms[s].nrefs;
+    syms[s].nrefs = 0;
+  }
+  for (k = 0; k < norder; k++)
+    if (order[k]->decl != NULL && (s = symOf[mapFind(order[k]->decl)]) != AST_NONE)
+      refs[syms[s].first + syms[s].nrefs++] = k;
+}
+
+/* Procedure makeNode fills in the record of node k */
+static void makeNode(AstNode * n, int k)
+{ TreeNode * t = order[k];
+  int i;
+  n->nodekind = t->nodekind;
+  n->kind = t->kind;
+  n->lineno = t->lineno;
+  for (i = 0; i < MAXCHILDREN; i++) n->child[i] = mapFind(t->child[i]);
+  n->sibling = mapFind(t->sibling);
+  n->attr = isNamed(t) ? addString(t->attr.name) : t->attr.val;
+  n->paramnum = paramNum(t);
+  n->array_size = arraySize(t);
+  n->scope = t->scope;
+  n->type = t->type;
+  n->flags = t->flags;
+  n->decl = mapFind(t->decl);
+  n->offset = cellOffset(t);
+}
+
+int writeAst(TreeNode * syntaxTree, char * file)
+{ AstHeader h;
+  AstNode n;
+  FILE * out;
+  int k;
+  numberTree(syntaxTree);
+  strsize = nstrs = 0;
+  for (k = 0; k < nstrSlots; k++) strSlots[k] = AST_NONE;
+  collectSyms();
+  if ((out = fopen(file,"wb")) == NULL) return FALSE;
+  memset(&h,0,sizeof(h));
+  memcpy(h.magic,ASTMAGIC,sizeof(h.magic));
+  h.version = ASTVERSION;
+  h.byteorder = ASTBYTEORDER;
+  h.nnodes = norder;
+  h.root = norder > 0 ? 0 : AST_NONE;
+  h.nsyms = nsyms;
+  h.nrefs = nrefs;
+  h.nodes = sizeof(AstHeader);
+  h.syms = h.nodes + norder * sizeof(AstNode);
+  h.refs = h.syms + nsyms * sizeof(AstSym);
+  h.strings = h.refs + nrefs * sizeof(int);
+  /* the header is written last, once strsize is known */
+  fseek(out,h.nodes,SEEK_SET);
+  for (k = 0; k < norder; k++) {
+    makeNode(&n,k);
+    fwrite(&n,sizeof(n),1,out);
+  }
+  fwrite(syms,sizeof(AstSym),nsyms,out);
+  fwrite(refs,sizeof(int),nrefs,out);
+  fwrite(strtab,1,strsize,out);
+  h.strsize = strsize;
+  rewind(out);
+  fwrite(&h,sizeof(h),1,out);
+  k = ferror(out);
+  return fclose(out) == 0 && ! k;
+}
+
+/* Function inside is TRUE if n records of size bytes
+ * at off lie within a file of size total
+ */
+static int inside(int off, int n, size_t size, size_t total)
+{ return off >= (int) sizeof(AstHeader) && off % sizeof(int) == 0 && n >= 0 &&
+         (size_t) off + (size_t) n * size <= total;
+}
+
+AstFile * mapAst(char * file)
+{ int fd = open(file,O_RDONLY);
+  struct stat st;
+  char * base;
+  AstHeader * h;
+  AstFile * f;
+  if (fd < 0) return NULL;
+  if (fstat(fd,&st) < 0 || st.st_size < (off_t) sizeof(AstHeader)) {
+    close(fd);
+    return NULL;
+  }
+  base = (char *) mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if (base == MAP_FAILED) return NULL;
+  h = (AstHeader *) base;
+  if (memcmp(h->magic,ASTMAGIC,sizeof(h->magic)) != 0 || h->version != ASTVERSION ||
+      h->byteorder != ASTBYTEORDER ||
+      !inside(h->nodes,h->nnodes,sizeof(AstNode),st.st_size) ||
+      !inside(h->syms,h->nsyms,sizeof(AstSym),st.st_size) ||
+      !inside(h->refs,h->nrefs,sizeof(int),st.st_size) ||
+      !inside(h->strings,h->strsize,1,st.st_size) ||
+      (h->strsize > 0 && base[h->strings + h->strsize - 1] != '\0') ||
+      h->root < AST_NONE || h->root >= h->nnodes) {
+    munmap(base,st.st_size);
+    return NULL;
+  }
+  f = (AstFile *) malloc(sizeof(AstFile));
+  f->header = h;
+  f->nodes = (AstNode *) (base + h->nodes);
+  f->syms = (AstSym *) (base + h->syms);
+  f->refs = (int *) (base + h->refs);
+  f->strings = base + h->strings;
+  f->size = st.st_size;
+  return f;
+}
+
+void unmapAst(AstFile * f)
+{ munmap(f->header,f->size);
+  free(f);
+}
+
+AstNode * astNode(AstFile * f, int index)
+{ if (index < 0 || index >= f->header->nnodes) return NULL;
+  return &f->nodes[index];
+}
+
+char * astName(AstFile * f, AstNode * n)
+{ int named;
+  if (n->nodekind == ExpK) named = n->kind == IdK;
+  else if (n->nodekind == StmtK) named = n->kind == CallK;
+  else named = n->kind != paramK || n->array_size >= 0;
+  if (!named || n->attr < 0 || n->attr >= f->header->strsize) return NULL;
+  return f->strings + n->attr;
+}
+
+int checkAst(AstFile * f, TreeNode * syntaxTree)
+{ AstNode n;
+  AstNode * m;
+  char * name;
+  int k;
+  numberTree(syntaxTree);
+  strsize = nstrs = 0;
+  for (k = 0; k < nstrSlots; k++) strSlots[k] = AST_NONE;
+  collectSyms();
+  for (k = 0; k < norder; k++) {
+    if ((m = astNode(f,k)) == NULL) return k;
+    makeNode(&n,k);
+    name = astName(f,m);
+    if (memcmp(&n,m,sizeof(n)) != 0 ||
+        (isNamed(order[k]) && (name == NULL || strcmp(name,order[k]->attr.name) != 0)))
+      return k;
+  }
+  if (f->header->nnodes != norder) return norder;
+  if (f->header->root != (norder > 0 ? 0 : AST_NONE) || f->header->nsyms != nsyms ||
+      f->header->nrefs != nrefs)
+    return 0;
+  for (k = 0; k < nsyms; k++)
+    if (memcmp(&f->syms[k],&syms[k],sizeof(AstSym)) != 0 ||
+        strcmp(f->strings + syms[k].name,order[syms[k].node]->attr.name) != 0)
+      return syms[k].node;
+  for (k = 0; k < nrefs; k++)
+    if (f->refs[k] != refs[k]) return refs[k];
+  return AST_NONE;
+}
@@ -0,0 +1,113 @@
+/****************************************************/
+/* File: astfile.h                                  */
+/* Binary syntax tree files for the C- compiler:    */
+/* the analyzed tree and its symbols, written so    */
+/* that a tool can mmap the file and use it as is   */
+/****************************************************/
+
+#ifndef _ASTFILE_H_
+#define _ASTFILE_H_
+
+/* the file starts with ASTMAGIC and ASTVERSION; a
+ * file of another version is not read
+ */
+#define ASTMAGIC "C-AST\r\n\032"
+#define ASTVERSION 1
+
+/* AST_NONE is the index of a missing node */
+#define AST_NONE (-1)
+
+/* All numbers in the file are 32-bit ints of the
+ * machine that wrote it, so that a file is read in
+ * place. Nodes refer to each other by index and to
+ * names by offset in the string table, never by
+ * address. Section offsets count from the start of
+ * the file
+ */
+typedef struct
+{ char magic[8];
+  int version;
+  int byteorder;   /* ASTBYTEORDER as written */
+  int nnodes;
+  int root;        /* first top-level declaration */
+  int nsyms;
+  int nrefs;
+  int strsize;
+  int nodes, syms, refs, strings;  /* section offsets */
+} AstHeader;
+
+#define ASTBYTEORDER 0x01020304
+
+/* a node in the preorder of the tree, followed by the
+ * declarations of the builtin functions
+ */
+typedef struct
+{ int nodekind;
+  int kind;
+  int lineno;
+  int child[MAXCHILDREN];
+  int sibling;
+  int attr;        /* op or val, or the offset of the name */
+  int paramnum;
+  int array_size;
+  int scope;
+  int type;
+  int flags;
+  int decl;        /* declaration an Id or Call refers to */
+  int offset;
+} AstNode;
+
+/* a declared name, with the nodes referring to it
+ * (refs[first] to refs[first+nrefs-1]), in the order
+ * of the declarations
+ */
+typedef struct
+{ int name;
+  int node;
+  int first;
+  int nrefs;
+} AstSym;
+
+/* a mapped file */
+typedef struct
+{ AstHeader * header;
+  AstNode * nodes;
+  AstSym * syms;
+  int * refs;
+  char * strings;
+  size_t size;
+} AstFile;
+
+/* Function writeAst writes the analyzed syntax tree
+ * to file. It returns FALSE if the file cannot be
+ * written
+ */
+int writeAst(TreeNode * syntaxTree, char * file);
+
+/* Function mapAst maps file into memory. It returns
+ * NULL if the file cannot be read or is not a syntax
+ * tree file of this version and byte order
+ */
+AstFile * mapAst(char * file);
+
+/* Procedure unmapAst releases a mapped file */
+void unmapAst(AstFile * f);
+
+/* Function astNode returns node index of f, or NULL
+ * for AST_NONE
+ */
+AstNode * astNode(AstFile * f, int index);
+
+/* Function astName returns the name held by node n,
+ * or NULL if its attr is not a name
+ */
+char * astName(AstFile * f, AstNode * n);
+
+/* Function checkAst compares f with the tree it was
+ * written from, field by field and link by link. It
+ * returns the index of the first node that differs,
+ * or AST_NONE if they are the same
+ */
+int checkAst(AstFile * f, TreeNode * syntaxTree);
+
+#endif
@@ -0,0 +1,389 @@
+/****************************************************/
+/* File: bounds.c                                   */
+/* Range analysis for the C- compiler              */
+/* Every local scalar gets an interval of values;   */
+/* assignments compute intervals, conditions of if  */
+/* and while narrow them, and loops are iterated to */
+/* a fixed point with widening. Arithmetic that may */
+/* leave the int range gives the full range, since  */
+/* the generated code wraps around.                 */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "bounds.h"
+
+typedef struct
+{ long lo, hi;
+} Range;
+
+/* the environment at a program point: a range per
+ * variable, or dead if the point is unreachable
+ */
+typedef struct
+{ int dead;
+  Range * r;
+} Env;
+
+/* the local scalars of the function analyzed */
+static TreeNode ** vars = NULL;
+static int nvars = 0;
+static int maxvars = 0;
+
+/* marks are set only on the final walk over a loop
+ * body, when the ranges at its head are stable
+ */
+static int marking;
+
+/* checks seen and checks removed */
+static int nchecks, nremoved;
+
+static Range full(void)
+{ Range r;
+  r.lo = INT_MIN;
+  r.hi = INT_MAX;
+  return r;
+}
+
+static Range point(long v)
+{ Range r;
+  r.lo = r.hi = v;
+  return r;
+}
+
+/* Function clamp gives the full range to results
+ * that may have wrapped around
+ */
+static Range clamp(long lo, long hi)
+{ Range r;
+  if (lo < INT_MIN || hi > INT_MAX) return full();
+  r.lo = lo;
+  r.hi = hi;
+  return r;
+}
+
+static long min2(long a, long b) { return a < b ? a : b; }
+static long max2(long a, long b) { return a > b ? a : b; }
+
+static Env newEnv(void)
+{ Env e;
+  int i;
+  e.dead = FALSE;
+  e.r = (Range *) malloc(sizeof(Range) * (nvars + 1));
+  for (i = 0; i < nvars; i++) e.r[i] = full();
+  return e;
+}
+
+static Env copyEnv(Env * from)
+{ Env e;
+  e.dead = from->dead;
+  e.r = (Range *) malloc(sizeof(Range) * (nvars + 1));
+  memcpy(e.r,from->r,sizeof(Range) * nvars);
+  return e;
+}
+
+/* Procedure join makes e the union of e and f */
+static void join(Env * e, Env * f)
+{ int i;
+  if (f->dead) return;
+  if (e->dead) {
+    memcpy(e->r,f->r,sizeof(Range) * nvars);
+    e->dead = FALSE;
+    return;
+  }
+  for (i = 0; i < nvars; i++) {
+    e->r[i].lo = min2(e->r[i].lo,f->r[i].lo);
+    e->r[i].hi = max2(e->r[i].hi,f->r[i].hi);
+  }
+}
+
+/* Function widen extends the bounds of head that
+ * grow in next to the limits, and returns FALSE
+ * when head already contains next
+ */
+static int widen(Env * head, Env * next)
+{ int i, grew = FALSE;
+  if (next->dead) return FALSE;
+  if (head->dead) {
+    join(head,next);
+    return TRUE;
+  }
+  for (i = 0; i < nvars; i++) {
+    if (next->r[i].lo < head->r[i].lo) { head->r[i].lo = INT_MIN; grew = TRUE; }
+    if (next->r[i].hi > head->r[i].hi) { head->r[i].hi = INT_MAX; grew = TRUE; }
+  }
+  return grew;
+}
+
+/* Function varIndex returns the index of the local
+ * scalar declared by d, or -1
+ */
+static int varIndex(TreeNode * d)
+{ int i;
+  if (d == NULL || d->scope == 0 || arraySize(d) != 0) return -1;
+  for (i = 0; i < nvars; i++)
+    if (vars[i] == d) return i;
+  return -1;
+}
+
+static void collectVars(TreeNode * t)
+{ int i;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == DeclK && t->kind != funK && arraySize(t) == 0) {
+      if (nvars == maxvars) {
+        maxvars = maxvars ? 2 * maxvars : 32;
+        vars = (TreeNode **) realloc(vars, sizeof(TreeNode *) * maxvars);
+      }
+      vars[nvars++] = t;
+    }
+    else if (t->nodekind == StmtK)
+      for (i = 0; i < MAXCHILDREN; i++) collectVars(t->child[i]);
+  }
+}
+
+static Range eval(TreeNode * t, Env * e);
+
+static int hasAssign(TreeNode * t)
+{ int i;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == StmtK && t->kind == AssignK) return TRUE;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (hasAssign(t->child[i])) return TRUE;
+  }
+  return FALSE;
+}
+
+/* Procedure subscript evaluates the subscript of
+ * array access t and decides whether its check
+ * can be dropped
+ */
+static void subscript(TreeNode * t, Env * e)
+{ TreeNode * d = t->decl;
+  Range r = eval(t->child[0],e);
+  if (!marking || d->kind != varK) return;
+  nchecks++;
+  if (!e->dead && r.lo >= 0 && r.hi < arraySize(d)) {
+    t->flags |= F_INBOUNDS;
+    nremoved++;
+  }
+  else t->flags &= ~F_INBOUNDS;
+}
+
+static Range arith(TokenType op, Range a, Range b)
+{ long p[4];
+  int i;
+  long lo, hi;
+  switch (op) {
+  case PLUS:
+    return clamp(a.lo + b.lo,a.hi + b.hi);
+  case MINUS:
+    return clamp(a.lo - b.hi,a.hi - b.lo);
+  case MUL:
+    p[0] = a.lo * b.lo; p[1] = a.lo * b.hi;
+    p[2] = a.hi * b.lo; p[3] = a.hi * b.hi;
+    lo = hi = p[0];
+    for (i = 1; i < 4; i++) {
+      lo = min2(lo,p[i]);
+      hi = max2(hi,p[i]);
+    }
+    return clamp(lo,hi);
+  case DIV:
+    /* division truncates, so it is monotone in the
+     * dividend for a positive divisor */
+    if (b.lo > 0)
+      return clamp(min2(a.lo / b.lo,a.lo / b.hi),max2(a.hi / b.lo,a.hi / b.hi));
+    return full();
+  default: /* relational */
+    return clamp(0,1);
+  }
+}
+
+static Range eval(TreeNode * t, Env * e)
+{ Range r;
+  int i;
+  if (t == NULL) return full();
+  if (t->nodekind == StmtK) {
+    if (t->kind == AssignK) {
+      r = eval(t->child[1],e);
+      if (arraySize(t->child[0]) > 0 && t->child[0]->child[0] != NULL)
+        subscript(t->child[0],e);
+      else if ((i = varIndex(t->child[0]->decl)) >= 0) e->r[i] = r;
+      return r;
+    }
+    if (t->kind == CallK) {
+      TreeNode * a;
+      for (a = t->child[0]; a != NULL; a = a->sibling) eval(a,e);
+    }
+    return full();
+  }
+  switch (t->kind) {
+  case ConstK:
+    return point(t->attr.val);
+  case IdK:
+    if (arraySize(t) > 0 && t->child[0] != NULL) {
+      subscript(t,e);
+      return full();
+    }
+    if ((i = varIndex(t->decl)) >= 0) return e->r[i];
+    return full();
+  case CalcK:
+    r = eval(t->child[0],e);
+    return arith(t->child[1]->attr.op,r,eval(t->child[2],e));
+  default:
+    return full();
+  }
+}
+
+/* Procedure refine narrows e to the states where
+ * condition t has truth value sense; e becomes
+ * dead when none remains
+ */
+static void refine(Env * e, TreeNode * t, int sense)
+{ TokenType op;
+  TreeNode * x;
+  Range * v;
+  Range b;
+  int i, m = marking;
+  if (e->dead || t == NULL || t->nodekind != ExpK || t->kind != CalcK) return;
+  /* the operands are evaluated again, which is
+   * only right if they change nothing */
+  if (hasAssign(t)) return;
+  op = t->child[1]->attr.op;
+  if (op == PLUS || op == MINUS || op == MUL || op == DIV) return;
+  if (!sense) switch (op) {
+    case LES: op = BEQ; break;
+    case LEQ: op = BIG; break;
+    case BIG: op = LEQ; break;
+    case BEQ: op = LES; break;
+    case EQ:  op = NEQ; break;
+    default:  op = EQ; break;
+  }
+  /* the variable is put on the left */
+  x = t->child[0];
+  if (varIndex(x->decl) < 0 || x->nodekind != ExpK || x->child[0] != NULL) {
+    x = t->child[2];
+    switch (op) {
+    case LES: op = BIG; break;
+    case LEQ: op = BEQ; break;
+    case BIG: op = LES; break;
+    case BEQ: op = LEQ; break;
+    default: break;
+    }
+    marking = FALSE;
+    b = eval(t->child[0],e);
+  }
+  else {
+    marking = FALSE;
+    b = eval(t->child[2],e);
+  }
+  marking = m;
+  if (x->nodekind != ExpK || x->kind != IdK || x->child[0] != NULL) return;
+  if ((i = varIndex(x->decl)) < 0) return;
+  v = &e->r[i];
+  switch (op) {
+  case LES: v->hi = min2(v->hi,b.hi - 1); break;
+  case LEQ: v->hi = min2(v->hi,b.hi); break;
+  case BIG: v->lo = max2(v->lo,b.lo + 1); break;
+  case BEQ: v->lo = max2(v->lo,b.lo); break;
+  case EQ:
+    v->lo = max2(v->lo,b.lo);
+    v->hi = min2(v->hi,b.hi);
+    break;
+  default: break;
+  }
+  if (v->lo > v->hi) e->dead = TRUE;
+}
+
+static void walk(TreeNode * t, Env * e);
+
+/* Procedure walkWhile iterates the loop t from the
+ * state at its head until the state coming back
+ * from the body adds nothing, then walks the body
+ * once more to mark its subscripts
+ */
+static void walkWhile(TreeNode * t, Env * e)
+{ Env cond, body;
+  int m = marking;
+  marking = FALSE;
+  for (;;) {
+    cond = copyEnv(e);
+    eval(t->child[0],&cond);
+    body = copyEnv(&cond);
+    refine(&body,t->child[0],TRUE);
+    walk(t->child[1],&body);
+    free(cond.r);
+    if (!widen(e,&body)) break;
+    free(body.r);
+  }
+  free(body.r);
+  marking = m;
+  eval(t->child[0],e);
+  body = copyEnv(e);
+  refine(&body,t->child[0],TRUE);
+  walk(t->child[1],&body);
+  free(body.r);
+  refine(e,t->child[0],FALSE);
+}
+
+static void walk(TreeNode * t, Env * e)
+{ Env other;
+  int i;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == DeclK) {
+      if ((i = varIndex(t)) >= 0) e->r[i] = full();
+      continue;
+    }
+    if (t->nodekind == ExpK) {
+      eval(t,e);
+      continue;
+    }
+    switch (t->kind) {
+    case CompoundK:
+      walk(t->child[0],e);
+      walk(t->child[1],e);
+      break;
+    case IfK:
+      eval(t->child[0],e);
+      other = copyEnv(e);
+      refine(e,t->child[0],TRUE);
+      refine(&other,t->child[0],FALSE);
+      walk(t->child[1],e);
+      walk(t->child[2],&other);
+      join(e,&other);
+      free(other.r);
+      break;
+    case WhileK:
+      walkWhile(t,e);
+      break;
+    case ReturnK:
+      eval(t->child[0],e);
+      e->dead = TRUE;
+      break;
+    default:
+      eval(t,e);
+      break;
+    }
+  }
+}
+
+void checkFunBounds(TreeNode * f)
+{ Env e;
+  nvars = 0;
+  collectVars(f->child[1]);
+  collectVars(f->child[2]);
+  e = newEnv();
+  marking = TRUE;
+  walk(f->child[2],&e);
+  free(e.r);
+}
+
+void checkBounds(TreeNode * syntaxTree)
+{ TreeNode * f;
+  nchecks = nremoved = 0;
+  for (f = syntaxTree; f != NULL; f = f->sibling)
+    if (f->nodekind == DeclK && f->kind == funK)
+      checkFunBounds(f);
+  if (TraceAnalyze)
+    fprintf(listing,"\nBounds checks: %d of %d eliminated (%d%%)\n",
+            nremoved,nchecks,nchecks ? 100 * nremoved / nchecks : 100);
+}
@@ -0,0 +1,23 @@
+/****************************************************/
+/* File: bounds.h                                   */
+/* Range analysis removing array bounds checks      */
+/* for the C- compiler's native backend             */
+/****************************************************/
+
+#ifndef _BOUNDS_H_
+#define _BOUNDS_H_
+
+/* Procedure checkBounds computes the ranges of the
+ * local scalars through if guards and while loops,
+ * and marks (F_INBOUNDS) every subscript of an array
+ * of known size that is proven to be in range; the
+ * others are checked by the generated code
+ */
+void checkBounds(TreeNode *);
+
+/* Procedure checkFunBounds does the same for the
+ * one function declaration f
+ */
+void checkFunBounds(TreeNode * f);
+
+#endif
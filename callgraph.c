@@ -0,0 +1,217 @@
+/****************************************************/
+/* File: callgraph.c                                */
+/* Call graph construction for the C- compiler      */
+/* Edges come from the declarations CallK nodes are */
+/* bound to; SCCs are found by Tarjan's algorithm   */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "callgraph.h"
+
+CallGraph callGraph = { 0, NULL, NULL, 0 };
+
+/* lookup table from declaration to graph index */
+static int * slots = NULL;
+static int nslots = 0;
+
+static unsigned cg_hash(TreeNode * fun)
+{ return (unsigned) (((unsigned long) fun >> 4) % nslots); }
+
+int cg_index(TreeNode * fun)
+{ unsigned h;
+  if (nslots == 0) return -1;
+  for (h = cg_hash(fun); slots[h] != -1; h = (h + 1) % nslots)
+    if (callGraph.funs[slots[h]].fun == fun) return slots[h];
+  return -1;
+}
+
+static void addEdge(CallGraphNode * n, int callee)
+{ int i;
+  for (i = 0; i < n->ncallees; i++)
+    if (n->callees[i] == callee) {
+      n->sites[i]++;
+      return;
+    }
+  if (n->ncallees == n->maxcallees) {
+    n->maxcallees = n->maxcallees ? 2 * n->maxcallees : 4;
+    n->callees = (int *) realloc(n->callees, sizeof(int) * n->maxcallees);
+    n->sites = (int *) realloc(n->sites, sizeof(int) * n->maxcallees);
+  }
+  n->callees[n->ncallees] = callee;
+  n->sites[n->ncallees++] = 1;
+}
+
+/* Procedure collectCalls adds an edge for every
+ * call to a user function in subtree t
+ */
+static void collectCalls(CallGraphNode * n, TreeNode * t)
+{ int i, callee;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == StmtK && t->kind == CallK &&
+        t->decl != NULL && (callee = cg_index(t->decl)) >= 0)
+      addEdge(n,callee);
+    for (i = 0; i < MAXCHILDREN; i++) collectCalls(n,t->child[i]);
+  }
+}
+
+static void markReachable(int i)
+{ CallGraphNode * n = &callGraph.funs[i];
+  int j;
+  if (n->reachable) return;
+  n->reachable = TRUE;
+  for (j = 0; j < n->ncallees; j++) markReachable(n->callees[j]);
+}
+
+/* state of Tarjan's algorithm */
+static int * tarjan;
+static int sp, counter, norder;
+
+static void strongConnect(int i)
+{ CallGraphNode * n = &callGraph.funs[i];
+  CallGraphNode * m;
+  int j, w;
+  n->index = n->lowlink = ++counter;
+  tarjan[sp++] = i;
+  n->onstack = TRUE;
+  for (j = 0; j < n->ncallees; j++) {
+    m = &callGraph.funs[n->callees[j]];
+    if (m->index == 0) {
+      strongConnect(n->callees[j]);
+      if (m->lowlink < n->lowlink) n->lowlink = m->lowlink;
+    }
+    else if (m->onstack && m->index < n->lowlink)
+      n->lowlink = m->index;
+  }
+  if (n->lowlink == n->index) {
+    /* components complete callees first, which is
+     * already the bottom-up order we want */
+    int first = norder;
+    do {
+      w = tarjan[--sp];
+      callGraph.funs[w].onstack = FALSE;
+      callGraph.funs[w].scc = callGraph.nsccs;
+      callGraph.order[norder++] = w;
+    } while (w != i);
+    for (j = first; j < norder; j++) {
+      m = &callGraph.funs[callGraph.order[j]];
+      if (norder - first > 1) m->fun->flags |= F_RECURSIVE;
+      else for (w = 0; w < m->ncallees; w++)
+        if (m->callees[w] == callGraph.order[j]) m->fun->flags |= F_RECURSIVE;
+    }
+    callGraph.nsccs++;
+  }
+}
+
+static void freeGraph(void)
+{ int i;
+  for (i = 0; i < callGraph.nfuns; i++) {
+    free(callGraph.funs[i].callees);
+    free(callGraph.funs[i].sites);
+  }
+  free(callGraph.funs);
+  free(callGraph.order);
+  free(slots);
+  callGraph.funs = NULL;
+  callGraph.order = NULL;
+  callGraph.nfuns = callGraph.nsccs = 0;
+  slots = NULL;
+  nslots = 0;
+}
+
+void buildCallGraph(TreeNode * syntaxTree)
+{ TreeNode * t;
+  int i, n = 0, root = -1;
+  unsigned h;
+  freeGraph();
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind == funK) n++;
+  callGraph.funs = (CallGraphNode *) calloc(n + 1, sizeof(CallGraphNode));
+  callGraph.order = (int *) malloc(sizeof(int) * (n + 1));
+  nslots = 2 * n + 1;
+  slots = (int *) malloc(sizeof(int) * nslots);
+  for (i = 0; i < nslots; i++) slots[i] = -1;
+  for (t = syntaxTree; t != NULL; t = t->sibling) {
+    if (t->nodekind != DeclK || t->kind != funK) continue;
+    t->flags &= ~F_RECURSIVE;
+    callGraph.funs[callGraph.nfuns].fun = t;
+    for (h = cg_hash(t); slots[h] != -1; h = (h + 1) % nslots) ;
+    slots[h] = callGraph.nfuns;
+    if (strcmp(t->attr.name,"main") == 0) root = callGraph.nfuns;
+    callGraph.nfuns++;
+  }
+  for (i = 0; i < callGraph.nfuns; i++)
+    collectCalls(&callGraph.funs[i],callGraph.funs[i].fun->child[2]);
+  /* without main every function is kept, and so it
+   * is in a unit, which other units may call */
+  for (i = 0; i < callGraph.nfuns; i++)
+    if (root < 0 || WriteUnit) callGraph.funs[i].reachable = TRUE;
+  if (root >= 0) markReachable(root);
+  tarjan = (int *) malloc(sizeof(int) * (n + 1));
+  sp = counter = norder = 0;
+  for (i = 0; i < callGraph.nfuns; i++)
+    if (callGraph.funs[i].index == 0) strongConnect(i);
+  free(tarjan);
+}
+
+TreeNode * pruneUnreachable(TreeNode * syntaxTree)
+{ TreeNode ** link = &syntaxTree;
+  TreeNode * t;
+  int i, removed = 0;
+  while ((t = *link) != NULL) {
+    if (t->nodekind == DeclK && t->kind == funK &&
+        (i = cg_index(t)) >= 0 && !callGraph.funs[i].reachable) {
+      if (TraceAnalyze)
+        fprintf(listing,"Unreachable function removed: %s\n",t->attr.name);
+      *link = t->sibling;
+      t->sibling = NULL;
+      freeTree(t);
+      removed++;
+    }
+    else link = &t->sibling;
+  }
+  if (removed) buildCallGraph(syntaxTree);
+  return syntaxTree;
+}
+
+void cg_dumpDot(FILE * out)
+{ int i, j;
+  CallGraphNode * n;
+  fprintf(out,"digraph callgraph {\n");
+  for (i = 0; i < callGraph.nfuns; i++) {
+    n = &callGraph.funs[i];
+    fprintf(out,"  \"%s\" [scc=%d%s%s];\n",n->fun->attr.name,n->scc,
+            n->reachable ? "" : ",style=dashed",
+            (n->fun->flags & F_RECURSIVE) ? ",shape=doublecircle" : "");
+  }
+  for (i = 0; i < callGraph.nfuns; i++) {
+    n = &callGraph.funs[i];
+    for (j = 0; j < n->ncallees; j++)
+      fprintf(out,"  \"%s\" -> \"%s\" [label=%d];\n",n->fun->attr.name,
+              callGraph.funs[n->callees[j]].fun->attr.name,n->sites[j]);
+  }
+  fprintf(out,"}\n");
+}
+
+void cg_dumpJson(FILE * out)
+{ int i, j;
+  CallGraphNode * n;
+  fprintf(out,"{\"functions\":[");
+  for (i = 0; i < callGraph.nfuns; i++) {
+    n = &callGraph.funs[i];
+    fprintf(out,"%s\n  {\"name\":\"%s\",\"line\":%d,\"reachable\":%s,"
+            "\"recursive\":%s,\"scc\":%d,\"calls\":[",
+            i ? "," : "",n->fun->attr.name,n->fun->lineno,
+            n->reachable ? "true" : "false",
+            (n->fun->flags & F_RECURSIVE) ? "true" : "false",n->scc);
+    for (j = 0; j < n->ncallees; j++)
+      fprintf(out,"%s{\"callee\":\"%s\",\"sites\":%d}",j ? "," : "",
+              callGraph.funs[n->callees[j]].fun->attr.name,n->sites[j]);
+    fprintf(out,"]}");
+  }
+  fprintf(out,"],\n \"order\":[");
+  for (i = 0; i < callGraph.nfuns; i++)
+    fprintf(out,"%s\"%s\"",i ? "," : "",
+            callGraph.funs[callGraph.order[i]].fun->attr.name);
+  fprintf(out,"]}\n");
+}
@@ -0,0 +1,53 @@
+/****************************************************/
+/* File: callgraph.h                                */
+/* Call graph interface for the C- compiler         */
+/****************************************************/
+
+#ifndef _CALLGRAPH_H_
+#define _CALLGRAPH_H_
+
+/* one function of the call graph */
+typedef struct CallGraphNodeRec
+{ TreeNode * fun;
+  int * callees;   /* indices of distinct callees */
+  int * sites;     /* number of call sites per callee */
+  int ncallees, maxcallees;
+  int reachable;   /* reachable from main */
+  int scc;         /* component, numbered callees first */
+  int index, lowlink, onstack; /* for Tarjan's algorithm */
+} CallGraphNode;
+
+typedef struct CallGraphRec
+{ int nfuns;
+  CallGraphNode * funs;
+  int * order;     /* function indices, callees before callers */
+  int nsccs;
+} CallGraph;
+
+/* the call graph of the last analyzed program */
+extern CallGraph callGraph;
+
+/* Procedure buildCallGraph collects the calls of
+ * every function, marks reachability from main and
+ * recursion (F_RECURSIVE), and computes the order
+ */
+void buildCallGraph(TreeNode *);
+
+/* Function cg_index returns the index of function
+ * fun in callGraph.funs, or -1
+ */
+int cg_index(TreeNode * fun);
+
+/* Function pruneUnreachable unlinks the functions
+ * that main cannot reach from the syntax tree, frees
+ * them, rebuilds the graph and returns the new tree
+ */
+TreeNode * pruneUnreachable(TreeNode * syntaxTree);
+
+/* Procedures cg_dumpDot and cg_dumpJson write the
+ * graph in Graphviz or JSON form
+ */
+void cg_dumpDot(FILE *);
+void cg_dumpJson(FILE *);
+
+#endif
@@ -0,0 +1,673 @@
+/****************************************************/
+/* File: cgen.c                                     */
+/* The code generator implementation for the C-     */
+/* compiler: three-address code from ir.c, with     */
+/* registers from regalloc.c, as x86-64 assembly    */
+/* C- symbols get a cm_ prefix so they cannot clash */
+/* with the C library                               */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "regalloc.h"
+#include "loop.h"
+#include "code.h"
+#include "peephole.h"
+#include "pgo.h"
+#include "cgen.h"
+
+/* the function being generated and its registers */
+static IrFunc fn;
+static RegAssign ra;
+
+/* frame bytes below %rbp and saved registers */
+static int frameBytes;
+
+/* the source lines of the failing checks of the
+ * function and the routines reporting them
+ * (cm_bounds or cm_divzero), whose calls are placed
+ * after its epilogue
+ */
+static int * checkLines = NULL;
+static char ** checkCalls = NULL;
+static int ncheckLines = 0, maxCheckLines = 0;
+static int nchecks = 0;
+
+/* registers carrying the first six arguments */
+static char * argReg64[6] = { "%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9" };
+
+/* operand text buffers */
+#define OPBUF 80
+static char bufA[OPBUF], bufB[OPBUF], bufC[OPBUF], bufD[OPBUF], tmp[2*OPBUF];
+static char sym[OPBUF/2];
+
+static void symName(char * buf, TreeNode * d)
+{ sprintf(buf,"cm_%s",d->attr.name); }
+
+static int isMem(IrOpnd o)
+{ return o.kind == O_REG && ra.loc[o.val] < 0; }
+
+static int isReg(IrOpnd o)
+{ return o.kind == O_REG && ra.loc[o.val] >= 0; }
+
+static int sameReg(IrOpnd x, IrOpnd y)
+{ return isReg(x) && isReg(y) && ra.loc[x.val] == ra.loc[y.val]; }
+
+/* Function opnd formats o as a 32 bit (wide FALSE)
+ * or 64 bit operand
+ */
+static char * opnd(IrOpnd o, int wide, char * buf)
+{ int l;
+  if (o.kind == O_IMM) sprintf(buf,"$%d",o.val);
+  else if (o.kind == O_REG) {
+    l = ra.loc[o.val];
+    if (l == LOC_NONE) l = -1; /* never live: any slot */
+    if (l >= 0) strcpy(buf, wide ? regName64[l] : regName32[l]);
+    else sprintf(buf,"%d(%%rbp)",-fn->arraybytes + 8 * l);
+  }
+  else buf[0] = '\0';
+  return buf;
+}
+
+static int isWide(IrOpnd o)
+{ return o.kind == O_REG && fn->isptr[o.val]; }
+
+/* Procedure move copies src to dst, through a
+ * scratch register if both are in memory
+ */
+static void move(IrOpnd src, IrOpnd dst)
+{ int w = isWide(dst) || isWide(src);
+  char * mov = w ? "movq" : "movl";
+  if (dst.kind != O_REG) return;
+  if (src.kind == O_REG && ra.loc[src.val] == ra.loc[dst.val]) return;
+  if (isMem(src) && isMem(dst)) {
+    emitAsm(mov,opnd(src,w,bufA),w ? "%rax" : "%eax");
+    emitAsm(mov,w ? "%rax" : "%eax",opnd(dst,w,bufD));
+  }
+  else emitAsm(mov,opnd(src,w,bufA),opnd(dst,w,bufD));
+}
+
+/* Procedure toReg moves o into scratch register s
+ * unless it already is in a register, and returns
+ * the register text
+ */
+static char * toReg(IrOpnd o, char * s32, char * s64, int wide, char * buf)
+{ if (isReg(o)) return opnd(o,wide,buf);
+  emitAsm(wide ? "movq" : "movl",opnd(o,wide,buf),wide ? s64 : s32);
+  strcpy(buf, wide ? s64 : s32);
+  return buf;
+}
+
+static char * condCode(TokenType op)
+{ switch (op) {
+  case LES: return "l";
+  case LEQ: return "le";
+  case BIG: return "g";
+  case BEQ: return "ge";
+  case EQ:  return "e";
+  default:  return "ne";
+  }
+}
+
+/* the relation with its operands exchanged */
+static TokenType swapRel(TokenType op)
+{ switch (op) {
+  case LES: return BIG;
+  case LEQ: return BEQ;
+  case BIG: return LES;
+  case BEQ: return LEQ;
+  default:  return op;
+  }
+}
+
+static int relHolds(TokenType op, int a, int b)
+{ switch (op) {
+  case LES: return a < b;
+  case LEQ: return a <= b;
+  case BIG: return a > b;
+  case BEQ: return a >= b;
+  case EQ:  return a == b;
+  default:  return a != b;
+  }
+}
+
+/* Function compare emits a comparison of a with b
+ * and returns the relation to test, which changes
+ * when the operands had to be exchanged
+ */
+static TokenType compare(TokenType op, IrOpnd a, IrOpnd b)
+{ IrOpnd t;
+  if (a.kind == O_IMM) {
+    t = a; a = b; b = t;
+    op = swapRel(op);
+  }
+  if (isMem(a) && isMem(b)) emitAsm("cmpl",opnd(b,FALSE,bufB),toReg(a,"%eax","%rax",FALSE,bufA));
+  else emitAsm("cmpl",opnd(b,FALSE,bufB),opnd(a,FALSE,bufA));
+  return op;
+}
+
+static void localLabel(char * buf, int l)
+{ sprintf(buf,".L%d",l); }
+
+/* Function newCheck records a failing check at
+ * lineno reported by routine and returns the label
+ * of its stub
+ */
+static char * newCheck(int lineno, char * routine)
+{ if (ncheckLines == maxCheckLines) {
+    maxCheckLines = maxCheckLines ? 2 * maxCheckLines : 16;
+    checkLines = (int *) realloc(checkLines, sizeof(int) * maxCheckLines);
+    checkCalls = (char **) realloc(checkCalls, sizeof(char *) * maxCheckLines);
+  }
+  checkLines[ncheckLines] = lineno;
+  checkCalls[ncheckLines++] = routine;
+  sprintf(tmp,".Lbc%d",nchecks++);
+  return tmp;
+}
+
+/* Procedure genDiv emits the division of i, which
+ * fails on a zero divisor as in the interpreter;
+ * idivl would trap on INT_MIN / -1, so a divisor of
+ * -1 negates instead, wrapping
+ */
+static void genDiv(IrInstr * i)
+{ char l1[OPBUF/2], l2[OPBUF/2];
+  if (i->b.kind == O_IMM && i->b.val == 0) {
+    emitAsm("jmp",newCheck(i->lineno,"cm_divzero"),NULL);
+    return;
+  }
+  emitAsm("movl",opnd(i->a,FALSE,bufA),"%eax");
+  if (i->b.kind == O_IMM && i->b.val == -1) emitAsm("negl","%eax",NULL);
+  else if (i->b.kind == O_IMM) {
+    emitAsm("cltd",NULL,NULL);
+    emitAsm("movl",opnd(i->b,FALSE,bufB),"%r11d");
+    emitAsm("idivl","%r11d",NULL);
+  }
+  else {
+    localLabel(l1,irNewLabel());
+    localLabel(l2,irNewLabel());
+    emitAsm("movl",opnd(i->b,FALSE,bufB),"%r11d");
+    emitAsm("testl","%r11d","%r11d");
+    emitAsm("je",newCheck(i->lineno,"cm_divzero"),NULL);
+    emitAsm("cmpl","$-1","%r11d");
+    emitAsm("jne",l1,NULL);
+    emitAsm("negl","%eax",NULL);
+    emitAsm("jmp",l2,NULL);
+    emitAsmLabel(l1);
+    emitAsm("cltd",NULL,NULL);
+    emitAsm("idivl","%r11d",NULL);
+    emitAsmLabel(l2);
+  }
+  emitAsm("movl","%eax",opnd(i->dst,FALSE,bufD));
+}
+
+static void genBin(IrInstr * i)
+{ char * op;
+  int commutes = i->sub != MINUS;
+  if (i->sub == DIV) {
+    genDiv(i);
+    return;
+  }
+  op = i->sub == PLUS ? "addl" : i->sub == MINUS ? "subl" : "imull";
+  if (isReg(i->dst) && !sameReg(i->dst,i->b)) {
+    move(i->a,i->dst);
+    emitAsm(op,opnd(i->b,FALSE,bufB),opnd(i->dst,FALSE,bufD));
+  }
+  else if (isReg(i->dst) && commutes) {
+    emitAsm(op,opnd(i->a,FALSE,bufA),opnd(i->dst,FALSE,bufD));
+  }
+  else {
+    emitAsm("movl",opnd(i->a,FALSE,bufA),"%eax");
+    emitAsm(op,opnd(i->b,FALSE,bufB),"%eax");
+    emitAsm("movl","%eax",opnd(i->dst,FALSE,bufD));
+  }
+}
+
+/* Function elemAddr makes the address text of
+ * element b of the array whose base is in a
+ */
+static char * elemAddr(IrOpnd a, IrOpnd b, char * buf)
+{ char base[OPBUF/2];
+  toReg(a,"%eax","%rax",TRUE,base);
+  if (b.kind == O_IMM) sprintf(buf,"%d(%s)",4 * b.val,base);
+  else {
+    emitAsm("movslq",opnd(b,FALSE,tmp),"%r11");
+    sprintf(buf,"(%s,%%r11,4)",base);
+  }
+  return buf;
+}
+
+static void genCheck(IrInstr * i)
+{ newCheck(i->lineno,"cm_bounds");
+  if (i->a.kind == O_IMM) emitAsm("jmp",tmp,NULL);
+  else {
+    /* unsigned, so negative indexes fail as well */
+    emitAsm("cmpl",opnd(i->b,FALSE,bufB),opnd(i->a,FALSE,bufA));
+    emitAsm("jae",tmp,NULL);
+  }
+}
+
+static char * vecName(IrOpnd o, char * buf)
+{ sprintf(buf, VectorISA == 2 ? "%%ymm%d" : "%%xmm%d", o.val);
+  return buf;
+}
+
+/* Procedure genVector emits the vector instructions
+ * in AVX2 (VectorISA 2) or SSE2 form; the operand
+ * lists of three operand instructions go in src
+ */
+static void genVector(IrInstr * i)
+{ int avx = VectorISA == 2;
+  char * op;
+  char vop[ASMOPLEN], va[8], vb[8];
+  switch (i->op) {
+  case I_VSPLAT:
+    if (isReg(i->a)) opnd(i->a,FALSE,bufA);
+    else {
+      emitAsm("movl",opnd(i->a,FALSE,bufA),"%eax");
+      strcpy(bufA,"%eax");
+    }
+    sprintf(bufB,"%%xmm%d",i->dst.val);
+    emitAsm(avx ? "vmovd" : "movd",bufA,bufB);
+    if (avx) emitAsm("vpbroadcastd",bufB,vecName(i->dst,bufD));
+    else {
+      sprintf(tmp,"$0, %s",bufB);
+      emitAsm("pshufd",tmp,bufB);
+    }
+    break;
+  case I_VLOAD:
+    elemAddr(i->a,i->b,bufC);
+    emitAsm(avx ? "vmovdqu" : "movdqu",bufC,vecName(i->dst,bufD));
+    break;
+  case I_VSTORE:
+    elemAddr(i->a,i->b,bufC);
+    emitAsm(avx ? "vmovdqu" : "movdqu",vecName(i->c,bufA),bufC);
+    break;
+  case I_VBIN:
+    op = i->sub == PLUS ? "paddd" : i->sub == MINUS ? "psubd" : "pmulld";
+    vecName(i->a,va);
+    vecName(i->b,vb);
+    vecName(i->dst,bufD);
+    if (avx) {
+      sprintf(vop,"v%s",op);
+      sprintf(bufC,"%s, %s",vb,va);
+      emitAsm(vop,bufC,bufD);
+    }
+    else {
+      if (i->a.val != i->dst.val) emitAsm("movdqa",va,bufD);
+      emitAsm(op,vb,bufD);
+    }
+    break;
+  default: /* I_VEND */
+    if (avx) emitAsm("vzeroupper",NULL,NULL);
+    break;
+  }
+}
+
+static void genCall(IrInstr * i)
+{ int nstack = i->nargs > 6 ? i->nargs - 6 : 0;
+  int pad = nstack % 2 ? 8 : 0;
+  int k;
+  if (pad) emitAsm("subq","$8","%rsp");
+  /* all arguments are pushed before any argument
+   * register is written, so no argument is lost */
+  for (k = i->nargs - 1; k >= 0; k--)
+    emitAsm("pushq",opnd(i->args[k],TRUE,bufA),NULL);
+  for (k = 0; k < i->nargs && k < 6; k++)
+    emitAsm("popq",argReg64[k],NULL);
+  symName(bufA,i->sym);
+  emitAsm("call",bufA,NULL);
+  if (nstack || pad) {
+    sprintf(bufA,"$%d",8 * nstack + pad);
+    emitAsm("addq",bufA,"%rsp");
+  }
+  if (i->dst.kind == O_REG) emitAsm("movl","%eax",opnd(i->dst,FALSE,bufD));
+}
+
+static void genInstr(IrInstr * i)
+{ TokenType rel;
+  switch (i->op) {
+  case I_LABEL:
+    localLabel(bufA,i->label);
+    emitAsmLabel(bufA);
+    break;
+  case I_JMP:
+    localLabel(bufA,i->label);
+    emitAsm("jmp",bufA,NULL);
+    break;
+  case I_BR:
+    if (i->a.kind == O_IMM && i->b.kind == O_IMM) {
+      if (relHolds(i->sub,i->a.val,i->b.val)) {
+        localLabel(bufA,i->label);
+        emitAsm("jmp",bufA,NULL);
+      }
+      break;
+    }
+    rel = compare(i->sub,i->a,i->b);
+    sprintf(tmp,"j%s",condCode(rel));
+    localLabel(bufA,i->label);
+    emitAsm(tmp,bufA,NULL);
+    break;
+  case I_MOV:
+    move(i->a,i->dst);
+    break;
+  case I_BIN:
+    genBin(i);
+    break;
+  case I_CMP:
+    if (i->a.kind == O_IMM && i->b.kind == O_IMM) {
+      IrOpnd c;
+      c.kind = O_IMM;
+      c.val = relHolds(i->sub,i->a.val,i->b.val);
+      move(c,i->dst);
+      break;
+    }
+    rel = compare(i->sub,i->a,i->b);
+    sprintf(tmp,"set%s",condCode(rel));
+    emitAsm(tmp,"%al",NULL);
+    emitAsm("movzbl","%al","%eax");
+    emitAsm("movl","%eax",opnd(i->dst,FALSE,bufD));
+    break;
+  case I_LOAD:
+    elemAddr(i->a,i->b,bufC);
+    if (isReg(i->dst)) emitAsm("movl",bufC,opnd(i->dst,FALSE,bufD));
+    else {
+      emitAsm("movl",bufC,"%edx");
+      emitAsm("movl","%edx",opnd(i->dst,FALSE,bufD));
+    }
+    break;
+  case I_STORE:
+    elemAddr(i->a,i->b,bufC);
+    if (isMem(i->c)) {
+      emitAsm("movl",opnd(i->c,FALSE,bufA),"%edx");
+      emitAsm("movl","%edx",bufC);
+    }
+    else emitAsm("movl",opnd(i->c,FALSE,bufA),bufC);
+    break;
+  case I_CHECK:
+    genCheck(i);
+    break;
+  case I_ADDR:
+    if (i->sym->scope == 0) {
+      symName(sym,i->sym);
+      sprintf(bufA,"%s(%%rip)",sym);
+    }
+    else sprintf(bufA,"%d(%%rbp)",cellOffset(i->sym) - fn->arraybytes);
+    if (isReg(i->dst)) emitAsm("leaq",bufA,opnd(i->dst,TRUE,bufD));
+    else {
+      emitAsm("leaq",bufA,"%rax");
+      emitAsm("movq","%rax",opnd(i->dst,TRUE,bufD));
+    }
+    break;
+  case I_PADD:
+    elemAddr(i->a,i->b,bufC);
+    if (isReg(i->dst)) emitAsm("leaq",bufC,opnd(i->dst,TRUE,bufD));
+    else {
+      emitAsm("leaq",bufC,"%rax");
+      emitAsm("movq","%rax",opnd(i->dst,TRUE,bufD));
+    }
+    break;
+  case I_GLOAD:
+    symName(sym,i->sym);
+    sprintf(bufA,"%s(%%rip)",sym);
+    if (isReg(i->dst)) emitAsm("movl",bufA,opnd(i->dst,FALSE,bufD));
+    else {
+      emitAsm("movl",bufA,"%eax");
+      emitAsm("movl","%eax",opnd(i->dst,FALSE,bufD));
+    }
+    break;
+  case I_GSTORE:
+    symName(sym,i->sym);
+    sprintf(bufD,"%s(%%rip)",sym);
+    emitAsm("movl",isMem(i->a) ? toReg(i->a,"%eax","%rax",FALSE,bufA)
+                               : opnd(i->a,FALSE,bufA),bufD);
+    break;
+  case I_CALL:
+    genCall(i);
+    break;
+  case I_COUNT:
+    sprintf(bufD,".Lcounts+%d(%%rip)",8 * i->a.val);
+    if (i->b.val == 1) emitAsm("incq",bufD,NULL);
+    else emitAsm("addq",opnd(i->b,TRUE,bufB),bufD);
+    break;
+  case I_VSPLAT:
+  case I_VLOAD:
+  case I_VSTORE:
+  case I_VBIN:
+  case I_VEND:
+    genVector(i);
+    break;
+  case I_RET:
+    if (i->a.kind != O_NONE) emitAsm("movl",opnd(i->a,FALSE,bufA),"%eax");
+    sprintf(bufA,".Lexit_%s",fn->fun->attr.name);
+    emitAsm("jmp",bufA,NULL);
+    break;
+  }
+}
+
+/* Procedure genEntry moves the incoming arguments
+ * to the locations of the parameter vregs
+ */
+static void genEntry(void)
+{ int k;
+  IrOpnd p;
+  p.kind = O_REG;
+  for (k = 0; k < fn->nparams && k < 6; k++)
+    emitAsm("pushq",argReg64[k],NULL);
+  for (k = (fn->nparams < 6 ? fn->nparams : 6) - 1; k >= 0; k--) {
+    p.val = fn->params[k];
+    emitAsm("popq",ra.loc[p.val] == LOC_NONE ? "%r11" : opnd(p,TRUE,bufD),NULL);
+  }
+  for (k = 6; k < fn->nparams; k++) {
+    p.val = fn->params[k];
+    if (ra.loc[p.val] == LOC_NONE) continue;
+    sprintf(bufA,"%d(%%rbp)",16 + 8 * (k - 6));
+    emitAsm("movq",bufA,"%rax");
+    emitAsm("movq","%rax",opnd(p,TRUE,bufD));
+  }
+}
+
+/* Procedure genZero clears the local arrays, the
+ * bytes bytes below %rbp, as the interpreter does;
+ * the argument registers still hold the arguments
+ */
+static void genZero(int bytes)
+{ int k;
+  if (bytes <= 64) {
+    for (k = 8; k <= bytes; k += 8) {
+      sprintf(bufA,"%d(%%rbp)",-k);
+      emitAsm("movq","$0",bufA);
+    }
+    return;
+  }
+  localLabel(bufB,irNewLabel());
+  sprintf(bufA,"%d(%%rbp)",-bytes);
+  emitAsm("leaq",bufA,"%rax");
+  emitAsmLabel(bufB);
+  emitAsm("movq","$0","(%rax)");
+  emitAsm("addq","$8","%rax");
+  emitAsm("cmpq","%rbp","%rax");
+  emitAsm("jb",bufB,NULL);
+}
+
+static void genFunction(IrFunc f)
+{ int k, r, nsaved = 0;
+  fn = f;
+  allocRegisters(f,&ra);
+  for (r = 0; r < NREGS; r++)
+    if (ra.calleeUsed & (1 << r)) nsaved++;
+  frameBytes = f->arraybytes + 8 * ra.nspills;
+  if ((frameBytes + 8 * nsaved) % 16) frameBytes += 8;
+  symName(bufA,f->fun);
+  sprintf(tmp,"\t.globl\t%s",bufA);
+  emitAsmText(tmp);
+  sprintf(tmp,"\t.type\t%s, @function",bufA);
+  emitAsmText(tmp);
+  emitAsmLabel(bufA);
+  emitAsm("pushq","%rbp",NULL);
+  emitAsm("movq","%rsp","%rbp");
+  if (frameBytes) {
+    sprintf(bufA,"$%d",frameBytes);
+    emitAsm("subq",bufA,"%rsp");
+  }
+  for (r = 0; r < NREGS; r++)
+    if (ra.calleeUsed & (1 << r)) emitAsm("pushq",regName64[r],NULL);
+  genZero(f->arraybytes);
+  genEntry();
+  for (k = 0; k < f->ncode; k++) {
+    if (TraceCode && f->code[k].op != I_LABEL) {
+      sprintf(tmp,"# line %d",f->code[k].lineno);
+      emitAsmText(tmp);
+    }
+    genInstr(&f->code[k]);
+  }
+  sprintf(bufA,".Lexit_%s",f->fun->attr.name);
+  emitAsmLabel(bufA);
+  for (r = NREGS - 1; r >= 0; r--)
+    if (ra.calleeUsed & (1 << r)) emitAsm("popq",regName64[r],NULL);
+  emitAsm("leave",NULL,NULL);
+  emitAsm("ret",NULL,NULL);
+  for (k = 0; k < ncheckLines; k++) {
+    sprintf(bufA,".Lbc%d",nchecks - ncheckLines + k);
+    emitAsmLabel(bufA);
+    sprintf(bufA,"$%d",checkLines[k]);
+    emitAsm("movl",bufA,"%edi");
+    emitAsm("call",checkCalls[k],NULL);
+  }
+  ncheckLines = 0;
+  emitAsmText("");
+  if (Peephole) peephole(f->fun->attr.name);
+  flushAsm();
+  free(ra.loc);
+}
+
+/* Procedure genRuntime writes the predefined
+ * functions and, if entry, the entry point calling
+ * main; they are local, so every unit has its own
+ */
+static void genRuntime(int entry)
+{ fprintf(code,"\t.section\t.rodata\n");
+  fprintf(code,".Lfmt_in:\n\t.string\t\"%%d\"\n");
+  fprintf(code,".Lfmt_out:\n\t.string\t\"%%d\\n\"\n");
+  fprintf(code,".Lfmt_bounds:\n\t.string\t\"Runtime error at line %%d: array subscript out of range\\n\"\n");
+  fprintf(code,".Lfmt_div:\n\t.string\t\"Runtime error at line %%d: division by zero\\n\"\n");
+  fprintf(code,"\t.text\n");
+  fprintf(code,"cm_input:\n");
+  fprintf(code,"\tpushq\t%%rbp\n\tmovq\t%%rsp, %%rbp\n\tsubq\t$16, %%rsp\n");
+  fprintf(code,"\tmovl\t$0, -4(%%rbp)\n");
+  fprintf(code,"\tleaq\t-4(%%rbp), %%rsi\n\tleaq\t.Lfmt_in(%%rip), %%rdi\n");
+  fprintf(code,"\txorl\t%%eax, %%eax\n\tcall\tscanf@PLT\n");
+  fprintf(code,"\tmovl\t-4(%%rbp), %%eax\n\tleave\n\tret\n\n");
+  fprintf(code,"cm_output:\n");
+  fprintf(code,"\tpushq\t%%rbp\n\tmovq\t%%rsp, %%rbp\n");
+  fprintf(code,"\tmovl\t%%edi, %%esi\n\tleaq\t.Lfmt_out(%%rip), %%rdi\n");
+  fprintf(code,"\txorl\t%%eax, %%eax\n\tcall\tprintf@PLT\n");
+  fprintf(code,"\tpopq\t%%rbp\n\tret\n\n");
+  fprintf(code,"cm_bounds:\n");
+  fprintf(code,"\tpushq\t%%rbp\n\tmovq\t%%rsp, %%rbp\n");
+  fprintf(code,"\tmovl\t%%edi, %%esi\n\tleaq\t.Lfmt_bounds(%%rip), %%rdi\n");
+  fprintf(code,"\txorl\t%%eax, %%eax\n\tcall\tprintf@PLT\n");
+  fprintf(code,"\tmovl\t$1, %%edi\n\tcall\texit@PLT\n\n");
+  fprintf(code,"cm_divzero:\n");
+  fprintf(code,"\tpushq\t%%rbp\n\tmovq\t%%rsp, %%rbp\n");
+  fprintf(code,"\tmovl\t%%edi, %%esi\n\tleaq\t.Lfmt_div(%%rip), %%rdi\n");
+  fprintf(code,"\txorl\t%%eax, %%eax\n\tcall\tprintf@PLT\n");
+  fprintf(code,"\tmovl\t$1, %%edi\n\tcall\texit@PLT\n\n");
+  if (!entry) return;
+  fprintf(code,"\t.globl\tmain\n\t.type\tmain, @function\nmain:\n");
+  fprintf(code,"\tpushq\t%%rbp\n\tmovq\t%%rsp, %%rbp\n");
+  /* the counters are written however the program
+   * ends, also by a failed bounds check */
+  if (Instrument)
+    fprintf(code,"\tleaq\t.Ldump(%%rip), %%rdi\n\tcall\tatexit@PLT\n");
+  fprintf(code,"\tcall\tcm_main\n\txorl\t%%eax, %%eax\n");
+  fprintf(code,"\tpopq\t%%rbp\n\tret\n\n");
+}
+
+/* Procedure genCounters writes the counters of the
+ * instrumented program and .Ldump, which appends
+ * "function line kind count" for every record of
+ * ir.c to the counts file at exit
+ */
+static void genCounters(char * countfile)
+{ int k;
+  fprintf(code,"\t.section\t.rodata\n");
+  fprintf(code,".Lcount_file:\n\t.string\t\"%s\"\n",countfile);
+  fprintf(code,".Lcount_mode:\n\t.string\t\"w\"\n");
+  fprintf(code,".Lcount_head:\n\t.string\t\"# C- execution counts\\n# function\\tline\\tkind\\tcount\\n\"\n");
+  fprintf(code,".Lfmt_count:\n\t.string\t\"%%s\\t%%ld\\n\"\n");
+  for (k = 0; k < nIrCounters; k++)
+    fprintf(code,".Lcount_name%d:\n\t.string\t\"%s\\t%d\\t%s\"\n",k,
+            irCounters[k].fun->attr.name,irCounters[k].lineno,irCounters[k].kind);
+  /* the records hold addresses, so they are data */
+  fprintf(code,"\t.data\n\t.align\t8\n.Lcount_recs:\n");
+  for (k = 0; k < nIrCounters; k++)
+    fprintf(code,"\t.quad\t.Lcount_name%d, %d\n",k,irCounters[k].counter);
+  fprintf(code,"\t.bss\n\t.align\t8\n.Lcounts:\n\t.zero\t%d\n",8 * (nIrCounts + 1));
+  fprintf(code,"\t.text\n.Ldump:\n");
+  fprintf(code,"\tpushq\t%%rbp\n\tmovq\t%%rsp, %%rbp\n\tpushq\t%%rbx\n\tpushq\t%%r12\n");
+  fprintf(code,"\tleaq\t.Lcount_file(%%rip), %%rdi\n\tleaq\t.Lcount_mode(%%rip), %%rsi\n");
+  fprintf(code,"\tcall\tfopen@PLT\n\ttestq\t%%rax, %%rax\n\tje\t.Ldump_done\n");
+  fprintf(code,"\tmovq\t%%rax, %%r12\n");
+  fprintf(code,"\tmovq\t%%r12, %%rdi\n\tleaq\t.Lcount_head(%%rip), %%rsi\n");
+  fprintf(code,"\txorl\t%%eax, %%eax\n\tcall\tfprintf@PLT\n");
+  fprintf(code,"\txorl\t%%ebx, %%ebx\n");
+  fprintf(code,".Ldump_next:\n\tcmpq\t$%d, %%rbx\n\tjge\t.Ldump_close\n",nIrCounters);
+  fprintf(code,"\tmovq\t%%rbx, %%rcx\n\tshlq\t$4, %%rcx\n");
+  fprintf(code,"\tleaq\t.Lcount_recs(%%rip), %%rax\n");
+  fprintf(code,"\tmovq\t(%%rax,%%rcx), %%rdx\n\tmovq\t8(%%rax,%%rcx), %%rcx\n");
+  fprintf(code,"\tleaq\t.Lcounts(%%rip), %%rax\n\tmovq\t(%%rax,%%rcx,8), %%rcx\n");
+  fprintf(code,"\tmovq\t%%r12, %%rdi\n\tleaq\t.Lfmt_count(%%rip), %%rsi\n");
+  fprintf(code,"\txorl\t%%eax, %%eax\n\tcall\tfprintf@PLT\n");
+  fprintf(code,"\tincq\t%%rbx\n\tjmp\t.Ldump_next\n");
+  fprintf(code,".Ldump_close:\n\tmovq\t%%r12, %%rdi\n\tcall\tfclose@PLT\n");
+  fprintf(code,".Ldump_done:\n\tpopq\t%%r12\n\tpopq\t%%rbx\n\tpopq\t%%rbp\n\tret\n\n");
+}
+
+static void genGlobals(TreeNode * syntaxTree)
+{ TreeNode * t;
+  char name[OPBUF];
+  fprintf(code,"\t.bss\n");
+  for (t = syntaxTree; t != NULL; t = t->sibling) {
+    if (t->nodekind != DeclK || t->kind != varK) continue;
+    symName(name,t);
+    fprintf(code,"\t.globl\t%s\n\t.align\t16\n%s:\n\t.zero\t%d\n",
+            name,name,arraySize(t) > 0 ? 4 * arraySize(t) : 4);
+  }
+}
+
+void codeGen(TreeNode * syntaxTree, char * codefile)
+{ IrFunc funs;
+  IrFunc f;
+  TreeNode * t;
+  char * countfile;
+  int entry = !WriteUnit;
+  fprintf(code,"# C- compilation to x86-64 assembly\n");
+  fprintf(code,"# File: %s\n",codefile);
+  fprintf(code,"# build with: gcc -o prog %s\n",codefile);
+  genGlobals(syntaxTree);
+  /* a unit without main is entered from another */
+  for (t = syntaxTree; t != NULL && !entry; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind == funK && strcmp(t->attr.name,"main") == 0)
+      entry = TRUE;
+  genRuntime(entry);
+  funs = lowerProgram(syntaxTree);
+  for (f = funs; f != NULL; f = f->next) {
+    if (LoopOpt || VectorISA) optimizeLoops(f,LoopOpt ? UnrollFactor : 1);
+    if (TraceCode) printIr(listing,f);
+    genFunction(f);
+  }
+  if (Instrument) {
+    countfile = (char *) malloc(strlen(codefile) + 8);
+    strcpy(countfile,codefile);
+    strcpy(strrchr(countfile,'.'),".counts");
+    genCounters(countfile);
+    free(countfile);
+  }
+  fprintf(code,"\t.section\t.note.GNU-stack,\"\",@progbits\n");
+  freeIr(funs);
+  if (LoopOpt || VectorISA) loopReport(listing);
+  regallocReport(listing);
+  if (Peephole) peepholeReport(listing);
+  if (ProfileUse) pgoReport(listing);
+}
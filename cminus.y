@@ -7,14 +7,22 @@
 
 int yyerror(char *message);
 TreeNode * parse(void);
+TreeNode * parseDecls(void (* decl)(TreeNode *));
+void parseBegin(void (* decl)(TreeNode *));
+int parseToken(TokenType token);
+TreeNode * parseEnd(void);
 
 #define YYSTYPE TreeNode *
 static char * savedName; /* for use in assignments */
 static int savedLineNo;  /* ditto */
 static TreeNode * savedTree; /* stores syntax tree for later return */
+static TreeNode * lastDecl;  /* last top-level declaration */
+static void (* declHook)(TreeNode *); /* see parseDecls */
 int pn;
 %}
 
+%define api.push-pull both
+
 %token IF ELSE INT RETURN VOID WHILE
 %token ID NUM
 %token LEQ LES BEQ BIG EQ NEQ SEMI
@@ -30,15 +38,17 @@ program     : declar_list
 { savedTree = $1;}
             ;
 declar_list : declar_list declar
-                 { YYSTYPE t = $1;
-                   if (t != NULL)
-                   { while (t->sibling != NULL)
-                        t = t->sibling;
-                     t->sibling = $2;
+                 { if ($1 != NULL)
+                   { lastDecl->sibling = $2;
                      $$ = $1; }
                    else $$ = $2;
+                   if ($2 != NULL) lastDecl = $2;
+                   if ($2 != NULL && declHook != NULL) declHook($2);
+                 }
+            | declar
+                 { $$ = lastDecl = $1;
+                   if ($1 != NULL && declHook != NULL) declHook($1);
                  }
-            | declar  { $$ = $1; }
             ;
 declar      : var_declar { $$ = $1; }
             | fun_declar { $$ = $1; }
@@ -47,12 +57,12 @@ var_declar  : type_spec ID SEMI
                  { $$ = newDeclNode(varK);
                    $$->child[0] = $1;
                    $$->attr.name = copyString(st_pop());
-                   $$->array_size = 0;
+                   declInfo($$)->array_size = 0;
                  }
             | type_spec ID BOPEN NUM BCLOSE SEMI
                  { $$ = newDeclNode(varK);
                    $$->child[0] = $1;
-                   $$->array_size = atoi(st_pop());
+                   declInfo($$)->array_size = atoi(st_pop());
                    $$->attr.name = copyString(st_pop());
                  }
             ;
@@ -78,9 +88,9 @@ fun_declar  : type_spec ID { savedLineNo = lineno;}
 params      : param_list { $$ = $1; }
             | VOID
             { $$ = newDeclNode(paramK);
-		$$->array_size = -1;
+		declInfo($$)->array_size = -1;
 		$$->type = Void;
-		$$->paramnum = 0;
+		declInfo($$)->paramnum = 0;
             }
             ;
 param_list  : param_list COMMA param
@@ -98,13 +108,13 @@ param       : type_spec ID
                  { $$ = newDeclNode(paramK);
                    $$->child[0] = $1;
                    $$->attr.name = copyString(st_pop());
-                   $$->array_size = 0;
+                   declInfo($$)->array_size = 0;
                  }
             | type_spec ID BOPEN BCLOSE
                  { $$ = newDeclNode(paramK);
                    $$->child[0] = $1;
                    $$->attr.name = copyString(st_pop());
-		   $$->array_size = 1;
+		   declInfo($$)->array_size = 1;
                  }
             ;
 compound_stmt : MOPEN local_declar stmt_list MCLOSE
@@ -183,14 +193,14 @@ expr           : var ASSIGN expr
 var            : ID
                { $$ = newExpNode(IdK);
                  $$->attr.name = copyString(st_pop());
-		 $$->array_size = 0;
+		 $$->subscript = 0;
 		 $$->type = Integer;
                }
                | ID BOPEN expr BCLOSE
                { $$ = newExpNode(IdK);
                  $$->attr.name = copyString(st_pop());
                  $$->child[0] = $3;
-		 $$->array_size = 1;
+		 $$->subscript = 1;
 		 $$->type = Integer;
                }
                ;
@@ -304,7 +314,48 @@ int yyerror(char * message)
 
 TreeNode * parse(void)
 {
+  return parseDecls(NULL);
+}
+
+TreeNode * parseDecls(void (* decl)(TreeNode *))
+{
+  savedTree = NULL;
+  lastDecl = NULL;
+  declHook = decl;
+  st_clear();
   yyparse();
   return savedTree;
 }
 
+/* the parser state while tokens are pushed */
+static yypstate * pushState = NULL;
+static int pushStatus;
+
+void parseBegin(void (* decl)(TreeNode *))
+{
+  savedTree = NULL;
+  lastDecl = NULL;
+  declHook = decl;
+  st_clear();
+  if (pushState != NULL) yypstate_delete(pushState);
+  pushState = yypstate_new();
+  pushStatus = YYPUSH_MORE;
+}
+
+int parseToken(TokenType token)
+{
+  if (pushStatus == YYPUSH_MORE)
+  { /* an impure push parser takes the token in yychar */
+    yychar = token;
+    pushStatus = yypush_parse(pushState);
+  }
+  return pushStatus == YYPUSH_MORE;
+}
+
+TreeNode * parseEnd(void)
+{
+  parseToken(0); /* the end of input, as yylex returns it */
+  yypstate_delete(pushState);
+  pushState = NULL;
+  return savedTree;
+}
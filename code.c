@@ -0,0 +1,80 @@
+/****************************************************/
+/* File: code.c                                     */
+/* Assembly emitting utilities implementation       */
+/* for the C- compiler                              */
+/****************************************************/
+
+#include "globals.h"
+#include "code.h"
+
+AsmLine * asmCode = NULL;
+int asmCount = 0;
+static int asmMax = 0;
+
+static AsmLine * newLine(int kind)
+{ AsmLine * l;
+  if (asmCount == asmMax) {
+    asmMax = asmMax ? 2 * asmMax : 256;
+    asmCode = (AsmLine *) realloc(asmCode, sizeof(AsmLine) * asmMax);
+  }
+  l = &asmCode[asmCount++];
+  l->kind = kind;
+  l->op[0] = l->src[0] = l->dst[0] = '\0';
+  return l;
+}
+
+void emitAsm(char * op, char * src, char * dst)
+{ AsmLine * l = newLine(A_INSTR);
+  strncpy(l->op,op,ASMOPLEN-1);
+  l->op[ASMOPLEN-1] = '\0';
+  if (src != NULL) {
+    strncpy(l->src,src,ASMARGLEN-1);
+    l->src[ASMARGLEN-1] = '\0';
+  }
+  if (dst != NULL) {
+    strncpy(l->dst,dst,ASMARGLEN-1);
+    l->dst[ASMARGLEN-1] = '\0';
+  }
+}
+
+void emitAsmLabel(char * name)
+{ AsmLine * l = newLine(A_LABEL);
+  strncpy(l->src,name,ASMARGLEN-1);
+  l->src[ASMARGLEN-1] = '\0';
+}
+
+void emitAsmText(char * text)
+{ AsmLine * l = newLine(A_TEXT);
+  strncpy(l->src,text,ASMARGLEN-1);
+  l->src[ASMARGLEN-1] = '\0';
+}
+
+void emitAsmLine(AsmLine * line)
+{ AsmLine * l = newLine(line->kind);
+  *l = *line;
+}
+
+void flushAsm(void)
+{ int i;
+  AsmLine * l;
+  for (i = 0; i < asmCount; i++) {
+    l = &asmCode[i];
+    switch (l->kind) {
+    case A_LABEL:
+      fprintf(code,"%s:\n",l->src);
+      break;
+    case A_TEXT:
+      fprintf(code,"%s\n",l->src);
+      break;
+    default:
+      if (l->src[0] && l->dst[0])
+        fprintf(code,"\t%s\t%s, %s\n",l->op,l->src,l->dst);
+      else if (l->src[0])
+        fprintf(code,"\t%s\t%s\n",l->op,l->src);
+      else
+        fprintf(code,"\t%s\n",l->op);
+      break;
+    }
+  }
+  asmCount = 0;
+}
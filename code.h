@@ -0,0 +1,49 @@
+/****************************************************/
+/* File: code.h                                     */
+/* Assembly emitting utilities for the C- compiler  */
+/* Instructions of a function are buffered so that  */
+/* the prologue can be written after allocation     */
+/****************************************************/
+
+#ifndef _CODE_H_
+#define _CODE_H_
+
+/* kinds of buffered lines */
+#define A_INSTR 0  /* op src, dst */
+#define A_LABEL 1  /* name: */
+#define A_TEXT  2  /* directive or comment, copied as is */
+
+#define ASMOPLEN 16
+#define ASMARGLEN 80
+
+typedef struct
+{ int kind;
+  char op[ASMOPLEN];
+  char src[ASMARGLEN];   /* empty if none */
+  char dst[ASMARGLEN];   /* empty if none */
+} AsmLine;
+
+/* the buffer of the function being generated */
+extern AsmLine * asmCode;
+extern int asmCount;
+
+/* Procedure emitAsm buffers an instruction with up
+ * to two operands (NULL when absent)
+ */
+void emitAsm(char * op, char * src, char * dst);
+
+/* Procedure emitAsmLabel buffers a label definition */
+void emitAsmLabel(char * name);
+
+/* Procedure emitAsmText buffers a directive line */
+void emitAsmText(char * text);
+
+/* Procedure emitAsmLine buffers a copy of line */
+void emitAsmLine(AsmLine * line);
+
+/* Procedure flushAsm writes the buffer to the code
+ * file and empties it
+ */
+void flushAsm(void);
+
+#endif
@@ -0,0 +1,654 @@
+/****************************************************/
+/* File: ctrans.c                                   */
+/* C99 code generator for the C- compiler           */
+/* The program is written as one C file for the     */
+/* system compiler. Arithmetic wraps and operands   */
+/* are evaluated left to right, as the interpreter  */
+/* does; locals are declared once per call and      */
+/* start at zero. A #line directive precedes every  */
+/* statement whose line the output has lost track   */
+/* of, so that compiler messages, debuggers and     */
+/* profilers show C- lines.                         */
+/****************************************************/
+
+#include <stdarg.h>
+#include "globals.h"
+#include "util.h"
+#include "ctrans.h"
+#include "unit.h"
+
+static char * srcName;
+
+/* outLine counts the lines written; srcLine is the
+ * line of srcName the next one stands for, or 0
+ */
+static int outLine;
+static int srcLine;
+
+/* TRUE while a function is only run through to count
+ * its temporaries
+ */
+static int counting;
+
+/* temporaries used in the function so far */
+static int ntemps;
+
+static int indent;
+
+/* TRUE once main is written, for the entry point */
+static int sawMain;
+
+/* the C names of the parameters and locals of the
+ * function, which all live at its top level
+ */
+typedef struct
+{ TreeNode * decl;
+  char * name;
+} Local;
+
+static Local * locals = NULL;
+static int nlocals = 0, maxlocals = 0;
+
+static void put(char * fmt, ...)
+{ char buf[256];
+  char * p;
+  va_list ap;
+  if (counting) return;
+  va_start(ap,fmt);
+  vsnprintf(buf,sizeof(buf),fmt,ap);
+  va_end(ap);
+  for (p = buf; *p; p++)
+    if (*p == '\n') {
+      outLine++;
+      if (srcLine) srcLine++;
+    }
+  fputs(buf,code);
+}
+
+/* Procedure startLine begins a line of output that
+ * stands for line lineno of the source (none if 0)
+ */
+static void startLine(int lineno)
+{ if (lineno > 0 && lineno != srcLine) {
+    put("#line %d \"%s\"\n",lineno,srcName);
+    if (!counting) srcLine = lineno;
+  }
+  put("%*s",2 * indent,"");
+}
+
+/* the names of the top-level declarations written,
+ * in a chained hash table of GLOBALS lists
+ */
+#define GLOBALS 4093
+
+typedef struct GlobalRec
+{ char * name;
+  struct GlobalRec * next;
+} * Global;
+
+static Global globals[GLOBALS];
+
+static int globalHash(char * name)
+{ unsigned h = 0;
+  while (*name) h = h * 31 + (unsigned char) *name++;
+  return h % GLOBALS;
+}
+
+static int isGlobalName(char * name)
+{ Global g;
+  for (g = globals[globalHash(name)]; g != NULL; g = g->next)
+    if (strcmp(g->name,name) == 0) return TRUE;
+  return FALSE;
+}
+
+static void addGlobal(TreeNode * t)
+{ int h = globalHash(t->attr.name);
+  Global g = (Global) malloc(sizeof(struct GlobalRec));
+  g->name = t->attr.name;
+  g->next = globals[h];
+  globals[h] = g;
+}
+
+/* Procedure addLocal names declaration d; a name
+ * already taken in the function or by a global gets
+ * a suffix, since C- blocks are flattened
+ */
+static void addLocal(TreeNode * d)
+{ char name[STRINGSIZE + 32];
+  int k, n = 0, taken = TRUE;
+  while (taken) {
+    if (n == 0) sprintf(name,"cm_%s",d->attr.name);
+    else sprintf(name,"cm_%s__%d",d->attr.name,n);
+    taken = n == 0 && isGlobalName(d->attr.name);
+    for (k = 0; k < nlocals && !taken; k++)
+      if (strcmp(locals[k].name,name) == 0) taken = TRUE;
+    n++;
+  }
+  if (nlocals == maxlocals) {
+    maxlocals = maxlocals ? 2 * maxlocals : 32;
+    locals = (Local *) realloc(locals, sizeof(Local) * maxlocals);
+  }
+  locals[nlocals].decl = d;
+  locals[nlocals].name = copyString(name);
+  nlocals++;
+}
+
+/* Procedure addLocals names the variables declared
+ * in the statements t and the blocks inside them
+ */
+static void addLocals(TreeNode * t)
+{ int i;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == DeclK && t->kind == varK) addLocal(t);
+    else if (t->nodekind == StmtK)
+      for (i = 0; i < MAXCHILDREN; i++) addLocals(t->child[i]);
+  }
+}
+
+static void putName(TreeNode * d)
+{ int k;
+  for (k = nlocals - 1; k >= 0; k--)
+    if (locals[k].decl == d) {
+      put("%s",locals[k].name);
+      return;
+    }
+  put("cm_%s",d->attr.name);
+}
+
+static int isConst(TreeNode * t)
+{ return t->nodekind == ExpK && t->kind == ConstK; }
+
+/* Function checked is TRUE if the subscript of t
+ * has to be checked at run time
+ */
+static int checked(TreeNode * t)
+{ TreeNode * d = t->decl;
+  if (t->nodekind != ExpK || t->kind != IdK) return FALSE;
+  if (arraySize(t) <= 0 || t->child[0] == NULL || d->kind != varK) return FALSE;
+  if (t->flags & F_INBOUNDS) return FALSE;
+  return !(isConst(t->child[0]) && t->child[0]->attr.val >= 0 &&
+           t->child[0]->attr.val < arraySize(d));
+}
+
+/* Function effects is TRUE if evaluating t may
+ * assign, call or stop the program
+ */
+static int effects(TreeNode * t)
+{ int i;
+  if (t == NULL) return FALSE;
+  if (t->nodekind == StmtK || checked(t)) return TRUE;
+  if (t->nodekind == ExpK && t->kind == CalcK && t->child[1]->attr.op == DIV &&
+      !(isConst(t->child[2]) && t->child[2]->attr.val != 0))
+    return TRUE;
+  for (i = 0; i < MAXCHILDREN; i++)
+    if (effects(t->child[i])) return TRUE;
+  return FALSE;
+}
+
+static int assigns(TreeNode * t)
+{ int i;
+  if (t == NULL) return FALSE;
+  if (t->nodekind == StmtK && t->kind == AssignK) return TRUE;
+  for (i = 0; i < MAXCHILDREN; i++)
+    if (assigns(t->child[i])) return TRUE;
+  if (t->nodekind == StmtK && t->kind == CallK)
+    for (t = t->child[0]; t != NULL; t = t->sibling)
+      if (assigns(t)) return TRUE;
+  return FALSE;
+}
+
+/* a local scalar: no call can change it */
+static int isLocalScalar(TreeNode * t)
+{ return t->nodekind == ExpK && t->kind == IdK &&
+         t->decl->scope > 0 && arraySize(t->decl) == 0;
+}
+
+/* Function needOrder is TRUE if x has to be
+ * evaluated before y, which C leaves open
+ */
+static int needOrder(TreeNode * x, TreeNode * y)
+{ if (isConst(x) || isConst(y)) return FALSE;
+  if (!effects(x) && !effects(y)) return FALSE;
+  if (isLocalScalar(x) && !assigns(y)) return FALSE;
+  if (isLocalScalar(y) && !assigns(x)) return FALSE;
+  return TRUE;
+}
+
+static void genExp(TreeNode * t, int top);
+
+static void genVar(TreeNode * t)
+{ putName(t->decl);
+  if (arraySize(t) <= 0 || t->child[0] == NULL) return;
+  put("[");
+  if (checked(t)) {
+    put("rt_index(");
+    genExp(t->child[0],TRUE);
+    put(", %d, %d)",arraySize(t->decl),t->lineno);
+  }
+  else genExp(t->child[0],TRUE);
+  put("]");
+}
+
+static void genCall(TreeNode * t)
+{ TreeNode * f = t->decl;
+  TreeNode * p;
+  TreeNode * a;
+  TreeNode * b;
+  int temp[MAXCHILDREN * 64];
+  int n = 0, k, hoisted = FALSE;
+  if (f->flags & F_BUILTIN) {
+    if (strcmp(f->attr.name,"input") == 0) put("rt_input(%d)",t->lineno);
+    else {
+      put("rt_output(");
+      genExp(t->child[0],TRUE);
+      put(")");
+    }
+    return;
+  }
+  /* arguments that later ones could disturb are
+   * evaluated into temporaries first */
+  for (a = t->child[0], p = f->child[1]; a != NULL; a = a->sibling, p = p->sibling, n++) {
+    temp[n] = 0;
+    if (arraySize(p) > 0 || n >= MAXCHILDREN * 64) continue;
+    for (b = a->sibling; b != NULL && !temp[n]; b = b->sibling)
+      if (needOrder(a,b)) temp[n] = ++ntemps;
+    if (temp[n]) {
+      put(hoisted ? "" : "(");
+      put("t%d = ",temp[n]);
+      genExp(a,TRUE);
+      put(", ");
+      hoisted = TRUE;
+    }
+  }
+  putName(f);
+  put("(");
+  for (a = t->child[0], p = f->child[1], k = 0; a != NULL; a = a->sibling, p = p->sibling, k++) {
+    if (k > 0) put(", ");
+    if (arraySize(p) > 0) putName(a->decl);
+    else if (k < n && temp[k]) put("t%d",temp[k]);
+    else genExp(a,TRUE);
+  }
+  put(")");
+  if (hoisted) put(")");
+}
+
+/* the value is assigned after the subscript of the
+ * target is evaluated and checked
+ */
+static void genAssign(TreeNode * t, int top)
+{ TreeNode * lhs = t->child[0];
+  TreeNode * rhs = t->child[1];
+  int temp = 0;
+  if (arraySize(lhs) > 0 && lhs->child[0] != NULL &&
+      (needOrder(rhs,lhs->child[0]) || (checked(lhs) && effects(rhs))))
+    temp = ++ntemps;
+  if (!top || temp) put("(");
+  if (temp) {
+    put("t%d = ",temp);
+    genExp(rhs,TRUE);
+    put(", ");
+    genVar(lhs);
+    put(" = t%d",temp);
+  }
+  else {
+    genVar(lhs);
+    put(" = ");
+    genExp(rhs,TRUE);
+  }
+  if (!top || temp) put(")");
+}
+
+static char * relText(TokenType op)
+{ switch (op) {
+  case LES: return "<";
+  case LEQ: return "<=";
+  case BIG: return ">";
+  case BEQ: return ">=";
+  case EQ: return "==";
+  default: return "!=";
+  }
+}
+
+/* Procedure genCalc writes operator expression t;
+ * + - * wrap around and division fails on zero as
+ * in the interpreter
+ */
+static void genCalc(TreeNode * t, int top)
+{ TreeNode * x = t->child[0];
+  TreeNode * y = t->child[2];
+  TokenType op = t->child[1]->attr.op;
+  int temp = needOrder(x,y) ? ++ntemps : 0;
+  if (temp) {
+    put("(t%d = ",temp);
+    genExp(x,TRUE);
+    put(", ");
+    top = TRUE;
+  }
+  switch (op) {
+  case PLUS: case MINUS: case MUL:
+    put(op == PLUS ? "rt_add(" : op == MINUS ? "rt_sub(" : "rt_mul(");
+    if (temp) put("t%d",temp); else genExp(x,TRUE);
+    put(", ");
+    genExp(y,TRUE);
+    put(")");
+    break;
+  case DIV:
+    if (isConst(y) && y->attr.val != 0) {
+      if (!top) put("(");
+      if (temp) put("t%d",temp); else genExp(x,FALSE);
+      put(" / %d",y->attr.val);
+      if (!top) put(")");
+    }
+    else {
+      put("rt_div(");
+      if (temp) put("t%d",temp); else genExp(x,TRUE);
+      put(", ");
+      genExp(y,TRUE);
+      put(", %d)",t->lineno);
+    }
+    break;
+  default:
+    if (!top) put("(");
+    if (temp) put("t%d",temp); else genExp(x,FALSE);
+    put(" %s ",relText(op));
+    genExp(y,FALSE);
+    if (!top) put(")");
+    break;
+  }
+  if (temp) put(")");
+}
+
+/* Procedure genExp writes expression t, in
+ * parentheses unless top
+ */
+static void genExp(TreeNode * t, int top)
+{ if (t->nodekind == StmtK) {
+    if (t->kind == CallK) genCall(t);
+    else genAssign(t,top);
+    return;
+  }
+  switch (t->kind) {
+  case ConstK:
+    put("%d",t->attr.val);
+    break;
+  case IdK:
+    genVar(t);
+    break;
+  case CalcK:
+    genCalc(t,top);
+    break;
+  default:
+    break;
+  }
+}
+
+/* if and while nodes are made at the end of the
+ * statement; their condition has its first line
+ */
+static int stmtLine(TreeNode * t)
+{ if (t->nodekind == StmtK && (t->kind == IfK || t->kind == WhileK))
+    return t->child[0]->lineno;
+  return t->lineno;
+}
+
+static void genStmt(TreeNode * t);
+
+/* Procedure genBody writes the statement of an if or
+ * while inside the braces opened by the caller
+ */
+static void genBody(TreeNode * t)
+{ indent++;
+  if (t->nodekind == StmtK && t->kind == CompoundK) genStmt(t->child[1]);
+  else {
+    TreeNode * next = t->sibling;
+    t->sibling = NULL;
+    genStmt(t);
+    t->sibling = next;
+  }
+  indent--;
+}
+
+static void genStmt(TreeNode * t)
+{ for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == DeclK) continue;
+    if (t->nodekind == StmtK && t->kind == CompoundK) {
+      startLine(0);
+      put("{\n");
+      genBody(t);
+      startLine(0);
+      put("}\n");
+      continue;
+    }
+    startLine(stmtLine(t));
+    if (t->nodekind == ExpK) {
+      put("(void) ");
+      genExp(t,FALSE);
+      put(";\n");
+      continue;
+    }
+    switch (t->kind) {
+    case IfK:
+      put("if (");
+      genExp(t->child[0],TRUE);
+      put(") {\n");
+      genBody(t->child[1]);
+      if (t->child[2] != NULL) {
+        startLine(0);
+        put("} else {\n");
+        genBody(t->child[2]);
+      }
+      startLine(0);
+      put("}\n");
+      break;
+    case WhileK:
+      put("while (");
+      genExp(t->child[0],TRUE);
+      put(") {\n");
+      genBody(t->child[1]);
+      startLine(0);
+      put("}\n");
+      break;
+    case ReturnK:
+      if (t->child[0] == NULL) put("return;\n");
+      else {
+        put("return ");
+        genExp(t->child[0],TRUE);
+        put(";\n");
+      }
+      break;
+    default:
+      genExp(t,TRUE);
+      put(";\n");
+      break;
+    }
+  }
+}
+
+/* Procedure genHeader writes the type, name and
+ * parameters of function f
+ */
+static void genHeader(TreeNode * f)
+{ TreeNode * p;
+  int n = 0;
+  /* a unit shares its functions with the others */
+  put("%s%s ",WriteUnit ? "" : "static ",f->type == Void ? "void" : "int");
+  putName(f);
+  put("(");
+  for (p = f->child[1]; p != NULL; p = p->sibling) {
+    if (arraySize(p) < 0) continue;
+    if (n++ > 0) put(", ");
+    put(arraySize(p) > 0 ? "int * " : "int ");
+    putName(p);
+  }
+  if (n == 0) put("void");
+  put(")");
+}
+
+static void genFunction(TreeNode * f)
+{ TreeNode * p;
+  TreeNode * body = f->child[2];
+  int k, n, save;
+  nlocals = 0;
+  for (p = f->child[1]; p != NULL; p = p->sibling)
+    if (arraySize(p) >= 0) addLocal(p);
+  n = nlocals;
+  addLocals(body);
+  /* a dry run finds the temporaries to declare */
+  save = srcLine;
+  counting = TRUE;
+  ntemps = 0;
+  genStmt(body->child[1]);
+  counting = FALSE;
+  srcLine = save;
+  indent = 0;
+  if (strcmp(f->attr.name,"main") == 0) sawMain = TRUE;
+  startLine(f->lineno);
+  genHeader(f);
+  put("\n{\n");
+  indent = 1;
+  for (k = n; k < nlocals; k++) {
+    startLine(locals[k].decl->lineno);
+    if (arraySize(locals[k].decl) > 0)
+      put("int %s[%d] = { 0 };\n",locals[k].name,arraySize(locals[k].decl));
+    else put("int %s = 0;\n",locals[k].name);
+  }
+  if (ntemps > 0) {
+    startLine(0);
+    put("int t1");
+    for (k = 2; k <= ntemps; k++) put(", t%d",k);
+    put(";\n");
+  }
+  ntemps = 0;
+  genStmt(body->child[1]);
+  for (p = body->child[1]; p != NULL && p->sibling != NULL; p = p->sibling)
+    ;
+  if (f->type != Void && !(p != NULL && p->nodekind == StmtK && p->kind == ReturnK)) {
+    startLine(0);
+    put("return 0;\n");
+  }
+  indent = 0;
+  put("}\n\n");
+}
+
+/* Procedure genRuntime writes input, output and the
+ * checks used by the generated code
+ */
+static void genRuntime(void)
+{ put("static void rt_error(int line, const char * message)\n");
+  put("{\n  printf(\"Runtime error at line %%d: %%s\\n\", line, message);\n");
+  put("  exit(1);\n}\n\n");
+  put("static inline int rt_input(int line)\n");
+  put("{\n  int v = 0;\n  fflush(stdout);\n");
+  put("  if (scanf(\"%%d\", &v) != 1) rt_error(line, \"bad input\");\n");
+  put("  return v;\n}\n\n");
+  put("static inline void rt_output(int v)\n");
+  put("{\n  printf(\"%%d\\n\", v);\n}\n\n");
+  put("static inline int rt_add(int a, int b)\n");
+  put("{\n  return (int) ((unsigned) a + (unsigned) b);\n}\n\n");
+  put("static inline int rt_sub(int a, int b)\n");
+  put("{\n  return (int) ((unsigned) a - (unsigned) b);\n}\n\n");
+  put("static inline int rt_mul(int a, int b)\n");
+  put("{\n  return (int) ((unsigned) a * (unsigned) b);\n}\n\n");
+  put("static inline int rt_div(int a, int b, int line)\n");
+  put("{\n  if (b == 0) rt_error(line, \"division by zero\");\n");
+  put("  if (b == -1) return (int) (0u - (unsigned) a);\n");
+  put("  return a / b;\n}\n\n");
+  put("static inline int rt_index(int i, int n, int line)\n");
+  put("{\n  if (i < 0 || i >= n) rt_error(line, \"array subscript out of range\");\n");
+  put("  return i;\n}\n\n");
+}
+
+/* Procedure genExtern declares the variable or
+ * function t imported from another unit
+ */
+static void genExtern(TreeNode * t)
+{ TreeNode * p;
+  int n = 0;
+  addGlobal(t);
+  if (t->kind == varK) {
+    if (arraySize(t) > 0) put("extern int cm_%s[%d];\n",t->attr.name,arraySize(t));
+    else put("extern int cm_%s;\n",t->attr.name);
+    return;
+  }
+  put("extern %s cm_%s(",t->type == Void ? "void" : "int",t->attr.name);
+  for (p = t->child[1]; p != NULL; p = p->sibling) {
+    if (arraySize(p) < 0) continue;
+    if (n++ > 0) put(", ");
+    put(arraySize(p) > 0 ? "int *" : "int");
+  }
+  if (n == 0) put("void");
+  put(");\n");
+}
+
+void transBegin(char * srcfile, char * cfile)
+{ int h;
+  Global g;
+  TreeNode * t;
+  for (h = 0; h < GLOBALS; h++)
+    while ((g = globals[h]) != NULL) {
+      globals[h] = g->next;
+      free(g);
+    }
+  srcName = srcfile;
+  outLine = srcLine = 0;
+  counting = FALSE;
+  indent = 0;
+  nlocals = 0;
+  sawMain = FALSE;
+  put("/* C- compilation to C99 */\n");
+  put("/* File: %s, from %s */\n",cfile,srcfile);
+  put("/* build with: gcc -O2 -o prog %s */\n\n",cfile);
+  put("#include <stdio.h>\n#include <stdlib.h>\n\n");
+  genRuntime();
+  if (unitImports() != NULL) {
+    for (t = unitImports(); t != NULL; t = t->sibling) genExtern(t);
+    put("\n");
+  }
+}
+
+static void genGlobal(TreeNode * t)
+{ startLine(t->lineno);
+  if (arraySize(t) > 0)
+    put("%sint cm_%s[%d];\n",WriteUnit ? "" : "static ",t->attr.name,arraySize(t));
+  else put("%sint cm_%s;\n",WriteUnit ? "" : "static ",t->attr.name);
+}
+
+void transDecl(TreeNode * t)
+{ addGlobal(t);
+  if (t->nodekind == DeclK && t->kind == varK) genGlobal(t);
+  else if (t->nodekind == DeclK && t->kind == funK)
+    genFunction(t);
+}
+
+void transEnd(char * cfile)
+{ /* a unit without main is entered from another */
+  if (WriteUnit && !sawMain) return;
+  /* the rest is only in this file */
+  put("#line %d \"%s\"\n",outLine + 2,cfile);
+  srcLine = 0;
+  put("int main(void)\n{\n  cm_main();\n  return 0;\n}\n");
+}
+
+void transpile(TreeNode * syntaxTree, char * srcfile, char * cfile)
+{ TreeNode * t;
+  TreeNode * p;
+  transBegin(srcfile,cfile);
+  for (t = syntaxTree; t != NULL; t = t->sibling) addGlobal(t);
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind == varK) genGlobal(t);
+  put("\n");
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind == funK && !(t->flags & F_BUILTIN)) {
+      nlocals = 0;
+      for (p = t->child[1]; p != NULL; p = p->sibling)
+        if (arraySize(p) >= 0) addLocal(p);
+      startLine(t->lineno);
+      genHeader(t);
+      put(";\n");
+    }
+  put("\n");
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind == funK && !(t->flags & F_BUILTIN))
+      genFunction(t);
+  transEnd(cfile);
+}
@@ -0,0 +1,27 @@
+/****************************************************/
+/* File: ctrans.h                                   */
+/* C99 code generator interface for the C- compiler */
+/****************************************************/
+
+#ifndef _CTRANS_H_
+#define _CTRANS_H_
+
+/* Procedure transpile writes the analyzed syntax
+ * tree as a self-contained C99 program to the code
+ * file, or with WriteUnit as one C file of several,
+ * declaring what it imports; #line directives refer
+ * every statement to its line in srcfile. cfile is
+ * the name of the code file, used in its comments
+ */
+void transpile(TreeNode * syntaxTree, char * srcfile, char * cfile);
+
+/* transpile is also transBegin, transDecl on each
+ * top-level declaration in order, and transEnd, for
+ * a program written out as it is analyzed; its
+ * functions are then defined without prototypes
+ */
+void transBegin(char * srcfile, char * cfile);
+void transDecl(TreeNode * t);
+void transEnd(char * cfile);
+
+#endif
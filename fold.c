@@ -0,0 +1,199 @@
+/****************************************************/
+/* File: fold.c                                     */
+/* Compile-time evaluation for the C- compiler      */
+/* Pure calls are run by the interpreter; results   */
+/* are shared with the interpreter's call cache     */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "interp.h"
+#include "memo.h"
+#include "callgraph.h"
+#include "fold.h"
+
+/* the list of calls that ran out of budget or hit
+ * a runtime error, so they are not evaluated twice
+ */
+typedef struct FailRec
+{ TreeNode * fun;
+  int * args;
+  struct FailRec * next;
+} * FailList;
+
+static FailList failed = NULL;
+
+/* counters for the report */
+static int folded, cached, over, simplified;
+
+/* depths holds the deepest call depth each function
+ * of the call graph runs at, main running at 1, or
+ * -1 if it may run at any depth; siteDepth is that
+ * of the function being folded
+ */
+static int * depths = NULL;
+static int siteDepth;
+
+/* Procedure callDepths fills depths, callers before
+ * callees. Recursion, or a unit whose functions other
+ * units may call, leaves the depth unbounded
+ */
+static void callDepths(void)
+{ CallGraphNode * n;
+  int i, j, k;
+  depths = (int *) calloc(callGraph.nfuns + 1, sizeof(int));
+  for (k = callGraph.nfuns - 1; k >= 0; k--) {
+    i = callGraph.order[k];
+    n = &callGraph.funs[i];
+    if (strcmp(n->fun->attr.name,"main") == 0) {
+      if (depths[i] == 0) depths[i] = 1;
+    }
+    else if (WriteUnit) depths[i] = -1;
+    if (n->fun->flags & F_RECURSIVE) depths[i] = -1;
+    for (j = 0; j < n->ncallees; j++) {
+      int * d = &depths[n->callees[j]];
+      if (depths[i] < 0) *d = -1;
+      else if (*d >= 0 && *d < depths[i] + 1) *d = depths[i] + 1;
+    }
+  }
+}
+
+/* Function constArgs stores the arguments of call t
+ * in args and returns TRUE if all are constants
+ */
+static int constArgs(TreeNode * t, int * args)
+{ TreeNode * a;
+  int n = 0;
+  for (a = t->child[0]; a != NULL; a = a->sibling) {
+    if (a->nodekind != ExpK || a->kind != ConstK) return FALSE;
+    args[n++] = a->attr.val;
+  }
+  return TRUE;
+}
+
+static int hasFailed(TreeNode * fun, int * args)
+{ FailList f;
+  for (f = failed; f != NULL; f = f->next)
+    if (f->fun == fun &&
+        memcmp(f->args, args, sizeof(int) * paramNum(fun)) == 0)
+      return TRUE;
+  return FALSE;
+}
+
+static void addFailed(TreeNode * fun, int * args)
+{ FailList f = (FailList) malloc(sizeof(struct FailRec));
+  f->fun = fun;
+  f->args = (int *) malloc(sizeof(int) * (paramNum(fun) + 1));
+  memcpy(f->args, args, sizeof(int) * paramNum(fun));
+  f->next = failed;
+  failed = f;
+}
+
+/* Procedure makeConst turns node t into a constant */
+static void makeConst(TreeNode * t, int val)
+{ int i;
+  if (t->nodekind == StmtK) free(t->attr.name);
+  for (i = 0; i < MAXCHILDREN; i++) {
+    freeTree(t->child[i]);
+    t->child[i] = NULL;
+  }
+  t->nodekind = ExpK;
+  t->kind = ConstK;
+  t->attr.val = val;
+  t->type = Integer;
+  t->decl = NULL;
+}
+
+/* Function calcConst computes a constant operation;
+ * it returns FALSE for a division by zero, which is
+ * left for run time
+ */
+static int calcConst(TreeNode * t, int * val)
+{ int a = t->child[0]->attr.val;
+  int b = t->child[2]->attr.val;
+  switch (t->child[1]->attr.op) {
+  case PLUS:  *val = (int) ((unsigned) a + (unsigned) b); break;
+  case MINUS: *val = (int) ((unsigned) a - (unsigned) b); break;
+  case MUL:   *val = (int) ((unsigned) a * (unsigned) b); break;
+  case DIV:
+    if (b == 0) return FALSE;
+    *val = b == -1 ? (int) (0u - (unsigned) a) : a / b;
+    break;
+  case LES: *val = a < b; break;
+  case LEQ: *val = a <= b; break;
+  case BIG: *val = a > b; break;
+  case BEQ: *val = a >= b; break;
+  case EQ:  *val = a == b; break;
+  case NEQ: *val = a != b; break;
+  default: return FALSE;
+  }
+  return TRUE;
+}
+
+static int isConst(TreeNode * t)
+{ return t != NULL && t->nodekind == ExpK && t->kind == ConstK; }
+
+/* Procedure foldNode folds the subtrees of t bottom
+ * up so that nested calls become constant arguments
+ */
+static void foldNode(TreeNode * t)
+{ int i, val;
+  for (; t != NULL; t = t->sibling) {
+    for (i = 0; i < MAXCHILDREN; i++) foldNode(t->child[i]);
+    if (t->nodekind == ExpK && t->kind == CalcK) {
+      if (isConst(t->child[0]) && isConst(t->child[2]) && calcConst(t,&val)) {
+        makeConst(t,val);
+        simplified++;
+      }
+    }
+    else if (t->nodekind == StmtK && t->kind == CallK &&
+             t->decl != NULL && (t->decl->flags & F_PURE) &&
+             t->decl->type == Integer) {
+      int args[paramNum(t->decl) + 1];
+      int height;
+      MemoTable m;
+      if (!constArgs(t,args) || hasFailed(t->decl,args)) continue;
+      /* the call must not overflow the stack where
+       * it runs, nor must any result it reuses, and
+       * its frame must be small enough to build here */
+      if (siteDepth < 0 || cellOffset(t->decl) > FOLDFRAME) {
+        over++;
+        continue;
+      }
+      m = memo_table(t->decl);
+      if (memo_lookup(m,args,&val,&height)) {
+        if (siteDepth + height > MAXCALLDEPTH) {
+          over++;
+          continue;
+        }
+        cached++;
+      }
+      else if (!evalCall(t,siteDepth,FOLDBUDGET,&val)) {
+        addFailed(t->decl,args);
+        over++;
+        continue;
+      }
+      if (TraceAnalyze)
+        fprintf(listing,"  line %d: %s(...) folded to %d\n",t->lineno,t->attr.name,val);
+      makeConst(t,val);
+      folded++;
+    }
+  }
+}
+
+void foldCalls(TreeNode * syntaxTree)
+{ TreeNode * t;
+  folded = cached = over = simplified = 0;
+  if (TraceAnalyze) fprintf(listing,"\nEvaluating constant calls...\n");
+  layoutCells(syntaxTree);
+  callDepths();
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind == funK) {
+      siteDepth = cg_index(t) >= 0 ? depths[cg_index(t)] : -1;
+      foldNode(t->child[2]);
+    }
+  free(depths);
+  depths = NULL;
+  fprintf(listing,"Constant calls folded: %d (%d from cache), left for run time: %d, operations folded: %d\n",
+          folded,cached,over,simplified);
+}
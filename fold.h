@@ -0,0 +1,26 @@
+/****************************************************/
+/* File: fold.h                                     */
+/* Compile-time evaluation interface for the C-     */
+/* compiler                                         */
+/****************************************************/
+
+#ifndef _FOLD_H_
+#define _FOLD_H_
+
+/* FOLDBUDGET is the number of interpreter steps one
+ * call may take before it is left for run time
+ */
+#define FOLDBUDGET 1000000
+
+/* FOLDFRAME is the largest frame, in cells, of a
+ * function whose calls are evaluated at compile time
+ */
+#define FOLDFRAME 65536
+
+/* Procedure foldCalls replaces calls to pure
+ * functions with constant arguments, and operations
+ * on constants, by the constant they evaluate to
+ */
+void foldCalls(TreeNode *);
+
+#endif
@@ -51,22 +51,57 @@ typedef enum {Void,Integer} ExpType;
 
 #define MAXCHILDREN 3
 
+/* A node is packed into a cache line: the kinds, type,
+ * flags and scope share one word. The fields only a
+ * declaration has are in a DeclInfo allocated just
+ * after its node; use the accessors below for them
+ */
 typedef struct treeNode
    { struct treeNode * child[MAXCHILDREN];
      struct treeNode * sibling;
-     int lineno;
-     NodeKind nodekind;
-     union { StmtKind stmt; ExpKind exp; DeclKind decl;} kind;
      union { TokenType op;
        int val;
        int idx;
        char * name; } attr;
-     int paramnum;//for function
-     int array_size;
-     int scope;
-     ExpType type; /* for type checking of exps */
+     struct treeNode * decl; /* declaration an Id or Call refers to */
+     unsigned nodekind : 2; /* NodeKind */
+     unsigned kind : 3; /* StmtKind, ExpKind or DeclKind */
+     unsigned type : 1; /* ExpType, for type checking of exps */
+     unsigned subscript : 1; /* IdK: the variable is subscripted */
+     unsigned flags : 8; /* F_* bits set by later passes */
+     int scope : 16;
+     int lineno;
    } TreeNode;
 
+typedef struct
+   { int paramnum; /* parameters of a function, -1 for other decls */
+     int array_size; /* elements of an array, 1 for an array param, 0 for a
+                       scalar, -1 for the void of an empty param list */
+     int offset; /* cell offset of a variable, frame size of a function */
+   } DeclInfo;
+
+/* declInfo(t) is the DeclInfo of declaration node t */
+#define declInfo(t) ((DeclInfo *) ((t) + 1))
+
+/* paramNum, arraySize and cellOffset read those fields
+ * of any node: a node that is not a declaration has no
+ * parameters, no offset, and an array size of 1 if it
+ * is a subscripted variable, else 0
+ */
+#define paramNum(t) ((t)->nodekind == DeclK ? declInfo(t)->paramnum : -1)
+#define arraySize(t) \
+  ((t)->nodekind == DeclK ? declInfo(t)->array_size : (int) (t)->subscript)
+#define cellOffset(t) ((t)->nodekind == DeclK ? declInfo(t)->offset : 0)
+
+/* bits of TreeNode flags */
+#define F_PURE    0x01 /* funK: no side effects, result depends on args only */
+#define F_BUILTIN 0x02 /* funK: predefined input/output */
+#define F_RECURSIVE 0x04 /* funK: part of a call cycle */
+#define F_INBOUNDS 0x08 /* IdK: subscript proven within the array */
+#define F_FORK    0x10 /* CalcK: operands are independent pure calls */
+#define F_EXTERN  0x20 /* funK/varK: imported from another unit */
+#define F_LINKED  0x40 /* funK/varK: imported and referred to */
+
 #define MAXSTACKSIZE 500
 #define STRINGSIZE 50
 
@@ -108,6 +143,141 @@ extern int TraceAnalyze;
  */
 extern int TraceCode;
 
+/* Execute = TRUE causes the analyzed program to be
+ * run by the interpreter after type checking
+ */
+extern int Execute;
+
+/* MemoCalls = TRUE causes the interpreter to cache
+ * results of calls to pure functions
+ */
+extern int MemoCalls;
+
+/* ParallelCalls = N (when not 0) causes the
+ * interpreter to evaluate independent pure calls of
+ * an expression on N threads, as long as the
+ * recursion is less than ForkDepth calls deep
+ */
+extern int ParallelCalls;
+extern int ForkDepth;
+
+/* Profile = TRUE causes the interpreter to sample
+ * the running C- calls and lines, print the
+ * profiles and write folded stacks to <name>.folded
+ */
+extern int Profile;
+
+/* FoldCalls = TRUE causes calls to pure functions
+ * with constant arguments to be evaluated while
+ * compiling
+ */
+extern int FoldCalls;
+
+/* InlineCalls = TRUE causes small non-recursive
+ * functions to be inlined at their call sites
+ */
+extern int InlineCalls;
+
+/* Incremental = TRUE causes functions unchanged
+ * since the last compilation to be taken, parsed
+ * and analyzed, from the directory <name>.cache,
+ * which is then brought up to date
+ */
+extern int Incremental;
+
+/* WriteAst = TRUE causes the analyzed syntax tree
+ * and its symbols to be written to <name>.ast in a
+ * binary form that tools can map into memory
+ */
+extern int WriteAst;
+
+/* Streaming = TRUE causes each top-level declaration
+ * to be analyzed, and written out with EmitC, as
+ * soon as it is parsed; the body of a function is
+ * then freed, so memory does not grow with the
+ * length of the source
+ */
+extern int Streaming;
+
+/* PushInput = TRUE causes the source to be read in
+ * chunks of whatever has arrived and its tokens to be
+ * pushed to the parser, so that a pipe is parsed
+ * while its writer is still producing it
+ */
+extern int PushInput;
+
+/* ScanThread = TRUE causes the source to be read and
+ * scanned as with PushInput, but on a thread of its
+ * own, while the parser takes the tokens
+ */
+extern int ScanThread;
+
+/* LexThreads > 0 causes the source file to be cut
+ * into chunks that are scanned on up to LexThreads
+ * threads at once before they are parsed in order
+ */
+extern int LexThreads;
+
+/* HandParser = TRUE causes the source to be parsed by
+ * the hand-written parser instead of the Bison one
+ */
+extern int HandParser;
+
+/* DumpCallGraph = 1 (DOT) or 2 (JSON) causes the
+ * call graph to be written to the listing file
+ */
+extern int DumpCallGraph;
+
+/* EmitCode = TRUE causes x86-64 assembly to be
+ * written to a .s file next to the source
+ */
+extern int EmitCode;
+
+/* EmitC = TRUE causes the program to be written as
+ * C99 to a .gen.c file, with #line directives
+ * pointing back at the source
+ */
+extern int EmitC;
+
+/* WriteUnit = TRUE causes the program to be compiled
+ * as a unit of a larger one: every function is kept
+ * and visible to other units, main is the entry
+ * point only if the unit defines it, and a summary
+ * of its interface is written to a .cmi file
+ */
+extern int WriteUnit;
+
+/* LoopOpt = TRUE causes array accesses in loops to
+ * be strength reduced and small counted loops to be
+ * unrolled UnrollFactor times (1 for no unrolling)
+ */
+extern int LoopOpt;
+extern int UnrollFactor;
+
+/* VectorISA = 1 (SSE2) or 2 (AVX2) causes simple
+ * array loops to be vectorized for that target
+ */
+extern int VectorISA;
+
+/* Instrument = TRUE causes the emitted code to
+ * count the executions of every block, if branch
+ * and loop body, and to write the counts by source
+ * line to <name>.counts when the program exits
+ */
+extern int Instrument;
+
+/* ProfileUse = TRUE causes the counts read from a
+ * file written by instrumented code to guide
+ * inlining, the layout of ifs, loop unrolling and
+ * register allocation
+ */
+extern int ProfileUse;
+
+/* Peephole = TRUE causes the emitted instructions
+ * to be improved by the peephole optimizer
+ */
+extern int Peephole;
+
 /* Error = TRUE prevents further passes if an error occurs */
 extern int Error; 
 #endif
@@ -0,0 +1,753 @@
+/****************************************************/
+/* File: incr.c                                     */
+/* Incremental recompilation for the C- compiler    */
+/* The source is split into its top-level           */
+/* declarations before it is parsed. A function     */
+/* whose text is in the cache is not parsed: its    */
+/* tree is read back, and if the declarations it    */
+/* refers to are unchanged its analysis is replayed */
+/* as well (declaration links, types, its part of   */
+/* the symbol table listing and its diagnostics).   */
+/* Lines are kept relative to the first line of the */
+/* function, so a function moved by edits above it  */
+/* is still reused.                                 */
+/****************************************************/
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "incr.h"
+
+#define CACHEHEADER "# C- analysis cache 1\n"
+
+#define FNVBASIS 14695981039346656037UL
+#define FNVPRIME 1099511628211UL
+
+/* NBUCKETS is the size of the table of cache
+ * entries, hashed by the text of the function
+ */
+#define NBUCKETS 1024
+
+/* the cached tree and analysis of a function */
+typedef struct EntryRec
+{ char * name;
+  unsigned long hash;   /* of the text of the function */
+  unsigned long deps;   /* of the declarations its analysis used */
+  int locAfter;         /* location counter after the function */
+  int error;            /* TRUE if it had type errors */
+  char * uses;          /* names it refers to outside itself */
+  char * marks;         /* offset, line and width of each line number */
+  char * listing;       /* its listing without the line numbers */
+  int nlisting;
+  char * nodes;         /* one node per line, in preorder */
+  int nnodes, nbytes;
+  struct EntryRec * next;  /* in its bucket */
+  struct EntryRec * link;  /* in the cache directory */
+  int keep;                /* still a function of the source */
+} * Entry;
+
+/* the fields of a cached node set by the analyzer */
+typedef struct
+{ int scope;
+  int type;
+  int paramnum;
+  int decl;   /* preorder index of the declaration */
+} Post;
+
+#define DECLNONE   (-1)
+#define DECLGLOBAL (-2)   /* looked up by name */
+
+/* a top-level declaration of the source */
+typedef struct
+{ int start, end;     /* byte offsets */
+  int lineno;         /* of its first token */
+  int complete;       /* ends with ; or } */
+  int isFun;
+  char name[STRINGSIZE];
+  unsigned long hash;
+  Entry entry;        /* cached function with the same text */
+  Entry fresh;        /* analysis recorded this time */
+  int reused;
+  int parsed;         /* cached, but parsed all the same */
+  char * why;         /* why it was analyzed */
+  TreeNode * node;
+  TreeNode ** nodes;  /* cached tree in preorder */
+  Post * post;
+  int nnodes;
+} Span;
+
+static char * cacheName;   /* the cache directory */
+static Entry buckets[NBUCKETS];
+static Entry entries = NULL;
+
+static char * src = NULL;
+static int srclen = 0;
+static char * blanked = NULL;
+
+static Span * spans = NULL;
+static int nspans = 0, maxspans = 0;
+static int cursor = 0;
+static int nreused = 0;
+
+/* the function being recorded */
+static int recording = FALSE;
+static Span * recSpan;
+static int recLocation, recError, recBase;
+static FILE * savedListing;
+static char * recText;
+static size_t recSize;
+static FILE * recMarks;
+static char * recMarkText;
+static size_t recMarkSize;
+
+/* its nodes in preorder, with their types and
+ * parameter counts before the analysis */
+static TreeNode ** recNodes = NULL;
+static int * recType = NULL;
+static int * recParamnum = NULL;
+static int nrec = 0, maxrec = 0;
+
+/* preorder index of a node, by address */
+static TreeNode ** mapKeys = NULL;
+static int * mapVals = NULL;
+static int mapSize = 0;
+
+static unsigned long hashBytes(unsigned long h, char * s, int n)
+{ while (n-- > 0) h = (h ^ (unsigned char) *s++) * FNVPRIME;
+  return h;
+}
+
+static unsigned long hashInt(unsigned long h, int v)
+{ return hashBytes(h,(char *) &v,sizeof(v)); }
+
+/* Function isNamed is TRUE if attr of t holds a name */
+static int isNamed(TreeNode * t)
+{ if (t->nodekind == ExpK) return t->kind == IdK;
+  if (t->nodekind == StmtK) return t->kind == CallK;
+  return t->kind != paramK || arraySize(t) >= 0;
+}
+
+static Entry findEntry(char * name, unsigned long hash)
+{ Entry e;
+  for (e = buckets[hash % NBUCKETS]; e != NULL; e = e->next)
+    if (e->hash == hash && strcmp(e->name,name) == 0) return e;
+  return NULL;
+}
+
+static int knownName(char * name)
+{ Entry e;
+  for (e = entries; e != NULL; e = e->link)
+    if (strcmp(e->name,name) == 0) return TRUE;
+  return FALSE;
+}
+
+/* Function entryFile returns the name of the file
+ * caching function name of text hash
+ */
+static char * entryFile(char * name, unsigned long hash, char * suffix)
+{ char * file = (char *) malloc(strlen(cacheName) + strlen(name) + 24);
+  sprintf(file,"%s/%s.%016lx%s",cacheName,name,hash,suffix);
+  return file;
+}
+
+/* Procedure loadIndex lists the functions in the
+ * cache directory; a file is read only when the
+ * source has a function of the same text
+ */
+static void loadIndex(void)
+{ DIR * dir = opendir(cacheName);
+  struct dirent * d;
+  char name[STRINGSIZE];
+  unsigned long hash;
+  int n;
+  Entry e;
+  if (dir == NULL) return;
+  while ((d = readdir(dir)) != NULL) {
+    if (sscanf(d->d_name,"%49[a-zA-Z].%16lx%n",name,&hash,&n) != 2 || d->d_name[n] != '\0')
+      continue;
+    e = (Entry) calloc(1, sizeof(struct EntryRec));
+    e->name = copyString(name);
+    e->hash = hash;
+    e->next = buckets[hash % NBUCKETS];
+    buckets[hash % NBUCKETS] = e;
+    e->link = entries;
+    entries = e;
+  }
+  closedir(dir);
+}
+
+/* Function readEntry reads the file of e. It returns
+ * FALSE if the file is of another version, cut short
+ * or not for e
+ */
+static int readEntry(Entry e)
+{ char * file = entryFile(e->name,e->hash,"");
+  FILE * in = fopen(file,"r");
+  char name[STRINGSIZE];
+  char * buf;
+  char * p;
+  char * q;
+  char * end;
+  unsigned long hash;
+  long size;
+  free(file);
+  if (in == NULL) return FALSE;
+  fseek(in,0,SEEK_END);
+  size = ftell(in);
+  rewind(in);
+  buf = (char *) malloc(size + 1);
+  size = fread(buf,1,size,in);
+  buf[size] = '\0';
+  fclose(in);
+  end = buf + size;
+  p = buf + strlen(CACHEHEADER);
+  if (strncmp(buf,CACHEHEADER,strlen(CACHEHEADER)) != 0 ||
+      (q = memchr(p,'\n',end - p)) == NULL)
+    return FALSE;
+  *q = '\0';
+  if (sscanf(p,"fun %49s %lx %lx %d %d %d %d %d",name,&hash,&e->deps,&e->locAfter,
+             &e->error,&e->nlisting,&e->nnodes,&e->nbytes) != 8 ||
+      strcmp(name,e->name) != 0 || hash != e->hash)
+    return FALSE;
+  p = q + 1;
+  if ((q = memchr(p,'\n',end - p)) == NULL) return FALSE;
+  *q = '\0';
+  e->uses = p;
+  p = q + 1;
+  if ((q = memchr(p,'\n',end - p)) == NULL) return FALSE;
+  *q = '\0';
+  e->marks = p;
+  p = q + 1;
+  if (e->nlisting < 0 || e->nbytes < 0 || end - p != (long) e->nlisting + e->nbytes) return FALSE;
+  e->listing = p;
+  e->nodes = p + e->nlisting;
+  return TRUE;
+}
+
+/* Function skipBlank returns the offset of the next
+ * token of the source after i, counting lines
+ */
+static int skipBlank(int i, int * line)
+{ while (i < srclen) {
+    if (src[i] == '\n') (*line)++;
+    else if (src[i] == '/' && i + 1 < srclen && src[i+1] == '*') {
+      for (i += 2; i < srclen && !(src[i] == '*' && i + 1 < srclen && src[i+1] == '/'); i++)
+        if (src[i] == '\n') (*line)++;
+      i++;
+    }
+    else if (!isspace((unsigned char) src[i])) break;
+    i++;
+  }
+  return i;
+}
+
+/* Procedure splitSource finds the top-level
+ * declarations: each ends with a ; or with the }
+ * closing its outermost brace
+ */
+static void splitSource(void)
+{ int i = 0, line = 1, j, depth, done;
+  char last[STRINGSIZE];
+  Span * s;
+  for (;;) {
+    i = skipBlank(i,&line);
+    if (i >= srclen) break;
+    if (nspans == maxspans) {
+      maxspans = maxspans ? 2 * maxspans : 64;
+      spans = (Span *) realloc(spans, sizeof(Span) * maxspans);
+    }
+    s = &spans[nspans++];
+    memset(s,0,sizeof(Span));
+    s->start = i;
+    s->lineno = line;
+    last[0] = '\0';
+    depth = 0;
+    done = FALSE;
+    while (!done && i < srclen) {
+      char c = src[i];
+      if (isalpha((unsigned char) c)) {
+        for (j = i; j < srclen && isalpha((unsigned char) src[j]); j++)
+          ;
+        if (depth == 0 && j - i < STRINGSIZE) {
+          memcpy(last,src + i,j - i);
+          last[j - i] = '\0';
+        }
+        i = j;
+        continue;
+      }
+      if (c == '/' && i + 1 < srclen && src[i+1] == '*') {
+        i = skipBlank(i,&line);
+        continue;
+      }
+      if (c == '\n') line++;
+      else if (depth == 0 && (c == '(' || c == '[') && s->name[0] == '\0') {
+        strcpy(s->name,last);
+        s->isFun = c == '(';
+      }
+      else if (depth == 0 && c == ';') done = TRUE;
+      else if (c == '{') depth++;
+      else if (c == '}' && --depth <= 0) done = TRUE;
+      i++;
+    }
+    if (s->name[0] == '\0') strcpy(s->name,last);
+    s->end = i;
+    s->complete = done;
+    s->hash = hashBytes(FNVBASIS,src + s->start,s->end - s->start);
+  }
+}
+
+static FILE * openBuffer(char * buf)
+{ if (srclen == 0) return tmpfile();
+  return fmemopen(buf,srclen,"r");
+}
+
+FILE * incrOpen(FILE * in, char * cachedir)
+{ size_t n, max = 1 << 16;
+  int i, k;
+  Span * s;
+  src = (char *) malloc(max);
+  while ((n = fread(src + srclen,1,max - srclen,in)) > 0) {
+    srclen += n;
+    if ((size_t) srclen == max) src = (char *) realloc(src, max *= 2);
+  }
+  fclose(in);
+  cacheName = cachedir;
+  loadIndex();
+  splitSource();
+  blanked = (char *) malloc(srclen + 1);
+  memcpy(blanked,src,srclen);
+  for (k = 0; k < nspans; k++) {
+    s = &spans[k];
+    if (!s->isFun || !s->complete) continue;
+    s->entry = findEntry(s->name,s->hash);
+    if (s->entry != NULL) s->entry->keep = TRUE;
+    if (s->entry != NULL && !readEntry(s->entry)) s->entry = NULL;
+    if (s->entry == NULL) {
+      s->why = knownName(s->name) ? "changed" : "new";
+      continue;
+    }
+    for (i = s->start; i < s->end; i++)
+      if (blanked[i] != '\n') blanked[i] = ' ';
+  }
+  /* the grammar wants one declaration at least */
+  for (k = 0, s = NULL; k < nspans; k++) {
+    if (spans[k].entry == NULL) break;
+    if (s == NULL || spans[k].end - spans[k].start < s->end - s->start) s = &spans[k];
+  }
+  if (k == nspans && s != NULL) {
+    memcpy(blanked + s->start,src + s->start,s->end - s->start);
+    s->parsed = TRUE;
+  }
+  return openBuffer(blanked);
+}
+
+FILE * incrSource(void)
+{ return openBuffer(src); }
+
+/* Function field reads the next number of a node
+ * line; strtol is noticeably slower on large caches
+ */
+static long field(char ** p)
+{ char * q = *p;
+  long v = 0;
+  int neg = FALSE;
+  while (*q == ' ') q++;
+  if (*q == '-') { neg = TRUE; q++; }
+  while (*q >= '0' && *q <= '9') v = v * 10 + (*q++ - '0');
+  *p = q;
+  return neg ? -v : v;
+}
+
+/* Function build links the nodes of a cached tree
+ * from index *k on, each followed by its children
+ * and then its next sibling
+ */
+static TreeNode * build(Span * s, int * mask, int * k)
+{ TreeNode * first = NULL;
+  TreeNode ** tail = &first;
+  TreeNode * t;
+  int i, m;
+  do {
+    if (*k >= s->nnodes) return NULL;
+    t = s->nodes[*k];
+    m = mask[(*k)++];
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (m & (1 << i)) {
+        if ((t->child[i] = build(s,mask,k)) == NULL) return NULL;
+      }
+    *tail = t;
+    tail = &t->sibling;
+  } while (m & (1 << MAXCHILDREN));
+  return first;
+}
+
+/* Function readTree makes the tree of the cached
+ * function of s, as the parser left it; the fields
+ * set by the analyzer wait in s->post
+ */
+static TreeNode * readTree(Span * s)
+{ Entry e = s->entry;
+  char * p = e->nodes;
+  char * end = e->nodes + e->nbytes;
+  char * name;
+  int * mask;
+  int k, n, kind, size, paramnum;
+  TreeNode * t;
+  if (e->nnodes <= 0) return NULL;
+  s->nnodes = e->nnodes;
+  s->nodes = (TreeNode **) malloc(sizeof(TreeNode *) * s->nnodes);
+  s->post = (Post *) malloc(sizeof(Post) * s->nnodes);
+  mask = (int *) malloc(sizeof(int) * s->nnodes);
+  for (k = 0; k < s->nnodes; k++) {
+    if (p >= end) return NULL;
+    kind = field(&p);
+    t = (TreeNode *) calloc(1, sizeof(TreeNode) +
+                               (kind == DeclK ? sizeof(DeclInfo) : 0));
+    t->nodekind = (NodeKind) kind;
+    t->kind = (ExpKind) field(&p);
+    t->lineno = s->lineno + field(&p);
+    mask[k] = field(&p);
+    size = field(&p);
+    t->type = (ExpType) field(&p);
+    paramnum = field(&p);
+    if (t->nodekind == DeclK) {
+      declInfo(t)->array_size = size;
+      declInfo(t)->paramnum = paramnum;
+    }
+    else t->subscript = size != 0;
+    s->post[k].scope = field(&p);
+    s->post[k].type = field(&p);
+    s->post[k].paramnum = field(&p);
+    s->post[k].decl = field(&p);
+    if (isNamed(t)) {
+      if (*p++ != ' ') return NULL;
+      for (name = p; isalpha((unsigned char) *p); p++) ;
+      if ((n = p - name) == 0 || n >= STRINGSIZE) return NULL;
+      t->attr.name = (char *) malloc(n + 1);
+      memcpy(t->attr.name,name,n);
+      t->attr.name[n] = '\0';
+    }
+    else t->attr.val = field(&p);
+    if (*p++ != '\n') return NULL;
+    s->nodes[k] = t;
+  }
+  k = 0;
+  t = build(s,mask,&k);
+  free(mask);
+  return k == s->nnodes ? t : NULL;
+}
+
+TreeNode * incrSplice(TreeNode * syntaxTree)
+{ TreeNode * head = NULL;
+  TreeNode ** tail = &head;
+  TreeNode * t = syntaxTree;
+  TreeNode * node;
+  int k;
+  for (k = 0; k < nspans; k++) {
+    if (spans[k].entry != NULL) {
+      if ((node = readTree(&spans[k])) == NULL) return NULL;
+      if (spans[k].parsed) {
+        if (t == NULL || strcmp(t->attr.name,spans[k].name) != 0) return NULL;
+        t = t->sibling;
+      }
+    }
+    else {
+      if (t == NULL || strcmp(t->attr.name,spans[k].name) != 0) return NULL;
+      node = t;
+      t = t->sibling;
+    }
+    spans[k].node = node;
+    *tail = node;
+    tail = &node->sibling;
+  }
+  if (t != NULL) return NULL;
+  *tail = NULL;
+  return head;
+}
+
+static Span * findSpan(TreeNode * t)
+{ int k;
+  for (k = cursor; k < nspans; k++)
+    if (spans[k].node == t) {
+      cursor = k;
+      return &spans[k];
+    }
+  return NULL;
+}
+
+/* Function depHash hashes what the analysis of a
+ * function takes from outside it: the declarations
+ * of the names it uses, the location counter at its
+ * start and whether it comes last
+ */
+static unsigned long depHash(char * uses, int location, int last)
+{ unsigned long h = hashInt(hashInt(FNVBASIS,location),last);
+  char name[STRINGSIZE];
+  BucketList l;
+  TreeNode * d;
+  TreeNode * p;
+  int n;
+  while (*uses) {
+    for (n = 0; uses[n] && uses[n] != ' ' && n < STRINGSIZE - 1; n++)
+      name[n] = uses[n];
+    name[n] = '\0';
+    uses += n;
+    while (*uses == ' ') uses++;
+    h = hashBytes(h,name,n + 1);
+    if ((l = st_type_lookup(name)) == NULL) {
+      h = hashInt(h,-1);
+      continue;
+    }
+    d = l->tnode_p;
+    h = hashInt(hashInt(hashInt(h,l->scope),d->kind),d->type);
+    h = hashInt(h,paramNum(d));
+    if (d->kind != funK) h = hashInt(h,arraySize(d));
+    else
+      for (p = d->child[1]; p != NULL; p = p->sibling)
+        h = hashInt(hashInt(h,arraySize(p)),p->type);
+  }
+  return h;
+}
+
+/* Procedure replay writes a recorded listing with
+ * its line numbers counted from base
+ */
+static void replay(char * text, int n, char * marks, int base)
+{ char * p = marks;
+  char * q;
+  long off, rel, width;
+  long done = 0;
+  for (;;) {
+    off = strtol(p,&q,10);
+    if (q == p) break;
+    rel = strtol(q,&p,10);
+    width = strtol(p,&q,10);
+    p = q;
+    if (off < done || off > n) break;
+    fwrite(text + done,1,off - done,listing);
+    fprintf(listing,"%*ld",(int) width,base + rel);
+    done = off;
+  }
+  fwrite(text + done,1,n - done,listing);
+}
+
+static int isGlobal(char * name)
+{ BucketList l = st_type_lookup(name);
+  return l != NULL && l->scope <= 0;
+}
+
+int incrReuse(TreeNode * t, int * location)
+{ Span * s = findSpan(t);
+  Entry e;
+  TreeNode * n;
+  int k, d;
+  if (s == NULL || (e = s->entry) == NULL || s->nodes == NULL) return FALSE;
+  s->why = "dependencies";
+  if (depHash(e->uses,*location,t->sibling == NULL) != e->deps) return FALSE;
+  for (k = 0; k < s->nnodes; k++)
+    if (s->post[k].decl == DECLGLOBAL && !isGlobal(s->nodes[k]->attr.name)) return FALSE;
+  for (k = 0; k < s->nnodes; k++) {
+    n = s->nodes[k];
+    n->scope = s->post[k].scope;
+    n->type = (ExpType) s->post[k].type;
+    if (n->nodekind == DeclK) declInfo(n)->paramnum = s->post[k].paramnum;
+    d = s->post[k].decl;
+    if (d == DECLGLOBAL) n->decl = st_type_lookup(n->attr.name)->tnode_p;
+    else if (d >= 0 && d < s->nnodes) n->decl = s->nodes[d];
+    else n->decl = NULL;
+  }
+  replay(e->listing,e->nlisting,e->marks,s->lineno);
+  /* the uses of globals go into their line lists */
+  for (k = 0; k < s->nnodes; k++) {
+    n = s->nodes[k];
+    if (n->nodekind == ExpK && n->kind == IdK && n->decl != NULL && n->decl->scope <= 0)
+      st_insert(n,0,0);
+  }
+  *location = e->locAfter;
+  if (e->error) Error = TRUE;
+  s->reused = TRUE;
+  s->why = NULL;
+  nreused++;
+  return TRUE;
+}
+
+static void addRec(TreeNode * t)
+{ if (nrec == maxrec) {
+    maxrec = maxrec ? 2 * maxrec : 256;
+    recNodes = (TreeNode **) realloc(recNodes, sizeof(TreeNode *) * maxrec);
+    recType = (int *) realloc(recType, sizeof(int) * maxrec);
+    recParamnum = (int *) realloc(recParamnum, sizeof(int) * maxrec);
+  }
+  recNodes[nrec] = t;
+  recType[nrec] = t->type;
+  recParamnum[nrec] = paramNum(t);
+  nrec++;
+}
+
+/* Procedure collect adds the nodes of t and its
+ * siblings in preorder
+ */
+static void collect(TreeNode * t)
+{ int i;
+  for (; t != NULL; t = t->sibling) {
+    addRec(t);
+    for (i = 0; i < MAXCHILDREN; i++) collect(t->child[i]);
+  }
+}
+
+static unsigned mapSlot(TreeNode * t)
+{ return (unsigned) (((unsigned long) t >> 4) * 2654435761UL) & (mapSize - 1); }
+
+static void buildMap(void)
+{ int k;
+  unsigned h;
+  if (mapSize < 2 * nrec) {
+    while (mapSize < 2 * nrec) mapSize = mapSize ? 2 * mapSize : 512;
+    mapKeys = (TreeNode **) realloc(mapKeys, sizeof(TreeNode *) * mapSize);
+    mapVals = (int *) realloc(mapVals, sizeof(int) * mapSize);
+  }
+  memset(mapKeys,0,sizeof(TreeNode *) * mapSize);
+  for (k = 0; k < nrec; k++) {
+    for (h = mapSlot(recNodes[k]); mapKeys[h] != NULL; h = (h + 1) & (mapSize - 1))
+      ;
+    mapKeys[h] = recNodes[k];
+    mapVals[h] = k;
+  }
+}
+
+static int mapFind(TreeNode * t)
+{ unsigned h;
+  for (h = mapSlot(t); mapKeys[h] != NULL; h = (h + 1) & (mapSize - 1))
+    if (mapKeys[h] == t) return mapVals[h];
+  return -1;
+}
+
+void incrBegin(TreeNode * t, int location)
+{ int i;
+  if ((recSpan = findSpan(t)) == NULL) return;
+  recording = TRUE;
+  recLocation = location;
+  recError = Error;
+  Error = FALSE;
+  recBase = recSpan->lineno;
+  nrec = 0;
+  addRec(t);
+  for (i = 0; i < MAXCHILDREN; i++) collect(t->child[i]);
+  savedListing = listing;
+  listing = open_memstream(&recText,&recSize);
+  recMarks = open_memstream(&recMarkText,&recMarkSize);
+}
+
+void listLine(int lineno, int width)
+{ if (recording)
+    fprintf(recMarks,"%ld %d %d ",ftell(listing),lineno - recBase,width);
+  else fprintf(listing,"%*d",width,lineno);
+}
+
+void incrEnd(TreeNode * t, int location)
+{ Entry e;
+  FILE * out;
+  TreeNode * n;
+  char ** uses = NULL;
+  int nuses = 0, k, j, mask, d;
+  size_t size;
+  if (!recording) return;
+  recording = FALSE;
+  fclose(listing);
+  fclose(recMarks);
+  listing = savedListing;
+  replay(recText,recSize,recMarkText,recBase);
+  e = (Entry) calloc(1, sizeof(struct EntryRec));
+  e->name = copyString(recSpan->name);
+  e->hash = recSpan->hash;
+  e->locAfter = location;
+  e->error = Error;
+  if (recError) Error = TRUE;
+  e->listing = recText;
+  e->nlisting = recSize;
+  e->marks = recMarkText;
+  e->nnodes = nrec;
+  buildMap();
+  uses = (char **) malloc(sizeof(char *) * nrec);
+  out = open_memstream(&e->nodes,&size);
+  for (k = 0; k < nrec; k++) {
+    n = recNodes[k];
+    mask = 0;
+    for (j = 0; j < MAXCHILDREN; j++)
+      if (n->child[j] != NULL) mask |= 1 << j;
+    if (k > 0 && n->sibling != NULL) mask |= 1 << MAXCHILDREN;
+    d = DECLNONE;
+    if (n->decl != NULL && (d = mapFind(n->decl)) < 0) d = DECLGLOBAL;
+    /* names looked up outside the function */
+    if (isNamed(n) && n->nodekind != DeclK && d < 0) {
+      for (j = 0; j < nuses && strcmp(uses[j],n->attr.name) != 0; j++)
+        ;
+      if (j == nuses) uses[nuses++] = n->attr.name;
+    }
+    fprintf(out,"%d %d %d %d %d %d %d %d %d %d %d ",n->nodekind,n->kind,
+            n->lineno - recBase,mask,arraySize(n),recType[k],recParamnum[k],
+            n->scope,n->type,paramNum(n),d);
+    if (isNamed(n)) fprintf(out,"%s\n",n->attr.name);
+    else fprintf(out,"%d\n",n->attr.val);
+  }
+  fclose(out);
+  e->nbytes = size;
+  out = open_memstream(&e->uses,&size);
+  for (j = 0; j < nuses; j++) fprintf(out,j ? " %s" : "%s",uses[j]);
+  fclose(out);
+  free(uses);
+  e->deps = depHash(e->uses,recLocation,t->sibling == NULL);
+  recSpan->fresh = e;
+}
+
+/* Procedure writeEntry writes the file of e; the
+ * file is replaced whole, never seen half written
+ */
+static void writeEntry(Entry e)
+{ char * tmp = entryFile(e->name,e->hash,".tmp");
+  char * file = entryFile(e->name,e->hash,"");
+  FILE * out = fopen(tmp,"w");
+  if (out != NULL) {
+    fprintf(out,"%sfun %s %lx %lx %d %d %d %d %d\n%s\n%s\n",CACHEHEADER,e->name,e->hash,
+            e->deps,e->locAfter,e->error,e->nlisting,e->nnodes,e->nbytes,e->uses,e->marks);
+    fwrite(e->listing,1,e->nlisting,out);
+    fwrite(e->nodes,1,e->nbytes,out);
+  }
+  if (out == NULL || fclose(out) != 0 || rename(tmp,file) != 0)
+    fprintf(listing,"Unable to write %s\n",file);
+  free(tmp);
+  free(file);
+}
+
+void incrSave(void)
+{ Entry e;
+  char * file;
+  int k;
+  mkdir(cacheName,0777);
+  for (k = 0; k < nspans; k++)
+    if (spans[k].fresh != NULL) writeEntry(spans[k].fresh);
+  /* earlier versions of the functions go */
+  for (e = entries; e != NULL; e = e->link)
+    if (!e->keep) {
+      file = entryFile(e->name,e->hash,"");
+      remove(file);
+      free(file);
+    }
+}
+
+void incrReport(FILE * out)
+{ int k, nfuns = 0, first = TRUE;
+  for (k = 0; k < nspans; k++)
+    if (spans[k].isFun && spans[k].node != NULL) nfuns++;
+  fprintf(out,"\nCache %s: %d of %d functions reused (%d%%)\n",cacheName,nreused,nfuns,
+          nfuns ? 100 * nreused / nfuns : 100);
+  for (k = 0; k < nspans; k++) {
+    if (!spans[k].isFun || spans[k].node == NULL || spans[k].reused) continue;
+    fprintf(out,first ? "  analyzed:" : ",");
+    fprintf(out," %s (%s)",spans[k].name,spans[k].why ? spans[k].why : "new");
+    first = FALSE;
+  }
+  if (!first) fprintf(out,"\n");
+}
@@ -0,0 +1,64 @@
+/****************************************************/
+/* File: incr.h                                     */
+/* Incremental recompilation interface for the C-   */
+/* compiler: the trees and analysis of functions    */
+/* unchanged since the last compilation are taken   */
+/* from a cache directory next to the source,      */
+/* one file per function                            */
+/****************************************************/
+
+#ifndef _INCR_H_
+#define _INCR_H_
+
+/* Function incrOpen reads the whole source in and
+ * the cached functions of the same text from the
+ * directory cachedir, if there is one, and returns
+ * the source to parse: the functions found in the
+ * cache are blanked out, keeping their lines
+ */
+FILE * incrOpen(FILE * in, char * cachedir);
+
+/* Function incrSplice puts the cached functions back
+ * among the declarations parsed. It returns NULL if
+ * they do not line up with the source, after which
+ * incrSource gives the source to parse in full
+ */
+TreeNode * incrSplice(TreeNode * syntaxTree);
+FILE * incrSource(void);
+
+/* Function incrReuse replays the analysis of function
+ * t from the cache if the declarations it refers to
+ * are unchanged; location is the location counter of
+ * the analyzer, set to its value after t. It returns
+ * FALSE if t has to be analyzed
+ */
+int incrReuse(TreeNode * t, int * location);
+
+/* Procedures incrBegin and incrEnd record the
+ * analysis of function t done between them for the
+ * cache; location is the location counter after the
+ * declaration of t and after its body
+ */
+void incrBegin(TreeNode * t, int location);
+void incrEnd(TreeNode * t, int location);
+
+/* Procedure listLine prints line number lineno to the
+ * listing in width columns (0 for as many as needed).
+ * While a function is recorded, the place is noted
+ * instead, so that the listing can be replayed for
+ * the function at another line
+ */
+void listLine(int lineno, int width);
+
+/* Procedure incrSave writes the cache files of the
+ * functions analyzed this time and removes those of
+ * functions no longer in the program
+ */
+void incrSave(void);
+
+/* Procedure incrReport prints how many functions were
+ * reused and why the others were analyzed
+ */
+void incrReport(FILE * out);
+
+#endif
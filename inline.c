@@ -0,0 +1,351 @@
+/****************************************************/
+/* File: inline.c                                   */
+/* Function inliner for the C- compiler             */
+/* A call standing as a statement, as the right of  */
+/* an assignment or as a returned value is replaced */
+/* by a compound statement holding renamed copies   */
+/* of the callee's parameters, locals and body      */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "callgraph.h"
+#include "pgo.h"
+#include "inline.h"
+
+/* number of inlined call sites, also used to give
+ * copied variables unique names
+ */
+static int ninlined = 0;
+
+/* nodes added to the current caller */
+static int growth;
+
+/* the declarations of the callee being copied and
+ * their replacements in the caller; inlinable takes
+ * no callee declaring more names
+ */
+#define MAXRENAME 256
+static TreeNode * oldDecl[MAXRENAME];
+static TreeNode * newDecl[MAXRENAME];
+static int nrenamed;
+
+static int treeSize(TreeNode * t)
+{ int i, n = 0;
+  for (; t != NULL; t = t->sibling) {
+    n++;
+    for (i = 0; i < MAXCHILDREN; i++) n += treeSize(t->child[i]);
+  }
+  return n;
+}
+
+static int countReturns(TreeNode * t)
+{ int i, n = 0;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == StmtK && t->kind == ReturnK) n++;
+    for (i = 0; i < MAXCHILDREN; i++) n += countReturns(t->child[i]);
+  }
+  return n;
+}
+
+/* Function countDecls counts the declarations in
+ * the node list t and below
+ */
+static int countDecls(TreeNode * t)
+{ int i, n = 0;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == DeclK) n++;
+    for (i = 0; i < MAXCHILDREN; i++) n += countDecls(t->child[i]);
+  }
+  return n;
+}
+
+static TreeNode * lastStmt(TreeNode * t)
+{ while (t != NULL && t->sibling != NULL) t = t->sibling;
+  return t;
+}
+
+/* Function inlinable returns TRUE if f may be
+ * inlined: its body is in this unit and has at
+ * most size nodes, it is not recursive, declares at
+ * most MAXRENAME names, and can only return at the
+ * end
+ */
+static int inlinable(TreeNode * f, int size)
+{ TreeNode * body;
+  TreeNode * last;
+  int returns;
+  if (f == NULL || (f->flags & (F_BUILTIN | F_EXTERN | F_RECURSIVE))) return FALSE;
+  if (strcmp(f->attr.name,"main") == 0) return FALSE;
+  body = f->child[2];
+  if (treeSize(body) > size) return FALSE;
+  if (treeSize(body) + growth > INLINEGROWTH) return FALSE;
+  if (countDecls(f->child[1]) + countDecls(body) > MAXRENAME) return FALSE;
+  last = lastStmt(body->child[1]);
+  returns = countReturns(body);
+  if (last != NULL && last->nodekind == StmtK && last->kind == ReturnK)
+    return returns == 1;
+  return returns == 0 && f->type == Void;
+}
+
+/* Function renamedDecl copies declaration d under a
+ * name unique to this inlined site
+ */
+static TreeNode * renamedDecl(TreeNode * d, int scope)
+{ TreeNode * n = newDeclNode(varK);
+  char name[STRINGSIZE + 16];
+  sprintf(name,"%s_%d",d->attr.name,ninlined);
+  n->attr.name = copyString(name);
+  n->lineno = d->lineno;
+  n->child[0] = newExpNode(TypeK);
+  n->child[0]->type = Integer;
+  n->child[0]->lineno = d->lineno;
+  declInfo(n)->array_size = d->kind == varK ? arraySize(d) : 0;
+  n->type = Integer;
+  n->scope = scope;
+  oldDecl[nrenamed] = d;
+  newDecl[nrenamed++] = n;
+  return n;
+}
+
+static TreeNode * renamed(TreeNode * d)
+{ int i;
+  for (i = nrenamed - 1; i >= 0; i--)
+    if (oldDecl[i] == d) return newDecl[i];
+  return NULL;
+}
+
+static TreeNode * copyDecls(TreeNode * t, int scope);
+
+/* Function copyTree copies the node list t, binding
+ * copied uses to the renamed declarations
+ */
+static TreeNode * copyTree(TreeNode * t, int scope)
+{ TreeNode * head = NULL;
+  TreeNode ** link = &head;
+  TreeNode * n;
+  TreeNode * d;
+  int i;
+  for (; t != NULL; t = t->sibling) {
+    n = (TreeNode *) malloc(sizeof(TreeNode));
+    *n = *t;
+    n->sibling = NULL;
+    n->scope = scope;
+    if (t->nodekind == StmtK && t->kind == CompoundK) {
+      n->child[0] = copyDecls(t->child[0],scope + 1);
+      n->child[1] = copyTree(t->child[1],scope + 1);
+      n->child[2] = NULL;
+    }
+    else for (i = 0; i < MAXCHILDREN; i++)
+      n->child[i] = copyTree(t->child[i],scope);
+    if ((t->nodekind == ExpK && t->kind == IdK) ||
+        (t->nodekind == StmtK && t->kind == CallK)) {
+      d = renamed(t->decl);
+      if (d != NULL) n->decl = d;
+      n->attr.name = copyString(n->decl->attr.name);
+    }
+    *link = n;
+    link = &n->sibling;
+  }
+  return head;
+}
+
+static TreeNode * copyDecls(TreeNode * t, int scope)
+{ TreeNode * head = NULL;
+  TreeNode ** link = &head;
+  for (; t != NULL; t = t->sibling) {
+    *link = renamedDecl(t,scope);
+    link = &(*link)->sibling;
+  }
+  return head;
+}
+
+static TreeNode * idFor(TreeNode * d, int lineno)
+{ TreeNode * n = newExpNode(IdK);
+  n->attr.name = copyString(d->attr.name);
+  n->decl = d;
+  n->subscript = 0;
+  n->type = Integer;
+  n->lineno = lineno;
+  return n;
+}
+
+static TreeNode * appendStmt(TreeNode * list, TreeNode * s)
+{ TreeNode * t = lastStmt(list);
+  if (t == NULL) return s;
+  t->sibling = s;
+  return list;
+}
+
+/* Function dropLast frees the last statement of
+ * list and returns what is left
+ */
+static TreeNode * dropLast(TreeNode * list)
+{ TreeNode ** link = &list;
+  while ((*link)->sibling != NULL) link = &(*link)->sibling;
+  (*link)->child[0] = NULL;
+  freeTree(*link);
+  *link = NULL;
+  return list;
+}
+
+/* Function expand builds the compound statement
+ * replacing statement s, which contains call c
+ */
+static TreeNode * expand(TreeNode * s, TreeNode * c, TreeNode * caller)
+{ TreeNode * f = c->decl;
+  TreeNode * body = f->child[2];
+  TreeNode * block = newStmtNode(CompoundK);
+  TreeNode * decls = NULL;
+  TreeNode * stmts = NULL;
+  TreeNode * p;
+  TreeNode * a;
+  TreeNode * next;
+  TreeNode * d;
+  TreeNode * as;
+  TreeNode * last;
+  TreeNode * ret = NULL;
+
+  int scope = s->scope + 1;
+
+  ninlined++;
+  nrenamed = 0;
+  block->lineno = s->lineno;
+  block->scope = s->scope;
+  /* scalar parameters become locals assigned from
+   * the arguments; array parameters are renamed to
+   * the array passed */
+  for (p = f->child[1], a = c->child[0]; a != NULL; p = p->sibling, a = next) {
+    next = a->sibling;
+    a->sibling = NULL;
+    if (arraySize(p) > 0) {
+      oldDecl[nrenamed] = p;
+      newDecl[nrenamed++] = a->decl;
+      freeTree(a);
+      continue;
+    }
+    d = renamedDecl(p,scope);
+    decls = appendStmt(decls,d);
+    as = newStmtNode(AssignK);
+    as->lineno = s->lineno;
+    as->scope = scope;
+    as->type = Integer;
+    as->child[0] = idFor(d,s->lineno);
+    as->child[1] = a;
+    stmts = appendStmt(stmts,as);
+  }
+  c->child[0] = NULL;
+  decls = appendStmt(decls,copyDecls(body->child[0],scope));
+  stmts = appendStmt(stmts,copyTree(body->child[1],scope));
+  /* the callee's final return becomes the value of
+   * the assignment, the caller's return, or a plain
+   * expression statement */
+  last = lastStmt(stmts);
+  if (last != NULL && last->nodekind == StmtK && last->kind == ReturnK)
+    ret = last;
+  if (ret != NULL && s->kind == AssignK) {
+    ret->kind = AssignK;
+    ret->child[1] = ret->child[0];
+    ret->child[0] = s->child[0];
+    ret->type = Integer;
+    s->child[0] = NULL;
+  }
+  else if (ret != NULL && s->kind == CallK) {
+    a = ret->child[0];
+    stmts = dropLast(stmts);
+    if (a != NULL) stmts = appendStmt(stmts,a);
+  }
+  block->child[0] = decls;
+  block->child[1] = stmts;
+  growth += treeSize(block);
+  if (TraceAnalyze)
+    fprintf(listing,"  line %d: %s inlined into %s (%d nodes)\n",
+            s->lineno,f->attr.name,caller->attr.name,treeSize(body));
+  return block;
+}
+
+/* Function siteCall returns the call of statement s
+ * if it is one the inliner can replace
+ */
+static TreeNode * siteCall(TreeNode * s)
+{ TreeNode * c = NULL;
+  if (s->nodekind != StmtK) return NULL;
+  if (s->kind == CallK) c = s;
+  else if (s->kind == AssignK || s->kind == ReturnK)
+    c = s->kind == AssignK ? s->child[1] : s->child[0];
+  if (c == NULL || c->nodekind != StmtK || c->kind != CallK) return NULL;
+  if (c != s && (c->decl == NULL || c->decl->type != Integer)) return NULL;
+  return c;
+}
+
+/* Function inlineSite is TRUE if call c of statement
+ * s is to be inlined; with a profile, hot sites take
+ * callees up to HOTINLINESIZE and sites that never
+ * ran are left as calls
+ */
+static int inlineSite(TreeNode * s, TreeNode * c, TreeNode * caller, int inLoop)
+{ int plain = inlinable(c->decl,inLoop ? 2 * INLINESIZE : INLINESIZE);
+  int ok = plain;
+  long n;
+  if (!ProfileUse) return plain;
+  n = pgoCount(caller,s->lineno,"line",-1);
+  if (n == 0) ok = FALSE;
+  else if (pgoHot(n)) ok = inlinable(c->decl,HOTINLINESIZE);
+  if (ok && !plain)
+    pgoNote(caller,s->lineno,"hot call of %s inlined (%ld runs)",c->decl->attr.name,n);
+  else if (!ok && plain)
+    pgoNote(caller,s->lineno,"call of %s never ran, not inlined",c->decl->attr.name);
+  return ok;
+}
+
+/* Procedure inlineList visits the statement list
+ * starting at *link, replacing call sites in place
+ */
+static void inlineList(TreeNode ** link, TreeNode * caller, int inLoop)
+{ TreeNode * s;
+  TreeNode * c;
+  TreeNode * block;
+  while ((s = *link) != NULL) {
+    c = siteCall(s);
+    if (c != NULL && c->decl != caller && inlineSite(s,c,caller,inLoop)) {
+      block = expand(s,c,caller);
+      block->sibling = s->sibling;
+      s->sibling = NULL;
+      freeTree(s);
+      *link = s = block;
+    }
+    if (s->nodekind == StmtK) {
+      switch (s->kind) {
+      case CompoundK:
+        inlineList(&s->child[1],caller,inLoop);
+        break;
+      case IfK:
+        inlineList(&s->child[1],caller,inLoop);
+        inlineList(&s->child[2],caller,inLoop);
+        break;
+      case WhileK:
+        inlineList(&s->child[1],caller,TRUE);
+        break;
+      default:
+        break;
+      }
+    }
+    link = &s->sibling;
+  }
+}
+
+void inlineCalls(void)
+{ int i;
+  TreeNode * f;
+  int before = ninlined;
+  if (TraceAnalyze) fprintf(listing,"\nInlining small functions...\n");
+  /* callees first, so that inlined bodies already
+   * have their own calls inlined */
+  for (i = 0; i < callGraph.nfuns; i++) {
+    f = callGraph.funs[callGraph.order[i]].fun;
+    if (f->flags & F_BUILTIN) continue;
+    growth = 0;
+    inlineList(&f->child[2]->child[1],f,FALSE);
+  }
+  fprintf(listing,"Call sites inlined: %d\n",ninlined - before);
+}
@@ -0,0 +1,34 @@
+/****************************************************/
+/* File: inline.h                                   */
+/* Function inliner interface for the C- compiler   */
+/****************************************************/
+
+#ifndef _INLINE_H_
+#define _INLINE_H_
+
+/* INLINESIZE is the largest callee body, in nodes,
+ * that is inlined; call sites inside while loops
+ * may take callees twice as large
+ */
+#define INLINESIZE 40
+
+/* HOTINLINESIZE is the largest callee inlined at a
+ * call site the profile shows to be hot
+ */
+#define HOTINLINESIZE (4 * INLINESIZE)
+
+/* INLINEGROWTH bounds the number of nodes inlining
+ * may add to one caller
+ */
+#define INLINEGROWTH 400
+
+/* Procedure inlineCalls substitutes the bodies of
+ * small non-recursive functions at their call sites
+ * in the functions of the call graph and reports
+ * each substitution; a loaded profile widens the
+ * choice at hot sites and excludes sites that never
+ * ran
+ */
+void inlineCalls(void);
+
+#endif
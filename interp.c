@@ -0,0 +1,595 @@
+/****************************************************/
+/* File: interp.c                                   */
+/* Tree-walking interpreter for the C- compiler     */
+/* Variables are cells addressed by the offset that */
+/* assignSlots stores in their declaration node     */
+/* With ParallelCalls, the pure call on the left of */
+/* a marked operator runs as a task of the thread   */
+/* pool while the right operand is evaluated.       */
+/* With Profile, every call links a ProfFrame that  */
+/* the sampling profiler walks.                     */
+/****************************************************/
+
+#include <setjmp.h>
+#include "globals.h"
+#include "interp.h"
+#include "memo.h"
+#include "pool.h"
+#include "prof.h"
+
+/* a storage cell: an int, or the base of an array
+ * when the cell holds an array parameter
+ */
+typedef union cell
+{ int val;
+  union cell * ref;
+} Cell;
+
+/* globals holds the top level variables */
+static Cell * globals = NULL;
+
+/* calldepth is the current C- recursion depth of
+ * the running thread
+ */
+static __thread int calldepth = 0;
+
+/* the frames of the running calls are kept in
+ * chunks on the heap, a stack per thread, so that
+ * their size is bounded by MAXFRAMEBYTES and not by
+ * the C stack; frameBytes is the size in use, which
+ * a forked task continues from its forker
+ */
+typedef struct ChunkRec
+{ struct ChunkRec * prev;
+  struct ChunkRec * next;
+  size_t size, top;
+  char * mem;
+} Chunk;
+
+/* STACKCHUNK is the least size of a chunk */
+#define STACKCHUNK (64 * 1024)
+
+static __thread Chunk * chunk = NULL;
+static __thread long frameBytes = 0;
+
+/* a stack position to return to, chunk NULL for
+ * the empty stack
+ */
+typedef struct
+{ Chunk * chunk;
+  size_t top;
+  long bytes;
+} Mark;
+
+/* deepest is the greatest depth reached since the
+ * innermost cached call began, which gives the height
+ * stored with its result
+ */
+static __thread int deepest = 0;
+
+/* runtime errors jump to the innermost catcher of
+ * the thread: execute, evalCall or a forked call;
+ * errNode and errMessage tell what happened
+ */
+static __thread jmp_buf * catcher = NULL;
+static __thread TreeNode * errNode = NULL;
+static __thread char * errMessage = NULL;
+
+/* folding is TRUE while evalCall runs; errors are
+ * then left for run time to report
+ */
+static int folding = FALSE;
+
+/* steps counts executed statements and loop
+ * iterations; stepLimit (when not 0) aborts the run
+ */
+static long steps = 0;
+static long stepLimit = 0;
+
+#define STEP(t) if (stepLimit && ++steps > stepLimit) \
+                  runError(t,"step budget exhausted")
+
+/* AT records the line being run for the profiler */
+#define AT(t) if (Profile) profTop->lineno = (t)->lineno
+
+static void runError(TreeNode * t, char * message)
+{ errNode = t;
+  errMessage = message;
+  /* the frames are left; the catcher sets it again */
+  profTop = NULL;
+  longjmp(*catcher,1);
+}
+
+static Mark stackMark(void)
+{ Mark m;
+  m.chunk = chunk;
+  m.top = chunk != NULL ? chunk->top : 0;
+  m.bytes = frameBytes;
+  return m;
+}
+
+/* Procedure freeChunks frees chunk c and those
+ * after it
+ */
+static void freeChunks(Chunk * c)
+{ Chunk * next;
+  for (; c != NULL; c = next) {
+    next = c->next;
+    free(c->mem);
+    free(c);
+  }
+}
+
+/* Procedure stackRelease pops the stack down to
+ * mark m; the chunks above are kept for reuse,
+ * unless the stack is left empty
+ */
+static void stackRelease(Mark m)
+{ if (m.chunk == NULL && chunk != NULL) {
+    while (chunk->prev != NULL) chunk = chunk->prev;
+    freeChunks(chunk);
+  }
+  chunk = m.chunk;
+  if (chunk != NULL) chunk->top = m.top;
+  frameBytes = m.bytes;
+}
+
+/* Function stackAlloc returns bytes bytes of the
+ * stack for call t, failing when the frames would
+ * exceed MAXFRAMEBYTES
+ */
+static void * stackAlloc(TreeNode * t, size_t bytes)
+{ Chunk * c;
+  bytes = (bytes + 7) & ~(size_t) 7;
+  if (frameBytes + (long) bytes > MAXFRAMEBYTES) runError(t,"call stack overflow");
+  if (chunk == NULL || chunk->top + bytes > chunk->size) {
+    c = chunk != NULL ? chunk->next : NULL;
+    if (c != NULL && c->size < bytes) {
+      freeChunks(c);
+      chunk->next = c = NULL;
+    }
+    if (c == NULL) {
+      c = (Chunk *) malloc(sizeof(Chunk));
+      c->size = bytes > STACKCHUNK ? bytes : STACKCHUNK;
+      if ((c->mem = (char *) malloc(c->size)) == NULL) {
+        free(c);
+        runError(t,"call stack overflow");
+      }
+      c->prev = chunk;
+      c->next = NULL;
+      if (chunk != NULL) chunk->next = c;
+    }
+    c->top = 0;
+    chunk = c;
+  }
+  chunk->top += bytes;
+  frameBytes += bytes;
+  return chunk->mem + chunk->top - bytes;
+}
+
+/* Function declSlots gives offsets to the variables
+ * declared in the list t, starting at next, and
+ * returns the first free offset
+ */
+static int declSlots(TreeNode * t, int next)
+{ int i;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == DeclK && t->kind == varK) {
+      declInfo(t)->offset = next;
+      next += arraySize(t) > 0 ? arraySize(t) : 1;
+    }
+    else if (t->nodekind == StmtK)
+      for (i = 0; i < MAXCHILDREN; i++)
+        next = declSlots(t->child[i], next);
+  }
+  return next;
+}
+
+/* nglobals is the number of cells of the globals */
+static int nglobals = 0;
+
+/* Procedure layoutCells lays out the globals and the
+ * frame of every function; a function's offset field
+ * receives its frame size
+ */
+void layoutCells(TreeNode * syntaxTree)
+{ TreeNode * t;
+  TreeNode * p;
+  int next;
+  nglobals = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling) {
+    if (t->kind == varK) {
+      declInfo(t)->offset = nglobals;
+      nglobals += arraySize(t) > 0 ? arraySize(t) : 1;
+    }
+    else if (t->kind == funK) {
+      next = 0;
+      for (p = t->child[1]; p != NULL; p = p->sibling)
+        if (arraySize(p) >= 0) declInfo(p)->offset = next++;
+      declInfo(t)->offset = declSlots(t->child[2], next);
+    }
+  }
+}
+
+static int eval(TreeNode * t, Cell * frame);
+
+/* Function arrayBase returns the first element of
+ * the array named by t
+ */
+static Cell * arrayBase(TreeNode * t, Cell * frame)
+{ TreeNode * d = t->decl;
+  Cell * c = d->scope == 0 ? &globals[cellOffset(d)] : &frame[cellOffset(d)];
+  return d->kind == paramK ? c->ref : c;
+}
+
+/* Function lvalue returns the cell denoted by the
+ * variable or subscripted array t
+ */
+static Cell * lvalue(TreeNode * t, Cell * frame)
+{ TreeNode * d = t->decl;
+  int i;
+  if (arraySize(t) > 0 && t->child[0] != NULL) {
+    i = eval(t->child[0],frame);
+    if (d->kind == varK && (i < 0 || i >= arraySize(d)))
+      runError(t,"array subscript out of range");
+    return arrayBase(t,frame) + i;
+  }
+  return d->scope == 0 ? &globals[cellOffset(d)] : &frame[cellOffset(d)];
+}
+
+static int call(TreeNode * t, Cell * frame);
+
+/* a forked operand and its outcome */
+typedef struct
+{ Task task;
+  TreeNode * t;
+  Cell * frame;
+  int depth;
+  long bytes;
+  ProfFrame * prof;
+  int value;
+  TreeNode * errNode;
+  char * errMessage;
+} Fork;
+
+/* Procedure runFork evaluates a forked operand on
+ * whatever thread took it, catching its errors
+ */
+static void runFork(Task * task)
+{ Fork * f = (Fork *) task;
+  jmp_buf here;
+  jmp_buf * outer = catcher;
+  ProfFrame * top = profTop;
+  int depth = calldepth;
+  Mark mark = stackMark();
+  calldepth = f->depth;
+  frameBytes = f->bytes;
+  /* the calls of the task continue the stack of the
+   * thread that forked it, which waits in the join */
+  profTop = f->prof;
+  catcher = &here;
+  if (setjmp(here) == 0) f->value = eval(f->t,f->frame);
+  else {
+    f->errNode = errNode;
+    f->errMessage = errMessage;
+  }
+  catcher = outer;
+  profTop = top;
+  calldepth = depth;
+  stackRelease(mark);
+}
+
+/* Procedure evalFork evaluates the operands of the
+ * marked operator t into *a and *b, the left one
+ * as a task; errors are raised in the order of the
+ * sequential evaluation
+ */
+static void evalFork(TreeNode * t, Cell * frame, int * a, int * b)
+{ Fork f;
+  jmp_buf here;
+  jmp_buf * outer = catcher;
+  ProfFrame * top = profTop;
+  TreeNode * node = NULL;
+  char * message = NULL;
+  Mark mark = stackMark();
+  f.task.run = runFork;
+  f.t = t->child[0];
+  f.frame = frame;
+  f.depth = calldepth;
+  f.bytes = frameBytes;
+  f.prof = profTop;
+  f.errNode = NULL;
+  if (!pool_spawn(&f.task)) {
+    *a = eval(t->child[0],frame);
+    *b = eval(t->child[2],frame);
+    return;
+  }
+  catcher = &here;
+  if (setjmp(here) == 0) *b = eval(t->child[2],frame);
+  else {
+    node = errNode;
+    message = errMessage;
+    profTop = top;
+    stackRelease(mark);
+  }
+  catcher = outer;
+  pool_join(&f.task);
+  if (f.errNode != NULL) runError(f.errNode,f.errMessage);
+  if (node != NULL) runError(node,message);
+  *a = f.value;
+}
+
+/* Function eval returns the value of expression t */
+static int eval(TreeNode * t, Cell * frame)
+{ int a, b;
+  if (t->nodekind == StmtK) {
+    if (t->kind == CallK) return call(t,frame);
+    /* AssignK */
+    a = eval(t->child[1],frame);
+    lvalue(t->child[0],frame)->val = a;
+    return a;
+  }
+  switch (t->kind) {
+  case ConstK:
+    return t->attr.val;
+  case IdK:
+    return lvalue(t,frame)->val;
+  case CalcK:
+    if ((t->flags & F_FORK) && calldepth < ForkDepth && !folding)
+      evalFork(t,frame,&a,&b);
+    else {
+      a = eval(t->child[0],frame);
+      b = eval(t->child[2],frame);
+    }
+    switch (t->child[1]->attr.op) {
+    case PLUS:  return (int) ((unsigned) a + (unsigned) b);
+    case MINUS: return (int) ((unsigned) a - (unsigned) b);
+    case MUL:   return (int) ((unsigned) a * (unsigned) b);
+    case DIV:
+      if (b == 0) runError(t,"division by zero");
+      if (b == -1) return (int) (0u - (unsigned) a);
+      return a / b;
+    case LES: return a < b;
+    case LEQ: return a <= b;
+    case BIG: return a > b;
+    case BEQ: return a >= b;
+    case EQ:  return a == b;
+    case NEQ: return a != b;
+    default: runError(t,"unknown expression");
+    }
+    break;
+  default:
+    runError(t,"unknown expression");
+  }
+  return 0;
+}
+
+/* Procedure exec runs the statement list t; it
+ * returns TRUE as soon as a return statement ran,
+ * leaving the returned value in *ret
+ */
+static int exec(TreeNode * t, Cell * frame, int * ret)
+{ for (; t != NULL; t = t->sibling) {
+    STEP(t);
+    AT(t);
+    if (t->nodekind != StmtK) {
+      if (t->nodekind == ExpK) eval(t,frame);
+      continue;
+    }
+    switch (t->kind) {
+    case CompoundK:
+      if (exec(t->child[1],frame,ret)) return TRUE;
+      break;
+    case IfK:
+      if (eval(t->child[0],frame)) {
+        if (exec(t->child[1],frame,ret)) return TRUE;
+      }
+      else if (exec(t->child[2],frame,ret)) return TRUE;
+      break;
+    case WhileK:
+      while (eval(t->child[0],frame)) {
+        STEP(t);
+        if (exec(t->child[1],frame,ret)) return TRUE;
+        AT(t);
+      }
+      break;
+    case ReturnK:
+      *ret = t->child[0] != NULL ? eval(t->child[0],frame) : 0;
+      return TRUE;
+    default:
+      eval(t,frame);
+      break;
+    }
+  }
+  return FALSE;
+}
+
+/* Function builtin runs input() and output() */
+static int builtin(TreeNode * t, int * args)
+{ int v = 0;
+  if (strcmp(t->decl->attr.name,"input") == 0) {
+    fflush(stdout);
+    if (scanf("%d",&v) != 1) runError(t,"bad input");
+  }
+  else printf("%d\n",args[0]);
+  return v;
+}
+
+/* Function call evaluates the arguments of call t,
+ * then runs the callee in a fresh frame; both live
+ * on the interpreter stack
+ */
+static int call(TreeNode * t, Cell * frame)
+{ TreeNode * f = t->decl;
+  TreeNode * p;
+  TreeNode * a;
+  int nparams = paramNum(f) > 0 ? paramNum(f) : 1;
+  Mark mark = stackMark();
+  Cell ** bases = (Cell **) stackAlloc(t, (sizeof(Cell *) + sizeof(int)) * nparams);
+  int * args = (int *) (bases + nparams);
+  Cell * callee;
+  MemoTable m = NULL;
+  ProfFrame me;
+  int n = 0;
+  int ret = 0;
+  int height, outer = 0;
+  for (a = t->child[0], p = f->child[1]; a != NULL; a = a->sibling, p = p->sibling) {
+    if (arraySize(p) > 0) bases[n] = arrayBase(a,frame);
+    else args[n] = eval(a,frame);
+    n++;
+  }
+  if (f->flags & F_BUILTIN) {
+    ret = builtin(t,args);
+    stackRelease(mark);
+    return ret;
+  }
+  if ((MemoCalls || folding) && (f->flags & F_PURE)) {
+    m = memo_table(f);
+    /* a result that would not fit is computed again,
+     * failing where the uncached run fails */
+    if (memo_lookup(m,args,&ret,&height) && calldepth + height <= MAXCALLDEPTH) {
+      if (calldepth + height > deepest) deepest = calldepth + height;
+      stackRelease(mark);
+      return ret;
+    }
+  }
+  if (++calldepth > MAXCALLDEPTH) runError(t,"call stack overflow");
+  callee = (Cell *) stackAlloc(t, sizeof(Cell) * (cellOffset(f) > 0 ? cellOffset(f) : 1));
+  memset(callee,0,sizeof(Cell) * (cellOffset(f) > 0 ? cellOffset(f) : 1));
+  if (m != NULL) {
+    outer = deepest;
+    deepest = calldepth;
+  }
+  else if (calldepth > deepest) deepest = calldepth;
+  for (n = 0, p = f->child[1]; p != NULL; p = p->sibling, n++)
+    if (arraySize(p) > 0) callee[cellOffset(p)].ref = bases[n];
+    else if (arraySize(p) == 0) callee[cellOffset(p)].val = args[n];
+  if (Profile) {
+    me.fun = f;
+    me.lineno = f->lineno;
+    me.up = profTop;
+    /* the frame is complete before the signal can
+     * see it */
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    profTop = &me;
+  }
+  exec(f->child[2],callee,&ret);
+  if (Profile) profTop = me.up;
+  calldepth--;
+  if (m != NULL) {
+    memo_insert(m,args,ret,deepest - calldepth);
+    if (outer > deepest) deepest = outer;
+  }
+  stackRelease(mark);
+  return ret;
+}
+
+/* Function effectFree returns TRUE if evaluating t
+ * assigns nothing and calls only pure functions, so
+ * that it can run beside another such expression
+ */
+static int effectFree(TreeNode * t)
+{ int i;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == StmtK) {
+      if (t->kind != CallK) return FALSE;
+      if (t->decl == NULL || !(t->decl->flags & F_PURE)) return FALSE;
+    }
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (!effectFree(t->child[i])) return FALSE;
+  }
+  return TRUE;
+}
+
+static int hasCall(TreeNode * t)
+{ int i;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == StmtK && t->kind == CallK) return TRUE;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (hasCall(t->child[i])) return TRUE;
+  }
+  return FALSE;
+}
+
+/* Procedure markForks sets F_FORK on the operators
+ * whose operands both call pure functions and have
+ * no effects
+ */
+static void markForks(TreeNode * t)
+{ int i;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == ExpK && t->kind == CalcK &&
+        hasCall(t->child[0]) && hasCall(t->child[2]) &&
+        effectFree(t->child[0]) && effectFree(t->child[2]))
+      t->flags |= F_FORK;
+    for (i = 0; i < MAXCHILDREN; i++) markForks(t->child[i]);
+  }
+}
+
+void execute(TreeNode * syntaxTree)
+{ TreeNode * t;
+  TreeNode * m = NULL;
+  TreeNode c;
+  jmp_buf here;
+  Mark base = stackMark();
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->kind == funK && strcmp(t->attr.name,"main") == 0) m = t;
+  if (m == NULL) {
+    fprintf(listing,"Runtime error: no function main\n");
+    Error = TRUE;
+    return;
+  }
+  layoutCells(syntaxTree);
+  globals = (Cell *) calloc(nglobals + 1, sizeof(Cell));
+  memset(&c,0,sizeof(c));
+  c.nodekind = StmtK;
+  c.kind = CallK;
+  c.lineno = m->lineno;
+  c.decl = m;
+  calldepth = deepest = 0;
+  /* the cache is not shared between threads */
+  if (ParallelCalls && !MemoCalls) {
+    markForks(syntaxTree);
+    pool_start(ParallelCalls);
+  }
+  if (Profile) prof_start();
+  catcher = &here;
+  if (setjmp(here) == 0) call(&c,NULL);
+  else {
+    fprintf(listing,"Runtime error at line %d: %s\n",errNode->lineno,errMessage);
+    Error = TRUE;
+  }
+  catcher = NULL;
+  profTop = NULL;
+  stackRelease(base);
+  if (Profile) prof_stop();
+  fflush(stdout);
+  if (ParallelCalls && !MemoCalls) {
+    pool_report(listing);
+    pool_stop();
+  }
+  if (MemoCalls) memo_report(listing);
+  if (Profile) prof_report(listing);
+  free(globals);
+  globals = NULL;
+}
+
+int evalCall(TreeNode * t, int depth, long budget, int * result)
+{ int ok = FALSE;
+  jmp_buf here;
+  Mark base = stackMark();
+  folding = TRUE;
+  steps = 0;
+  stepLimit = budget;
+  calldepth = deepest = depth;
+  catcher = &here;
+  if (setjmp(here) == 0) {
+    *result = call(t,NULL);
+    ok = TRUE;
+  }
+  catcher = NULL;
+  stackRelease(base);
+  folding = FALSE;
+  stepLimit = 0;
+  return ok;
+}
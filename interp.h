@@ -0,0 +1,40 @@
+/****************************************************/
+/* File: interp.h                                   */
+/* Tree-walking interpreter interface for the C-    */
+/* compiler                                         */
+/****************************************************/
+
+#ifndef _INTERP_H_
+#define _INTERP_H_
+
+/* MAXCALLDEPTH bounds the depth of C- recursion so
+ * that runaway programs stop with an error instead
+ * of overflowing the interpreter's own stack
+ */
+#define MAXCALLDEPTH 8000
+
+/* MAXFRAMEBYTES bounds the total size of the frames
+ * of the running calls, which are kept on the heap
+ */
+#define MAXFRAMEBYTES (128L * 1024 * 1024)
+
+/* Procedure execute runs function main of the
+ * analyzed syntax tree, reading input() from stdin
+ * and writing output() to stdout
+ */
+void execute(TreeNode *);
+
+/* Procedure layoutCells gives every variable its
+ * cell offset; execute and evalCall rely on it
+ */
+void layoutCells(TreeNode *);
+
+/* Function evalCall runs call t, whose arguments
+ * are constants, from a caller at call depth depth
+ * for at most budget steps; it returns TRUE and sets
+ * *result if the call finished without a runtime
+ * error
+ */
+int evalCall(TreeNode * t, int depth, long budget, int * result);
+
+#endif
@@ -0,0 +1,807 @@
+/****************************************************/
+/* File: ir.c                                       */
+/* Lowering of the syntax tree to three-address     */
+/* code for the C- compiler's native backend        */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "pgo.h"
+#include "ir.h"
+
+/* the function being lowered */
+static IrFunc cur;
+
+/* while loop nesting depth of the current code */
+static int loopDepth;
+
+/* line of the statement being lowered */
+static int curLine;
+
+/* the counter of the code being lowered, -1 when
+ * the next statement starts a new block
+ */
+static int curCounter;
+
+/* the count in the profile of the code being
+ * lowered and of the innermost block around it
+ * (then, else, loop body or function), -1 if not
+ * known
+ */
+static long curFreq;
+static long blockFreq;
+
+/* ifs and loops seen so far in the function, in
+ * the order the profile numbers them
+ */
+static int nIfs, nLoops;
+
+/* code moved after the end of the function */
+static IrInstr * coldCode = NULL;
+static int ncold = 0, maxcold = 0;
+
+IrCounter * irCounters = NULL;
+int nIrCounters = 0;
+int nIrCounts = 0;
+static int maxIrCounters = 0;
+
+/* labels are numbered across the whole program */
+static int nlabels = 0;
+
+static int newLabel(void)
+{ return ++nlabels; }
+
+int irNewLabel(void)
+{ return newLabel(); }
+
+static IrOpnd none(void)
+{ IrOpnd o;
+  o.kind = O_NONE;
+  o.val = 0;
+  return o;
+}
+
+static IrOpnd imm(int v)
+{ IrOpnd o;
+  o.kind = O_IMM;
+  o.val = v;
+  return o;
+}
+
+static IrOpnd vreg(int r)
+{ IrOpnd o;
+  o.kind = O_REG;
+  o.val = r;
+  return o;
+}
+
+int irNewVreg(IrFunc f, int isptr)
+{ if (f->nvregs == f->maxvregs) {
+    f->maxvregs = f->maxvregs ? 2 * f->maxvregs : 64;
+    f->isptr = (char *) realloc(f->isptr, f->maxvregs);
+  }
+  f->isptr[f->nvregs] = isptr;
+  return f->nvregs++;
+}
+
+static IrOpnd newTemp(int isptr)
+{ return vreg(irNewVreg(cur,isptr)); }
+
+static IrInstr * emitIr(IrOp op)
+{ IrInstr * i;
+  if (cur->ncode == cur->maxcode) {
+    cur->maxcode = cur->maxcode ? 2 * cur->maxcode : 64;
+    cur->code = (IrInstr *) realloc(cur->code, sizeof(IrInstr) * cur->maxcode);
+  }
+  i = &cur->code[cur->ncode++];
+  memset(i,0,sizeof(IrInstr));
+  i->op = op;
+  i->lineno = curLine;
+  i->depth = loopDepth;
+  i->freq = curFreq;
+  return i;
+}
+
+IrInstr * irInsert(IrFunc f, int at)
+{ IrInstr * i;
+  IrInstr * near;
+  if (f->ncode == f->maxcode) {
+    f->maxcode = f->maxcode ? 2 * f->maxcode : 64;
+    f->code = (IrInstr *) realloc(f->code, sizeof(IrInstr) * f->maxcode);
+  }
+  memmove(&f->code[at+1],&f->code[at],sizeof(IrInstr) * (f->ncode - at));
+  f->ncode++;
+  i = &f->code[at];
+  near = at + 1 < f->ncode ? &f->code[at+1] : at > 0 ? &f->code[at-1] : NULL;
+  memset(i,0,sizeof(IrInstr));
+  i->freq = -1;
+  if (near != NULL) {
+    i->lineno = near->lineno;
+    i->depth = near->depth;
+    i->freq = near->freq;
+  }
+  return i;
+}
+
+static void emitLabel(int l)
+{ emitIr(I_LABEL)->label = l; }
+
+static void emitJump(int l)
+{ emitIr(I_JMP)->label = l; }
+
+static void addCounter(int lineno, char * kind, int counter)
+{ IrCounter * c;
+  if (nIrCounters == maxIrCounters) {
+    maxIrCounters = maxIrCounters ? 2 * maxIrCounters : 64;
+    irCounters = (IrCounter *) realloc(irCounters, sizeof(IrCounter) * maxIrCounters);
+  }
+  c = &irCounters[nIrCounters++];
+  c->fun = cur->fun;
+  c->lineno = lineno;
+  c->kind = kind;
+  c->counter = counter;
+}
+
+/* Procedure newCounter starts a block counted by a
+ * new counter, reported as kind at lineno unless
+ * kind is NULL
+ */
+static void newCounter(int lineno, char * kind)
+{ IrInstr * i = emitIr(I_COUNT);
+  i->a = imm(nIrCounts);
+  i->b = imm(1);
+  curCounter = nIrCounts++;
+  if (kind != NULL) addCounter(lineno,kind,curCounter);
+}
+
+/* Procedure countLine reports line lineno under the
+ * counter of its block, the first time it is seen
+ * in the function
+ */
+static void countLine(int lineno)
+{ int k;
+  if (curCounter < 0) newCounter(lineno,NULL);
+  for (k = nIrCounters - 1; k >= 0 && irCounters[k].fun == cur->fun; k--)
+    if (irCounters[k].lineno == lineno && strcmp(irCounters[k].kind,"line") == 0)
+      return;
+  addCounter(lineno,"line",curCounter);
+}
+
+/* Function stmtLine returns the line that counts of
+ * statement t are reported under; if and while
+ * nodes are only made at the end of the statement,
+ * so they take the line of their condition
+ */
+static int stmtLine(TreeNode * t)
+{ if (t->nodekind == StmtK && (t->kind == IfK || t->kind == WhileK))
+    return t->child[0]->lineno;
+  return t->lineno;
+}
+
+/* Procedure lineFreq takes the count of the code
+ * from the profile record of line lineno, which is
+ * at most that of the block it is in
+ */
+static void lineFreq(int lineno)
+{ long n = pgoCount(cur->fun,lineno,"line",-1);
+  if (n < 0) return;
+  curFreq = blockFreq >= 0 && n > blockFreq ? blockFreq : n;
+}
+
+/* Procedure moveCold moves the code lowered from
+ * index from on behind the end of the function
+ */
+static void moveCold(int from)
+{ int n = cur->ncode - from;
+  if (ncold + n > maxcold) {
+    maxcold = 2 * (ncold + n);
+    coldCode = (IrInstr *) realloc(coldCode, sizeof(IrInstr) * maxcold);
+  }
+  memcpy(&coldCode[ncold],&cur->code[from],sizeof(IrInstr) * n);
+  ncold += n;
+  cur->ncode = from;
+}
+
+static int isGlobal(TreeNode * d)
+{ return d->kind == varK && d->scope == 0; }
+
+static int isArray(TreeNode * d)
+{ return arraySize(d) > 0; }
+
+static IrOpnd lowerExp(TreeNode * t);
+
+/* nvars is the number of vregs that are variables;
+ * temporaries are numbered after them
+ */
+static int nvars;
+
+static int hasAssign(TreeNode * t)
+{ int i;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == StmtK && t->kind == AssignK) return TRUE;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (hasAssign(t->child[i])) return TRUE;
+  }
+  return FALSE;
+}
+
+/* Function stable copies variable operand v to a
+ * temporary when evaluating rest may assign to it,
+ * so the value read first is the one used
+ */
+static IrOpnd stable(IrOpnd v, TreeNode * rest)
+{ IrInstr * i;
+  if (v.kind != O_REG || v.val >= nvars || !hasAssign(rest)) return v;
+  i = emitIr(I_MOV);
+  i->dst = newTemp(FALSE);
+  i->a = v;
+  return i->dst;
+}
+
+/* Function arrayBase returns a vreg holding the
+ * address of the first element of array d
+ */
+static IrOpnd arrayBase(TreeNode * d)
+{ IrOpnd r;
+  if (d->kind == paramK) return vreg(cellOffset(d));
+  r = newTemp(TRUE);
+  emitIr(I_ADDR)->sym = d;
+  cur->code[cur->ncode-1].dst = r;
+  return r;
+}
+
+/* Procedure boundsCheck checks index v of access t
+ * unless the array has no known size (a parameter)
+ * or the subscript was proven to be in range
+ */
+static void boundsCheck(TreeNode * t, IrOpnd v)
+{ TreeNode * d = t->decl;
+  IrInstr * i;
+  if (d->kind != varK || (t->flags & F_INBOUNDS)) return;
+  if (v.kind == O_IMM && v.val >= 0 && v.val < arraySize(d)) return;
+  i = emitIr(I_CHECK);
+  i->a = v;
+  i->b = imm(arraySize(d));
+  i->sym = d;
+  i->lineno = t->lineno;
+}
+
+/* Procedure lowerStore assigns v to the variable or
+ * array element v denoted by t
+ */
+static void lowerStore(TreeNode * t, IrOpnd v)
+{ TreeNode * d = t->decl;
+  IrInstr * i;
+  IrOpnd base, idx;
+  if (arraySize(t) > 0 && t->child[0] != NULL) {
+    idx = lowerExp(t->child[0]);
+    boundsCheck(t,idx);
+    base = arrayBase(d);
+    i = emitIr(I_STORE);
+    i->a = base;
+    i->b = idx;
+    i->c = v;
+  }
+  else if (isGlobal(d)) {
+    i = emitIr(I_GSTORE);
+    i->sym = d;
+    i->a = v;
+  }
+  else {
+    i = emitIr(I_MOV);
+    i->dst = vreg(cellOffset(d));
+    i->a = v;
+  }
+}
+
+static IrOpnd lowerCall(TreeNode * t)
+{ TreeNode * f = t->decl;
+  TreeNode * a;
+  TreeNode * p;
+  IrOpnd * args;
+  IrInstr * i;
+  int n = 0;
+  for (a = t->child[0]; a != NULL; a = a->sibling) n++;
+  args = (IrOpnd *) malloc(sizeof(IrOpnd) * (n + 1));
+  n = 0;
+  for (a = t->child[0], p = f->child[1]; a != NULL; a = a->sibling, p = p->sibling)
+    args[n++] = arraySize(p) > 0 ? arrayBase(a->decl) : stable(lowerExp(a),a->sibling);
+  i = emitIr(I_CALL);
+  i->sym = f;
+  i->args = args;
+  i->nargs = n;
+  if (f->type != Void) i->dst = newTemp(FALSE);
+  return i->dst;
+}
+
+/* Function lowerExp emits the code of expression t
+ * and returns the operand holding its value
+ */
+static IrOpnd lowerExp(TreeNode * t)
+{ TreeNode * d;
+  IrInstr * i;
+  IrOpnd a, b;
+  if (t->nodekind == StmtK) {
+    if (t->kind == CallK) return lowerCall(t);
+    /* AssignK */
+    a = lowerExp(t->child[1]);
+    lowerStore(t->child[0],a);
+    return a;
+  }
+  switch (t->kind) {
+  case ConstK:
+    return imm(t->attr.val);
+  case IdK:
+    d = t->decl;
+    if (arraySize(t) > 0 && t->child[0] != NULL) {
+      b = lowerExp(t->child[0]);
+      boundsCheck(t,b);
+      a = arrayBase(d);
+      i = emitIr(I_LOAD);
+      i->dst = newTemp(FALSE);
+      i->a = a;
+      i->b = b;
+      return i->dst;
+    }
+    if (isGlobal(d)) {
+      i = emitIr(I_GLOAD);
+      i->dst = newTemp(FALSE);
+      i->sym = d;
+      return i->dst;
+    }
+    return vreg(cellOffset(d));
+  case CalcK:
+    a = stable(lowerExp(t->child[0]),t->child[2]);
+    b = lowerExp(t->child[2]);
+    switch (t->child[1]->attr.op) {
+    case PLUS: case MINUS: case MUL: case DIV:
+      i = emitIr(I_BIN);
+      break;
+    default:
+      i = emitIr(I_CMP);
+      break;
+    }
+    i->sub = t->child[1]->attr.op;
+    i->dst = newTemp(FALSE);
+    i->a = a;
+    i->b = b;
+    return i->dst;
+  default:
+    break;
+  }
+  return imm(0);
+}
+
+static IrInstr * emitBranch(TokenType op, IrOpnd a, IrOpnd b, int label)
+{ IrInstr * i = emitIr(I_BR);
+  i->sub = op;
+  i->a = a;
+  i->b = b;
+  i->label = label;
+  return i;
+}
+
+static TokenType negate(TokenType op)
+{ switch (op) {
+  case LES: return BEQ;
+  case LEQ: return BIG;
+  case BIG: return LEQ;
+  case BEQ: return LES;
+  case EQ:  return NEQ;
+  default:  return EQ;
+  }
+}
+
+static int isRelop(TreeNode * t)
+{ if (t->nodekind != ExpK || t->kind != CalcK) return FALSE;
+  switch (t->child[1]->attr.op) {
+  case LES: case LEQ: case BIG: case BEQ: case EQ: case NEQ: return TRUE;
+  default: return FALSE;
+  }
+}
+
+/* Procedure lowerCond jumps to label when the value
+ * of t is (sense TRUE) or is not (sense FALSE) zero
+ */
+static void lowerCond(TreeNode * t, int sense, int label)
+{ IrOpnd a, b;
+  TokenType op;
+  if (isRelop(t)) {
+    a = stable(lowerExp(t->child[0]),t->child[2]);
+    b = lowerExp(t->child[2]);
+    op = t->child[1]->attr.op;
+    emitBranch(sense ? op : negate(op),a,b,label);
+  }
+  else emitBranch(sense ? NEQ : EQ,lowerExp(t),imm(0),label);
+}
+
+static void lowerStmt(TreeNode * t);
+
+/* Function coldSide returns 1 or 2 if the profile
+ * shows the then or else side of if statement t to
+ * be rare enough to be moved out of line, else 0;
+ * freq gets the counts of both sides
+ */
+static int coldSide(TreeNode * t, long * freq)
+{ int nth = nIfs++;
+  freq[0] = freq[1] = -1;
+  if (!ProfileUse) return 0;
+  freq[0] = pgoCount(cur->fun,stmtLine(t),"then",nth);
+  freq[1] = pgoCount(cur->fun,stmtLine(t),"else",nth);
+  if (freq[0] < 0 || freq[1] < 0) return 0;
+  if (freq[1] > 0 && PGOBIAS * freq[0] <= freq[1]) {
+    pgoNote(cur->fun,stmtLine(t),"then side (%ld runs) moved out of line, "
+            "else side (%ld) falls through",freq[0],freq[1]);
+    return 1;
+  }
+  /* without an else side the then side already
+   * falls through */
+  if (freq[0] > 0 && PGOBIAS * freq[1] <= freq[0] && t->child[2] != NULL) {
+    pgoNote(cur->fun,stmtLine(t),"else side (%ld runs) moved out of line",freq[1]);
+    return 2;
+  }
+  return 0;
+}
+
+/* Procedure lowerSide lowers the then (which 1) or
+ * else (which 2) side of if statement t, whose count
+ * in the profile is freq
+ */
+static void lowerSide(TreeNode * t, int which, long freq)
+{ long outer = curFreq;
+  long ceiling = blockFreq;
+  curLine = t->lineno;
+  if (freq >= 0) curFreq = blockFreq = freq;
+  if (Instrument) newCounter(stmtLine(t),which == 1 ? "then" : "else");
+  lowerStmt(t->child[which]);
+  curFreq = outer;
+  blockFreq = ceiling;
+}
+
+static void lowerStmt(TreeNode * t)
+{ IrOpnd v;
+  int l1, l2, side, from;
+  long freq[2];
+  long outer, ceiling;
+  for (; t != NULL; t = t->sibling) {
+    curLine = t->lineno;
+    if (!(t->nodekind == StmtK && t->kind == CompoundK)) {
+      if (ProfileUse) lineFreq(stmtLine(t));
+      if (Instrument) countLine(stmtLine(t));
+    }
+    if (t->nodekind != StmtK) {
+      if (t->nodekind == ExpK) lowerExp(t);
+      continue;
+    }
+    switch (t->kind) {
+    case CompoundK:
+      lowerStmt(t->child[1]);
+      break;
+    case IfK:
+      side = coldSide(t,freq);
+      l1 = newLabel();
+      l2 = newLabel();
+      /* a cold side is branched to and jumps back */
+      lowerCond(t->child[0],side == 1,l1);
+      if (side == 1) {
+        from = cur->ncode;
+        emitLabel(l1);
+      }
+      lowerSide(t,1,freq[0]);
+      if (side == 1) {
+        emitJump(l2);
+        moveCold(from);
+        lowerSide(t,2,freq[1]);
+        emitLabel(l2);
+      }
+      /* instrumented code counts the else side even
+       * when it is empty */
+      else if (t->child[2] != NULL || Instrument) {
+        if (side == 2) from = cur->ncode;
+        else emitJump(l2);
+        emitLabel(l1);
+        lowerSide(t,2,freq[1]);
+        if (side == 2) {
+          emitJump(l2);
+          moveCold(from);
+        }
+        emitLabel(l2);
+      }
+      else emitLabel(l1);
+      curCounter = -1;
+      break;
+    case WhileK:
+      /* the test is placed after the body, so each
+       * iteration takes a single branch */
+      l1 = newLabel();
+      l2 = newLabel();
+      emitJump(l2);
+      outer = curFreq;
+      ceiling = blockFreq;
+      freq[0] = ProfileUse ? pgoCount(cur->fun,stmtLine(t),"loop",nLoops) : -1;
+      nLoops++;
+      if (freq[0] >= 0) curFreq = blockFreq = freq[0];
+      loopDepth++;
+      emitLabel(l1);
+      cur->code[cur->ncode-1].lineno = stmtLine(t);
+      if (Instrument) newCounter(stmtLine(t),"loop");
+      lowerStmt(t->child[1]);
+      curLine = t->lineno;
+      /* the test also runs once per entry */
+      if (freq[0] >= 0 && outer >= 0) curFreq = freq[0] + outer;
+      emitLabel(l2);
+      lowerCond(t->child[0],TRUE,l1);
+      loopDepth--;
+      curFreq = outer;
+      blockFreq = ceiling;
+      curCounter = -1;
+      break;
+    case ReturnK:
+      v = t->child[0] != NULL ? lowerExp(t->child[0]) : none();
+      emitIr(I_RET)->a = v;
+      curCounter = -1;
+      break;
+    default:
+      lowerExp(t);
+      break;
+    }
+  }
+}
+
+/* Function localSlots numbers the local variables
+ * of the declaration lists in t: scalars get vregs,
+ * arrays byte offsets in the array area
+ */
+static void localSlots(TreeNode * t)
+{ int i;
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == DeclK && t->kind == varK) {
+      if (isArray(t)) {
+        declInfo(t)->offset = cur->arraybytes;
+        /* arrays are 16 byte aligned for vector code */
+        cur->arraybytes += (4 * arraySize(t) + 15) & ~15;
+      }
+      else declInfo(t)->offset = newTemp(FALSE).val;
+    }
+    else if (t->nodekind == StmtK)
+      for (i = 0; i < MAXCHILDREN; i++) localSlots(t->child[i]);
+  }
+}
+
+static IrFunc lowerFunction(TreeNode * f)
+{ TreeNode * p;
+  int k, first;
+  IrInstr * i;
+  cur = (IrFunc) calloc(1, sizeof(struct IrFuncRec));
+  cur->fun = f;
+  loopDepth = 0;
+  curLine = f->lineno;
+  for (p = f->child[1]; p != NULL; p = p->sibling)
+    if (arraySize(p) >= 0) cur->nparams++;
+  cur->params = (int *) malloc(sizeof(int) * (cur->nparams + 1));
+  cur->nparams = 0;
+  for (p = f->child[1]; p != NULL; p = p->sibling)
+    if (arraySize(p) >= 0) {
+      declInfo(p)->offset = newTemp(arraySize(p) > 0).val;
+      cur->params[cur->nparams++] = cellOffset(p);
+    }
+  first = cur->nvregs;
+  localSlots(f->child[2]);
+  nvars = cur->nvregs;
+  curCounter = -1;
+  nIfs = nLoops = 0;
+  ncold = 0;
+  curFreq = ProfileUse ? pgoCount(f,f->lineno,"entry",0) : -1;
+  blockFreq = curFreq;
+  if (Instrument) newCounter(f->lineno,"entry");
+  /* locals start at 0, as in the interpreter */
+  for (k = first; k < nvars; k++) {
+    i = emitIr(I_MOV);
+    i->dst = vreg(k);
+    i->a = imm(0);
+  }
+  lowerStmt(f->child[2]);
+  curLine = f->lineno;
+  emitIr(I_RET)->a = none();
+  if (ncold > 0) cur->coldLabel = coldCode[0].label;
+  for (k = 0; k < ncold; k++) *emitIr(I_LABEL) = coldCode[k];
+  return cur;
+}
+
+IrFunc lowerProgram(TreeNode * syntaxTree)
+{ IrFunc head = NULL;
+  IrFunc * link = &head;
+  TreeNode * t;
+  nIrCounters = nIrCounts = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind == funK) {
+      *link = lowerFunction(t);
+      link = &(*link)->next;
+    }
+  return head;
+}
+
+void freeIr(IrFunc f)
+{ IrFunc next;
+  int i;
+  for (; f != NULL; f = next) {
+    next = f->next;
+    for (i = 0; i < f->ncode; i++) free(f->code[i].args);
+    free(f->code);
+    free(f->isptr);
+    free(f->params);
+    free(f);
+  }
+}
+
+int irDef(IrInstr * ins)
+{ return ins->dst.kind == O_REG ? ins->dst.val : -1; }
+
+int irUses(IrInstr * ins, int * regs)
+{ int n = 0;
+  int i;
+  if (ins->a.kind == O_REG) regs[n++] = ins->a.val;
+  if (ins->b.kind == O_REG) regs[n++] = ins->b.val;
+  if (ins->c.kind == O_REG) regs[n++] = ins->c.val;
+  for (i = 0; i < ins->nargs; i++)
+    if (ins->args[i].kind == O_REG) regs[n++] = ins->args[i].val;
+  return n;
+}
+
+static char * opName(TokenType op)
+{ switch (op) {
+  case PLUS: return "+";
+  case MINUS: return "-";
+  case MUL: return "*";
+  case DIV: return "/";
+  case LES: return "<";
+  case LEQ: return "<=";
+  case BIG: return ">";
+  case BEQ: return ">=";
+  case EQ: return "==";
+  case NEQ: return "!=";
+  default: return "?";
+  }
+}
+
+static void printOpnd(FILE * out, IrOpnd o)
+{ if (o.kind == O_REG) fprintf(out,"v%d",o.val);
+  else if (o.kind == O_IMM) fprintf(out,"%d",o.val);
+  else if (o.kind == O_VEC) fprintf(out,"x%d",o.val);
+  else fprintf(out,"_");
+}
+
+void printIr(FILE * out, IrFunc f)
+{ IrInstr * i;
+  int k, j;
+  fprintf(out,"function %s (%d vregs)\n",f->fun->attr.name,f->nvregs);
+  for (k = 0; k < f->ncode; k++) {
+    i = &f->code[k];
+    if (i->op == I_LABEL) {
+      fprintf(out,"L%d:\n",i->label);
+      continue;
+    }
+    fprintf(out,"%4d  ",k);
+    switch (i->op) {
+    case I_JMP:
+      fprintf(out,"goto L%d",i->label);
+      break;
+    case I_BR:
+      fprintf(out,"if ");
+      printOpnd(out,i->a);
+      fprintf(out," %s ",opName(i->sub));
+      printOpnd(out,i->b);
+      fprintf(out," goto L%d",i->label);
+      break;
+    case I_MOV:
+      printOpnd(out,i->dst);
+      fprintf(out," = ");
+      printOpnd(out,i->a);
+      break;
+    case I_BIN:
+    case I_CMP:
+      printOpnd(out,i->dst);
+      fprintf(out," = ");
+      printOpnd(out,i->a);
+      fprintf(out," %s ",opName(i->sub));
+      printOpnd(out,i->b);
+      break;
+    case I_LOAD:
+      printOpnd(out,i->dst);
+      fprintf(out," = ");
+      printOpnd(out,i->a);
+      fprintf(out,"[");
+      printOpnd(out,i->b);
+      fprintf(out,"]");
+      break;
+    case I_STORE:
+      printOpnd(out,i->a);
+      fprintf(out,"[");
+      printOpnd(out,i->b);
+      fprintf(out,"] = ");
+      printOpnd(out,i->c);
+      break;
+    case I_CHECK:
+      fprintf(out,"check 0 <= ");
+      printOpnd(out,i->a);
+      fprintf(out," < ");
+      printOpnd(out,i->b);
+      break;
+    case I_VSPLAT:
+      printOpnd(out,i->dst);
+      fprintf(out," = splat ");
+      printOpnd(out,i->a);
+      break;
+    case I_VLOAD:
+      printOpnd(out,i->dst);
+      fprintf(out," = vector ");
+      printOpnd(out,i->a);
+      fprintf(out,"[");
+      printOpnd(out,i->b);
+      fprintf(out,"]");
+      break;
+    case I_VSTORE:
+      fprintf(out,"vector ");
+      printOpnd(out,i->a);
+      fprintf(out,"[");
+      printOpnd(out,i->b);
+      fprintf(out,"] = ");
+      printOpnd(out,i->c);
+      break;
+    case I_VBIN:
+      printOpnd(out,i->dst);
+      fprintf(out," = ");
+      printOpnd(out,i->a);
+      fprintf(out," %s ",opName(i->sub));
+      printOpnd(out,i->b);
+      break;
+    case I_VEND:
+      fprintf(out,"end vector");
+      break;
+    case I_PADD:
+      printOpnd(out,i->dst);
+      fprintf(out," = ");
+      printOpnd(out,i->a);
+      fprintf(out," + 4*");
+      printOpnd(out,i->b);
+      break;
+    case I_ADDR:
+      printOpnd(out,i->dst);
+      fprintf(out," = &%s",i->sym->attr.name);
+      break;
+    case I_GLOAD:
+      printOpnd(out,i->dst);
+      fprintf(out," = %s",i->sym->attr.name);
+      break;
+    case I_GSTORE:
+      fprintf(out,"%s = ",i->sym->attr.name);
+      printOpnd(out,i->a);
+      break;
+    case I_CALL:
+      if (i->dst.kind != O_NONE) {
+        printOpnd(out,i->dst);
+        fprintf(out," = ");
+      }
+      fprintf(out,"%s(",i->sym->attr.name);
+      for (j = 0; j < i->nargs; j++) {
+        if (j) fprintf(out,", ");
+        printOpnd(out,i->args[j]);
+      }
+      fprintf(out,")");
+      break;
+    case I_RET:
+      fprintf(out,"return ");
+      printOpnd(out,i->a);
+      break;
+    case I_COUNT:
+      fprintf(out,"count ");
+      printOpnd(out,i->a);
+      fprintf(out," += ");
+      printOpnd(out,i->b);
+      break;
+    default:
+      break;
+    }
+    fprintf(out,"\n");
+  }
+}
@@ -0,0 +1,130 @@
+/****************************************************/
+/* File: ir.h                                       */
+/* Three-address intermediate code for the C-       */
+/* compiler's native backend                        */
+/****************************************************/
+
+#ifndef _IR_H_
+#define _IR_H_
+
+typedef enum
+{ I_LABEL,  /* label: */
+  I_JMP,    /* goto label */
+  I_BR,     /* if a sub b goto label */
+  I_MOV,    /* dst = a */
+  I_BIN,    /* dst = a sub b, sub one of + - * / */
+  I_CMP,    /* dst = a sub b, sub a relational op */
+  I_LOAD,   /* dst = a[b], a an array base */
+  I_STORE,  /* a[b] = c */
+  I_CHECK,  /* fail unless 0 <= a < b, sym the array */
+  I_ADDR,   /* dst = address of array sym */
+  I_PADD,   /* dst = a + 4*b, a an address */
+  I_GLOAD,  /* dst = global scalar sym */
+  I_GSTORE, /* global scalar sym = a */
+  I_CALL,   /* dst = sym(args) */
+  I_RET,    /* return a */
+  I_COUNT,  /* execution counter a += b */
+  I_VSPLAT, /* vector dst = a in every lane */
+  I_VLOAD,  /* vector dst = a[b], a[b+1], ... */
+  I_VSTORE, /* a[b], a[b+1], ... = vector c */
+  I_VBIN,   /* vector dst = a sub b, lane by lane */
+  I_VEND    /* end of vector code */
+} IrOp;
+
+/* operand kinds */
+#define O_NONE 0
+#define O_REG  1 /* virtual register */
+#define O_IMM  2 /* constant */
+#define O_VEC  3 /* vector register, numbered by loop.c */
+
+typedef struct
+{ int kind;
+  int val;
+} IrOpnd;
+
+typedef struct
+{ IrOp op;
+  TokenType sub;        /* operator of I_BIN, I_CMP, I_BR */
+  IrOpnd dst, a, b, c;
+  TreeNode * sym;       /* array, global or callee */
+  IrOpnd * args;        /* arguments of I_CALL */
+  int nargs;
+  int label;            /* target of I_JMP and I_BR, number of I_LABEL */
+  int lineno;
+  int depth;            /* while loop nesting depth */
+  long freq;            /* executions in the profile, -1 if unknown */
+} IrInstr;
+
+typedef struct IrFuncRec
+{ TreeNode * fun;
+  IrInstr * code;
+  int ncode, maxcode;
+  int nvregs, maxvregs;
+  char * isptr;         /* vreg holds an array address */
+  int * params;         /* vreg of each parameter */
+  int nparams;
+  int arraybytes;       /* frame bytes taken by local arrays */
+  int coldLabel;        /* starts the code moved behind the end, or 0 */
+  struct IrFuncRec * next;
+} * IrFunc;
+
+/* an execution counter of instrumented code and the
+ * source position it is reported under; counters
+ * can be shared by several records
+ */
+typedef struct
+{ TreeNode * fun;
+  int lineno;
+  char * kind; /* entry, line, then, else or loop */
+  int counter;
+} IrCounter;
+
+/* the records and the number of counters of the
+ * program lowered last, when Instrument is set
+ */
+extern IrCounter * irCounters;
+extern int nIrCounters;
+extern int nIrCounts;
+
+/* Function lowerProgram translates every function
+ * of the analyzed syntax tree; local scalars become
+ * virtual registers and local arrays frame offsets.
+ * With a profile, instructions carry the counts of
+ * their blocks, the head of a loop the line of its
+ * test, and the rarely taken side of an if is moved
+ * after the end of the function
+ */
+IrFunc lowerProgram(TreeNode *);
+
+/* Function irNewVreg adds a vreg to f and returns
+ * its number
+ */
+int irNewVreg(IrFunc f, int isptr);
+
+/* Function irNewLabel returns an unused label */
+int irNewLabel(void);
+
+/* Function irInsert makes room for an instruction
+ * at index at of f and returns it; line, loop depth
+ * and count are taken from the instruction it
+ * precedes
+ */
+IrInstr * irInsert(IrFunc f, int at);
+
+/* Procedure freeIr releases a list of functions */
+void freeIr(IrFunc);
+
+/* Procedure printIr writes the code of f to out */
+void printIr(FILE * out, IrFunc f);
+
+/* Function irUses stores the vregs read by ins in
+ * regs and returns their number
+ */
+int irUses(IrInstr * ins, int * regs);
+
+/* Function irDef returns the vreg written by ins,
+ * or -1
+ */
+int irDef(IrInstr * ins);
+
+#endif
@@ -0,0 +1,771 @@
+/****************************************************/
+/* File: loop.c                                     */
+/* Loop optimizations for the C- compiler           */
+/* Loops are found in the rotated form produced by  */
+/* ir.c (jump to the test, body, test branching     */
+/* back). An induction variable is a vreg whose     */
+/* only changes in the loop add constants to it.    */
+/* Accesses a[i+k] then use a pointer kept equal to */
+/* a+4*i, and small straight-line counted loops are */
+/* unrolled in front of the original loop, which    */
+/* runs the remaining iterations. Loops without     */
+/* dependences between nearby iterations can be     */
+/* vectorized the same way.                         */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "ir.h"
+#include "pgo.h"
+#include "loop.h"
+
+/* MAXPTRS bounds the pointers introduced in one
+ * loop, as each of them takes a register
+ */
+#define MAXPTRS 4
+
+/* the function being optimized */
+static IrFunc f;
+
+/* what was done to the loops of each function */
+typedef struct LoopStatRec
+{ char * name;
+  int loops, vectorized, unrolled, reduced;
+  struct LoopStatRec * next;
+} * LoopStat;
+
+static LoopStat stats = NULL;
+static LoopStat * lastStat = &stats;
+
+static IrOpnd imm(int v)
+{ IrOpnd o;
+  o.kind = O_IMM;
+  o.val = v;
+  return o;
+}
+
+static IrOpnd vreg(int r)
+{ IrOpnd o;
+  o.kind = O_REG;
+  o.val = r;
+  return o;
+}
+
+static int findLabel(int l)
+{ int k;
+  for (k = 0; k < f->ncode; k++)
+    if (f->code[k].op == I_LABEL && f->code[k].label == l) return k;
+  return -1;
+}
+
+static int isControl(IrInstr * i)
+{ return i->op == I_LABEL || i->op == I_JMP || i->op == I_BR || i->op == I_RET; }
+
+/* Function locate finds the loop whose body starts
+ * at label head: s is that label, pre the jump to
+ * the test at label c, and e the branch back to s
+ */
+static int locate(int head, int * pre, int * s, int * c, int * e)
+{ int k;
+  *s = findLabel(head);
+  if (*s < 1) return FALSE;
+  *e = -1;
+  for (k = *s + 1; k < f->ncode; k++)
+    if (f->code[k].op == I_BR && f->code[k].label == head) *e = k;
+  *pre = *s - 1;
+  if (*e < 0 || f->code[*pre].op != I_JMP) return FALSE;
+  *c = findLabel(f->code[*pre].label);
+  return *c > *s && *c < *e;
+}
+
+/* Function collectHeads returns the labels that
+ * start loops, in code order
+ */
+static int collectHeads(int ** heads)
+{ int k, n = 0, pre, s, c, e;
+  *heads = (int *) malloc(sizeof(int) * (f->ncode + 1));
+  for (k = 0; k < f->ncode; k++)
+    if (f->code[k].op == I_LABEL && locate(f->code[k].label,&pre,&s,&c,&e))
+      (*heads)[n++] = f->code[k].label;
+  return n;
+}
+
+static int defsIn(int v, int s, int e)
+{ int k, n = 0;
+  for (k = s; k <= e; k++)
+    if (irDef(&f->code[k]) == v) n++;
+  return n;
+}
+
+/* Function coldDefs is TRUE if v is changed by code
+ * moved out of line, other than in the loop s..e;
+ * such code may run in the middle of an iteration
+ */
+static int coldDefs(int v, int s, int e)
+{ int k = f->coldLabel ? findLabel(f->coldLabel) : -1;
+  int n;
+  if (k < 0) return FALSE;
+  n = defsIn(v,k,f->ncode - 1);
+  if (s >= k) n -= defsIn(v,s,e);
+  return n > 0;
+}
+
+/* Function isInc is TRUE if i computes v plus a
+ * constant, which is stored in c
+ */
+static int isInc(IrInstr * i, int v, int * c)
+{ if (i->op != I_BIN || i->a.kind != O_REG || i->a.val != v || i->b.kind != O_IMM)
+    return FALSE;
+  if (i->sub == PLUS) *c = i->b.val;
+  else if (i->sub == MINUS) *c = -i->b.val;
+  else return FALSE;
+  return TRUE;
+}
+
+/* Function stepAt returns TRUE if instruction k
+ * increments v by a constant, stored in c: either
+ * v = v + c, or t = v + c; v = t
+ */
+static int stepAt(int k, int v, int * c)
+{ IrInstr * i = &f->code[k];
+  if (i->dst.kind != O_REG || i->dst.val != v) return FALSE;
+  if (isInc(i,v,c)) return TRUE;
+  return i->op == I_MOV && i->a.kind == O_REG && k > 0 &&
+         f->code[k-1].dst.kind == O_REG && f->code[k-1].dst.val == i->a.val &&
+         isInc(&f->code[k-1],v,c);
+}
+
+/* Function isInduction is TRUE if every definition
+ * of v in [s,e] is a constant increment; their sum
+ * is stored in step
+ */
+static int isInduction(int v, int s, int e, int * step)
+{ int k, c, n = 0;
+  *step = 0;
+  if (f->isptr[v]) return FALSE;
+  for (k = s; k <= e; k++) {
+    if (irDef(&f->code[k]) != v) continue;
+    if (!stepAt(k,v,&c)) return FALSE;
+    *step += c;
+    n++;
+  }
+  return n > 0;
+}
+
+/* Function blockDef returns the index of the
+ * definition of v reaching k from within its
+ * basic block, or -1
+ */
+static int blockDef(int v, int k)
+{ for (k--; k >= 0 && !isControl(&f->code[k]); k--)
+    if (irDef(&f->code[k]) == v) return k;
+  return -1;
+}
+
+/* a pointer introduced for the accesses to one
+ * array through one induction variable
+ */
+typedef struct
+{ int iv;
+  TreeNode * sym;  /* array whose address is taken, or */
+  int base;        /* vreg holding the array address */
+  int ptr;
+} PtrGroup;
+
+/* Function reduce rewrites the accesses of the loop
+ * at head and returns how many were changed
+ */
+static int reduce(int head)
+{ PtrGroup g[MAXPTRS];
+  int ng = 0, nred = 0;
+  int pre, s, c, e, k, d, j, iv, off, step, base;
+  TreeNode * sym;
+  IrInstr * i;
+  IrInstr * ins;
+  if (!locate(head,&pre,&s,&c,&e)) return 0;
+  for (k = s + 1; k < e; k++) {
+    i = &f->code[k];
+    if ((i->op != I_LOAD && i->op != I_STORE && i->op != I_VLOAD && i->op != I_VSTORE) ||
+        i->b.kind != O_REG || i->a.kind != O_REG)
+      continue;
+    /* the index: iv or iv plus a constant */
+    iv = -1;
+    off = 0;
+    if (isInduction(i->b.val,s,e,&step)) iv = i->b.val;
+    else if ((d = blockDef(i->b.val,k)) >= 0 && f->code[d].op == I_BIN &&
+             f->code[d].a.kind == O_REG && f->code[d].b.kind == O_IMM &&
+             (f->code[d].sub == PLUS || f->code[d].sub == MINUS) &&
+             isInduction(f->code[d].a.val,s,e,&step)) {
+      iv = f->code[d].a.val;
+      off = f->code[d].sub == PLUS ? f->code[d].b.val : -f->code[d].b.val;
+      for (j = d + 1; j < k; j++)
+        if (irDef(&f->code[j]) == iv) iv = -1;
+    }
+    if (iv < 0 || off > INT_MAX / 4 || off < INT_MIN / 4 || coldDefs(iv,s,e)) continue;
+    /* the array: taken by I_ADDR or held in a vreg
+     * the loop does not change */
+    sym = NULL;
+    base = -1;
+    if ((d = blockDef(i->a.val,k)) >= 0 && f->code[d].op == I_ADDR) sym = f->code[d].sym;
+    else if (d < 0 && f->isptr[i->a.val] && defsIn(i->a.val,s,e) == 0 &&
+             !coldDefs(i->a.val,s,e))
+      base = i->a.val;
+    else continue;
+    for (j = 0; j < ng; j++)
+      if (g[j].iv == iv && g[j].sym == sym && g[j].base == base) break;
+    if (j == ng) {
+      if (ng == MAXPTRS) continue;
+      g[ng].iv = iv;
+      g[ng].sym = sym;
+      g[ng].base = base;
+      g[ng].ptr = irNewVreg(f,TRUE);
+      ng++;
+    }
+    i->a = vreg(g[j].ptr);
+    i->b = imm(off);
+    nred++;
+  }
+  for (j = 0; j < ng; j++) {
+    locate(head,&pre,&s,&c,&e);
+    /* advance the pointer with the variable */
+    for (k = e; k > s; k--)
+      if (irDef(&f->code[k]) == g[j].iv) {
+        stepAt(k,g[j].iv,&step);
+        ins = irInsert(f,k+1);
+        ins->lineno = f->code[k].lineno;
+        ins->depth = f->code[k].depth;
+        ins->op = I_PADD;
+        ins->dst = ins->a = vreg(g[j].ptr);
+        ins->b = imm(step);
+      }
+    /* and set it before the loop */
+    ins = irInsert(f,pre);
+    ins->op = I_PADD;
+    ins->dst = vreg(g[j].ptr);
+    ins->b = vreg(g[j].iv);
+    if (g[j].sym != NULL) {
+      ins->a = vreg(irNewVreg(f,TRUE));
+      ins = irInsert(f,pre);
+      ins->op = I_ADDR;
+      ins->dst = f->code[pre+1].a;
+      ins->sym = g[j].sym;
+    }
+    else ins->a = vreg(g[j].base);
+  }
+  return nred;
+}
+
+/* Function countedTest emits at index at the test
+ * of the loop whose own test is br (v < n or v <= n)
+ * branching to label target while the test holds
+ * for v + gap; it returns the index after the test
+ */
+static int countedTest(int at, IrInstr * br, long gap, int target)
+{ IrInstr * ins;
+  int lout, t;
+  ins = irInsert(f,at++);
+  *ins = *br;
+  ins->label = target;
+  if (br->b.kind == O_IMM) {
+    ins->b = imm(br->b.val - gap);
+    return at;
+  }
+  /* v + gap < n, tested only where v + gap cannot
+   * wrap around */
+  lout = irNewLabel();
+  ins->sub = BIG;
+  ins->b = imm(INT_MAX - gap);
+  ins->label = lout;
+  t = irNewVreg(f,FALSE);
+  ins = irInsert(f,at++);
+  *ins = *br;
+  ins->op = I_BIN;
+  ins->sub = PLUS;
+  ins->dst = vreg(t);
+  ins->b = imm(gap);
+  ins = irInsert(f,at++);
+  *ins = *br;
+  ins->a = vreg(t);
+  ins->label = target;
+  irInsert(f,at++)->op = I_LABEL;
+  f->code[at-1].label = lout;
+  return at;
+}
+
+/* Function unroll puts in front of the loop at head
+ * a copy whose body is repeated factor times and
+ * which runs while factor more iterations remain;
+ * the loop must have a straight-line body, a test
+ * v < n or v <= n with n fixed, and v increasing.
+ * Unless apply is set it only tells if it could
+ */
+static int unroll(int head, int factor, int apply)
+{ int pre, s, c, e, k, u, step, nbody, at;
+  int l1, l2;
+  long gap;
+  IrInstr br;
+  IrInstr * body;
+  IrInstr * ins;
+  if (!locate(head,&pre,&s,&c,&e) || c + 1 != e) return FALSE;
+  br = f->code[e];
+  if ((br.sub != LES && br.sub != LEQ) || br.a.kind != O_REG) return FALSE;
+  if (br.b.kind == O_REG && (br.b.val == br.a.val || defsIn(br.b.val,s,e) > 0))
+    return FALSE;
+  nbody = c - s - 1;
+  if (nbody < 1 || nbody > UNROLLBODY) return FALSE;
+  for (k = s + 1; k < c; k++)
+    if (isControl(&f->code[k])) return FALSE;
+  if (!isInduction(br.a.val,s + 1,c - 1,&step) || step <= 0) return FALSE;
+  gap = (long) (factor - 1) * step;
+  if (gap > INT_MAX / 2) return FALSE;
+  if (br.b.kind == O_IMM && br.b.val - gap < INT_MIN) return FALSE;
+  if (!apply) return TRUE;
+  body = (IrInstr *) malloc(sizeof(IrInstr) * nbody);
+  memcpy(body,&f->code[s+1],sizeof(IrInstr) * nbody);
+  l1 = irNewLabel();
+  l2 = irNewLabel();
+  at = pre;
+  irInsert(f,at++)->op = I_JMP;
+  f->code[at-1].label = l2;
+  irInsert(f,at++)->op = I_LABEL;
+  f->code[at-1].label = l1;
+  for (u = 0; u < factor; u++)
+    for (k = 0; k < nbody; k++) {
+      /* a counter of the body counts all the copies */
+      if (body[k].op == I_COUNT && u > 0) continue;
+      ins = irInsert(f,at++);
+      *ins = body[k];
+      if (body[k].op == I_COUNT) ins->b.val *= factor;
+      /* every copy owns its arguments, even none */
+      if (body[k].args != NULL) {
+        ins->args = (IrOpnd *) malloc(sizeof(IrOpnd) * (body[k].nargs + 1));
+        memcpy(ins->args,body[k].args,sizeof(IrOpnd) * body[k].nargs);
+      }
+    }
+  irInsert(f,at++)->op = I_LABEL;
+  f->code[at-1].label = l2;
+  countedTest(at,&br,gap,l1);
+  free(body);
+  return TRUE;
+}
+
+/* MAXVECS is the number of vector registers */
+#define MAXVECS 16
+
+/* NOIDX marks a vreg that is not an index */
+#define NOIDX INT_MIN
+
+/* an array access of a loop being vectorized */
+typedef struct
+{ int store;
+  int base;        /* vreg holding the array address */
+  TreeNode * sym;  /* the array, if known */
+  int off;         /* index: induction variable plus off */
+  int pos;         /* place in the vector body */
+} Access;
+
+/* the state of the vectorizer: the loop and its
+ * induction variable, what the vregs of the body
+ * became, the code before the loop and the body
+ */
+static int vs, ve, viv, vnv;
+static int * vecOf;
+static int * offOf;
+static TreeNode ** addrOf;
+static TreeNode * ptrSym[MAXVECS];
+static int ptrReg[MAXVECS], nptrs;
+static IrOpnd splatOf[MAXVECS];
+static int splatVec[MAXVECS], nsplats;
+static int nvecs;
+static IrInstr * vpre;
+static int nvpre;
+static IrInstr * vbody;
+static int nvbody;
+static Access * acc;
+static int nacc;
+
+static IrOpnd vec(int x)
+{ IrOpnd o;
+  o.kind = O_VEC;
+  o.val = x;
+  return o;
+}
+
+static IrInstr * vput(IrInstr * buf, int * n, IrOp op)
+{ IrInstr * i = &buf[(*n)++];
+  memset(i,0,sizeof(IrInstr));
+  i->op = op;
+  return i;
+}
+
+/* operands the loop does not change */
+static int invariant(IrOpnd o)
+{ if (o.kind == O_IMM) return TRUE;
+  return o.kind == O_REG && o.val < vnv && o.val != viv && !f->isptr[o.val] &&
+         defsIn(o.val,vs,ve) == 0;
+}
+
+/* Function indexOf returns TRUE if o is the
+ * induction variable plus a constant, stored in off
+ */
+static int indexOf(IrOpnd o, int * off)
+{ if (o.kind != O_REG || o.val >= vnv) return FALSE;
+  if (o.val == viv) *off = 0;
+  else if (offOf[o.val] != NOIDX) *off = offOf[o.val];
+  else return FALSE;
+  return TRUE;
+}
+
+/* Function baseOf returns the vreg holding the
+ * array address a, set before the loop, or -1
+ */
+static int baseOf(IrOpnd a, TreeNode ** sym)
+{ int k;
+  IrInstr * i;
+  *sym = NULL;
+  if (a.kind != O_REG || a.val >= vnv) return -1;
+  if (addrOf[a.val] == NULL)
+    return f->isptr[a.val] && defsIn(a.val,vs,ve) == 0 ? a.val : -1;
+  *sym = addrOf[a.val];
+  for (k = 0; k < nptrs; k++)
+    if (ptrSym[k] == *sym) return ptrReg[k];
+  if (nptrs == MAXVECS) return -1;
+  ptrSym[nptrs] = *sym;
+  ptrReg[nptrs] = irNewVreg(f,TRUE);
+  i = vput(vpre,&nvpre,I_ADDR);
+  i->dst = vreg(ptrReg[nptrs]);
+  i->sym = *sym;
+  return ptrReg[nptrs++];
+}
+
+/* Function vecOperand returns the vector register
+ * holding o in every lane, or -1
+ */
+static int vecOperand(IrOpnd o)
+{ int k;
+  IrInstr * i;
+  if (o.kind == O_REG && o.val < vnv && vecOf[o.val] >= 0) return vecOf[o.val];
+  if (!invariant(o)) return -1;
+  for (k = 0; k < nsplats; k++)
+    if (splatOf[k].kind == o.kind && splatOf[k].val == o.val) return splatVec[k];
+  if (nsplats == MAXVECS || nvecs == MAXVECS) return -1;
+  splatOf[nsplats] = o;
+  splatVec[nsplats] = nvecs++;
+  i = vput(vpre,&nvpre,I_VSPLAT);
+  i->dst = vec(splatVec[nsplats]);
+  i->a = o;
+  return splatVec[nsplats++];
+}
+
+static void addAccess(int store, int base, TreeNode * sym, int off)
+{ acc[nacc].store = store;
+  acc[nacc].base = base;
+  acc[nacc].sym = sym;
+  acc[nacc].off = off;
+  acc[nacc].pos = nvbody;
+  nacc++;
+}
+
+/* Function vecBody translates the body of the loop
+ * to vector code, and returns FALSE if it has code
+ * that cannot be done on all lanes at once
+ */
+static int vecBody(int w)
+{ int k, j, n, off, a, b, base, step, bumped = FALSE;
+  int regs[64 + 3];
+  TreeNode * sym;
+  IrInstr * i;
+  IrInstr * v;
+  for (k = vs + 1; k < ve - 1; k++) {
+    i = &f->code[k];
+    /* values computed in the body stay in it */
+    if ((j = irDef(i)) >= 0 && j != viv)
+      for (n = 0; n < f->ncode; n++)
+        if (n < vs || n > ve) {
+          int m, r = irUses(&f->code[n],regs);
+          for (m = 0; m < r; m++)
+            if (regs[m] == j) return FALSE;
+        }
+    if (stepAt(k,viv,&step)) {
+      bumped = TRUE;
+      continue;
+    }
+    if (bumped) {
+      n = irUses(i,regs);
+      for (j = 0; j < n; j++)
+        if (regs[j] == viv) return FALSE;
+    }
+    switch (i->op) {
+    case I_ADDR:
+      addrOf[i->dst.val] = i->sym;
+      break;
+    case I_BIN:
+      if ((i->sub == PLUS || i->sub == MINUS) && indexOf(i->a,&off) && i->b.kind == O_IMM) {
+        offOf[i->dst.val] = i->sub == PLUS ? off + i->b.val : off - i->b.val;
+        /* the increment itself is redone by w */
+        if (!stepAt(k + 1,viv,&step)) *vput(vbody,&nvbody,I_BIN) = *i;
+        break;
+      }
+      if (i->sub == DIV || (i->sub == MUL && VectorISA != 2)) return FALSE;
+      if ((a = vecOperand(i->a)) < 0 || (b = vecOperand(i->b)) < 0) return FALSE;
+      if (nvecs == MAXVECS) return FALSE;
+      vecOf[i->dst.val] = nvecs++;
+      v = vput(vbody,&nvbody,I_VBIN);
+      v->sub = i->sub;
+      v->dst = vec(vecOf[i->dst.val]);
+      v->a = vec(a);
+      v->b = vec(b);
+      v->lineno = i->lineno;
+      break;
+    case I_CHECK:
+      /* the first and the last lane are checked */
+      if (!indexOf(i->a,&off)) return FALSE;
+      *vput(vbody,&nvbody,I_CHECK) = *i;
+      v = vput(vbody,&nvbody,I_BIN);
+      v->sub = PLUS;
+      v->dst = vreg(irNewVreg(f,FALSE));
+      v->a = i->a;
+      v->b = imm(w - 1);
+      v->lineno = i->lineno;
+      *vput(vbody,&nvbody,I_CHECK) = *i;
+      vbody[nvbody-1].a = v->dst;
+      break;
+    case I_LOAD:
+      if ((base = baseOf(i->a,&sym)) < 0 || !indexOf(i->b,&off)) return FALSE;
+      if (nvecs == MAXVECS) return FALSE;
+      vecOf[i->dst.val] = nvecs++;
+      addAccess(FALSE,base,sym,off);
+      v = vput(vbody,&nvbody,I_VLOAD);
+      v->dst = vec(vecOf[i->dst.val]);
+      v->a = vreg(base);
+      v->b = i->b;
+      v->lineno = i->lineno;
+      break;
+    case I_STORE:
+      if ((base = baseOf(i->a,&sym)) < 0 || !indexOf(i->b,&off)) return FALSE;
+      if ((a = vecOperand(i->c)) < 0) return FALSE;
+      addAccess(TRUE,base,sym,off);
+      v = vput(vbody,&nvbody,I_VSTORE);
+      v->a = vreg(base);
+      v->b = i->b;
+      v->c = vec(a);
+      v->lineno = i->lineno;
+      break;
+    default:
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/* Function conflict is TRUE if store x and access y
+ * to the same array carry a value from one iteration
+ * to another that the lanes of one vector step
+ * would see in the wrong order
+ */
+static int conflict(Access * x, Access * y, int w)
+{ int d;
+  if (y->store) {
+    d = y->off - x->off;
+    return y->pos > x->pos && d > 0 && d < w;
+  }
+  d = x->off - y->off;
+  if (d > 0) return d < w && y->pos < x->pos;
+  return d < 0 && -d < w && x->pos < y->pos;
+}
+
+/* Function vectorize replaces the loop at head, in
+ * front of the scalar loop, by one doing w = 4 or 8
+ * iterations per step with SSE2 or AVX2 code, when
+ * the body only adds, subtracts or (AVX2) multiplies
+ * elements a[i+k] of arrays and values the loop does
+ * not change, and no iteration depends on a value
+ * computed by one of the previous w-1. Arrays that
+ * are parameters may be the same array, which is
+ * tested before the loop; the scalar loop then does
+ * all the work.
+ */
+static int vectorize(int head)
+{ int pre, s, c, e, k, j, at, step, w = VectorISA == 2 ? 8 : 4;
+  int ok, lvb, lvt, lscalar;
+  IrInstr br;
+  IrInstr * ins;
+  int * test;
+  int ntests = 0;
+  if (!locate(head,&pre,&s,&c,&e) || c + 1 != e) return FALSE;
+  br = f->code[e];
+  if ((br.sub != LES && br.sub != LEQ) || br.a.kind != O_REG) return FALSE;
+  if (br.b.kind == O_REG && (br.b.val == br.a.val || defsIn(br.b.val,s,e) > 0))
+    return FALSE;
+  if (br.b.kind == O_IMM && (long) br.b.val - (w - 1) < INT_MIN) return FALSE;
+  if (c - s - 1 > UNROLLBODY * 4) return FALSE;
+  for (k = s + 1; k < c; k++)
+    if (isControl(&f->code[k])) return FALSE;
+  viv = br.a.val;
+  if (!isInduction(viv,s + 1,c - 1,&step) || step != 1 || defsIn(viv,s + 1,c - 1) != 1)
+    return FALSE;
+  vs = s;
+  ve = e;
+  vnv = f->nvregs;
+  vecOf = (int *) malloc(sizeof(int) * vnv);
+  offOf = (int *) malloc(sizeof(int) * vnv);
+  addrOf = (TreeNode **) calloc(vnv, sizeof(TreeNode *));
+  for (k = 0; k < vnv; k++) {
+    vecOf[k] = -1;
+    offOf[k] = NOIDX;
+  }
+  nptrs = nsplats = nvecs = nvpre = nvbody = nacc = 0;
+  vpre = (IrInstr *) malloc(sizeof(IrInstr) * (2 * MAXVECS + 1));
+  vbody = (IrInstr *) malloc(sizeof(IrInstr) * (3 * (c - s) + 1));
+  acc = (Access *) malloc(sizeof(Access) * (c - s + 1));
+  test = (int *) malloc(sizeof(int) * 2 * (c - s + 1) * (c - s + 1));
+  ok = vecBody(w) && nacc > 0;
+  /* dependences: fatal within an array, tested
+   * between arrays that may be the same */
+  for (j = 0; ok && j < nacc; j++)
+    for (k = 0; ok && k < nacc; k++) {
+      if (j == k || !acc[j].store || !conflict(&acc[j],&acc[k],w)) continue;
+      if (acc[j].base == acc[k].base) ok = FALSE;
+      else if (acc[j].sym == NULL || acc[k].sym == NULL) {
+        test[2*ntests] = acc[j].base;
+        test[2*ntests+1] = acc[k].base;
+        ntests++;
+      }
+    }
+  if (ok) {
+    lvb = irNewLabel();
+    lvt = irNewLabel();
+    lscalar = irNewLabel();
+    at = pre;
+    for (k = 0; k < nvpre; k++) {
+      ins = irInsert(f,at++);
+      vpre[k].lineno = ins->lineno;
+      vpre[k].depth = ins->depth;
+      *ins = vpre[k];
+    }
+    for (k = 0; k < ntests; k++) {
+      ins = irInsert(f,at++);
+      ins->op = I_BR;
+      ins->sub = EQ;
+      ins->a = vreg(test[2*k]);
+      ins->b = vreg(test[2*k+1]);
+      ins->label = lscalar;
+    }
+    irInsert(f,at++)->op = I_JMP;
+    f->code[at-1].label = lvt;
+    irInsert(f,at++)->op = I_LABEL;
+    f->code[at-1].label = lvb;
+    for (k = 0; k < nvbody; k++) {
+      ins = irInsert(f,at++);
+      vbody[k].depth = br.depth;
+      if (vbody[k].lineno == 0) vbody[k].lineno = br.lineno;
+      *ins = vbody[k];
+    }
+    ins = irInsert(f,at++);
+    ins->op = I_BIN;
+    ins->sub = PLUS;
+    ins->dst = ins->a = vreg(viv);
+    ins->b = imm(w);
+    ins->depth = br.depth;
+    irInsert(f,at++)->op = I_LABEL;
+    f->code[at-1].label = lvt;
+    at = countedTest(at,&br,w - 1,lvb);
+    irInsert(f,at++)->op = I_VEND;
+    irInsert(f,at++)->op = I_LABEL;
+    f->code[at-1].label = lscalar;
+  }
+  free(vecOf);
+  free(offOf);
+  free(addrOf);
+  free(vpre);
+  free(vbody);
+  free(acc);
+  free(test);
+  return ok;
+}
+
+/* Procedure deadCode removes the computations whose
+ * results are never used
+ */
+static void deadCode(void)
+{ int * uses = (int *) malloc(sizeof(int) * (f->nvregs + 1));
+  int regs[64 + 3];
+  int k, j, n, changed = TRUE;
+  IrInstr * i;
+  while (changed) {
+    changed = FALSE;
+    memset(uses,0,sizeof(int) * f->nvregs);
+    for (k = 0; k < f->ncode; k++) {
+      n = irUses(&f->code[k],regs);
+      for (j = 0; j < n; j++) uses[regs[j]]++;
+    }
+    for (k = j = 0; k < f->ncode; k++) {
+      i = &f->code[k];
+      if (i->dst.kind == O_REG && uses[i->dst.val] == 0 &&
+          (i->op == I_MOV || i->op == I_ADDR || i->op == I_PADD || i->op == I_CMP ||
+           (i->op == I_BIN && i->sub != DIV))) {
+        changed = TRUE;
+        continue;
+      }
+      f->code[j++] = *i;
+    }
+    f->ncode = j;
+  }
+  free(uses);
+}
+
+/* Function loopFactor returns the unroll factor of
+ * the loop at head: factor, unless the profile knows
+ * how often the loop ran and how many iterations it
+ * took
+ */
+static int loopFactor(int head, int factor)
+{ int pre, s, c, e, k;
+  if (!ProfileUse || factor < 2 || !locate(head,&pre,&s,&c,&e)) return factor;
+  if (f->code[s].freq < 0 || f->code[pre].freq < 0) return factor;
+  k = pgoUnroll(f->code[s].freq,f->code[pre].freq,factor);
+  if (k != factor && unroll(head,factor,FALSE)) {
+    if (k > 1)
+      pgoNote(f->fun,f->code[s].lineno,"loop unrolled %d times, not %d (%ld iterations in %ld runs)",
+              k,factor,f->code[s].freq,f->code[pre].freq);
+    else
+      pgoNote(f->fun,f->code[s].lineno,"loop not unrolled (%ld iterations in %ld runs)",
+              f->code[s].freq,f->code[pre].freq);
+  }
+  return k;
+}
+
+void optimizeLoops(IrFunc fn, int factor)
+{ int * heads;
+  int n, k, uf;
+  LoopStat st = (LoopStat) calloc(1, sizeof(struct LoopStatRec));
+  f = fn;
+  st->name = f->fun->attr.name;
+  n = collectHeads(&heads);
+  st->loops = n;
+  for (k = 0; k < n; k++)
+    if (VectorISA && vectorize(heads[k])) st->vectorized++;
+    else if ((uf = loopFactor(heads[k],factor)) > 1 && unroll(heads[k],uf,TRUE))
+      st->unrolled++;
+  free(heads);
+  n = collectHeads(&heads);
+  for (k = 0; k < n; k++) st->reduced += reduce(heads[k]);
+  free(heads);
+  deadCode();
+  *lastStat = st;
+  lastStat = &st->next;
+}
+
+void loopReport(FILE * out)
+{ LoopStat st, next;
+  fprintf(out,"\nFunction        Loops    Vector   Unrolled Reduced\n");
+  fprintf(out,"--------------  -------- -------- -------- --------\n");
+  for (st = stats; st != NULL; st = next) {
+    next = st->next;
+    fprintf(out,"%-14s  %-8d %-8d %-8d %d\n",st->name,st->loops,st->vectorized,
+            st->unrolled,st->reduced);
+    free(st);
+  }
+  stats = NULL;
+  lastStat = &stats;
+}
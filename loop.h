@@ -0,0 +1,30 @@
+/****************************************************/
+/* File: loop.h                                     */
+/* Loop optimizations on the three-address code of  */
+/* the C- compiler's native backend                 */
+/****************************************************/
+
+#ifndef _LOOP_H_
+#define _LOOP_H_
+
+#include "ir.h"
+
+/* UNROLLBODY is the largest loop body, in three
+ * address instructions, that is unrolled
+ */
+#define UNROLLBODY 24
+
+/* Procedure optimizeLoops unrolls the small counted
+ * loops of f by factor (when above 1), or by what
+ * the profile suggests for the loop, and replaces
+ * array accesses indexed by induction variables
+ * with pointers advanced along with the variable
+ */
+void optimizeLoops(IrFunc f, int factor);
+
+/* Procedure loopReport prints what was done to the
+ * loops of every function
+ */
+void loopReport(FILE * out);
+
+#endif
@@ -5,6 +5,7 @@
 /* Kenneth C. Louden                                */
 /****************************************************/
 
+#include <unistd.h>
 #include "globals.h"
 
 /* set NO_PARSE to TRUE to get a scanner-only compiler */
@@ -15,17 +16,32 @@
 /* set NO_CODE to TRUE to get a compiler that does not
  * generate code
  */
-#define NO_CODE TRUE
+#define NO_CODE FALSE
 
 #include "util.h"
 #if NO_PARSE
 #include "scan.h"
 #else
 #include "parse.h"
+#include "push.h"
+#include "plex.h"
 #if !NO_ANALYZE
 #include "analyze.h"
+#include "interp.h"
+#include "prof.h"
+#include "fold.h"
+#include "callgraph.h"
+#include "inline.h"
+#include "pgo.h"
+#include "incr.h"
+#include "astfile.h"
+#include "server.h"
+#include "rcache.h"
+#include "unit.h"
 #if !NO_CODE
+#include "bounds.h"
 #include "cgen.h"
+#include "ctrans.h"
 #endif
 #endif
 #endif
@@ -43,16 +59,219 @@ int TraceParse = FALSE;
 int TraceAnalyze = TRUE;
 int TraceCode = FALSE;
 
+/* allocate and set execution flags */
+int Execute = FALSE;
+int MemoCalls = FALSE;
+int ParallelCalls = 0;
+int ForkDepth = 12;
+int Profile = FALSE;
+int Incremental = FALSE;
+int WriteAst = FALSE;
+int Streaming = FALSE;
+int PushInput = FALSE;
+int ScanThread = FALSE;
+int LexThreads = 0;
+int HandParser = FALSE;
+int FoldCalls = FALSE;
+int InlineCalls = FALSE;
+int DumpCallGraph = 0;
+int EmitCode = FALSE;
+int EmitC = FALSE;
+int WriteUnit = FALSE;
+int LoopOpt = FALSE;
+int UnrollFactor = 4;
+int VectorISA = 0;
+int Peephole = FALSE;
+int Instrument = FALSE;
+int ProfileUse = FALSE;
+
 int Error = FALSE;
 
+#if !NO_PARSE
+/* Function parseSource parses the source, calling
+ * decl on each top-level declaration as parseDecls
+ */
+static TreeNode * parseSource(void (* decl)(TreeNode *))
+{ if (HandParser) return parseRD(decl);
+  if (LexThreads) return parallelParse(fileno(source),LexThreads,decl);
+  if (ScanThread) return pipeParse(fileno(source),decl);
+  if (PushInput) return pushParse(fileno(source),decl);
+  return parseDecls(decl);
+}
+#endif
+
+#if !NO_PARSE && !NO_ANALYZE
+/* Procedure streamDecl analyzes and writes out the
+ * top-level declaration t just parsed, keeping only
+ * what later declarations may refer to
+ */
+static void streamDecl(TreeNode * t)
+{ analyzeDecl(t);
+#if !NO_CODE
+  if (! Error && EmitC)
+  { if (t->kind == funK) checkFunBounds(t);
+    transDecl(t);
+  }
+#endif
+  if (t->kind == funK)
+  { freeTree(t->child[2]);
+    t->child[2] = NULL;
+  }
+}
+#endif
+
+/* Procedure writeUnit writes the interface summary
+ * of the unit syntaxTree from source pgm
+ */
+static void writeUnit(TreeNode * syntaxTree, char * pgm)
+{ char * cmifile;
+  char * codefile = NULL;
+  int fnlen = strrchr(pgm,'.') - pgm;
+  cmifile = (char *) calloc(fnlen+8, sizeof(char));
+  strncpy(cmifile,pgm,fnlen);
+  strcat(cmifile,".cmi");
+  if (EmitCode || EmitC)
+  { codefile = (char *) calloc(fnlen+8, sizeof(char));
+    strncpy(codefile,pgm,fnlen);
+    strcat(codefile,EmitCode ? ".s" : ".gen.c");
+  }
+  if (! unitExport(syntaxTree,pgm,cmifile,codefile))
+  { printf("Unable to write %s\n",cmifile);
+    exit(1);
+  }
+}
+
+static void usage(char * prog)
+{ fprintf(stderr,"usage: %s [-x] [-I] [-A] [-w] [-F] [-T] [-j[N]] [-r] [-m] [-p[N]] [-dN] [-P] [-f] [-i] [-gdot|-gjson] [-S] [-c] [-e] [-hF] [-C] [-R[F]] [-O] [-L] [-uN] [-vsse2|-vavx2] [-k[D]] [-MN] <filename>\n",prog);
+  fprintf(stderr,"  -x  run the program after analysis\n");
+  fprintf(stderr,"  -I  reuse unchanged functions from the directory <name>.cache\n");
+  fprintf(stderr,"  -A  write the analyzed syntax tree to <name>.ast\n");
+  fprintf(stderr,"  -w  analyze (and with -c write) each declaration as it is\n");
+  fprintf(stderr,"      parsed, then free it; no other options are allowed\n");
+  fprintf(stderr,"  -F  parse the source as it arrives, for pipes\n");
+  fprintf(stderr,"  -T  -F scanning on a thread of its own\n");
+  fprintf(stderr,"  -jN scan the source in chunks on N threads (all cores)\n");
+  fprintf(stderr,"  -r  parse by recursive descent instead of with Bison\n");
+  fprintf(stderr,"  -m  run, caching results of pure functions\n");
+  fprintf(stderr,"  -pN run, forking pure calls on N threads (all cores)\n");
+  fprintf(stderr,"  -dN fork only in the first N levels of calls (12)\n");
+  fprintf(stderr,"  -P  run, profiling functions, lines and call paths\n");
+  fprintf(stderr,"  -f  evaluate pure calls with constant arguments\n");
+  fprintf(stderr,"  -i  inline small non-recursive functions\n");
+  fprintf(stderr,"  -gdot, -gjson  print the call graph\n");
+  fprintf(stderr,"  -S  write x86-64 assembly to <name>.s\n");
+  fprintf(stderr,"  -c  write C99 to <name>.gen.c\n");
+  fprintf(stderr,"  -e  compile as a unit of a program, writing its interface\n");
+  fprintf(stderr,"      to <name>.cmi for -h and -l; alone, only the interface\n");
+  fprintf(stderr,"  -hF import the interface of another unit from F (a .cmi)\n");
+  fprintf(stderr,"  -C  -S counting blocks and branches into <name>.counts\n");
+  fprintf(stderr,"  -RF -S guided by the counts in F (<name>.counts)\n");
+  fprintf(stderr,"  -O  -S with peephole optimization\n");
+  fprintf(stderr,"  -L  -S with loop optimization, unrolling 4 times\n");
+  fprintf(stderr,"  -uN -L unrolling N times (1: no unrolling)\n");
+  fprintf(stderr,"  -vsse2, -vavx2  -S vectorizing array loops\n");
+  fprintf(stderr,"  -kD take the listing and files of the same source and options,\n");
+  fprintf(stderr,"      compiled before, from the result cache D (~/.cmcache)\n");
+  fprintf(stderr,"  -MN keep the result cache under N megabytes (%d)\n",RCACHEMAX);
+  fprintf(stderr,"   or: %s -sPATH  serve editors on the Unix socket PATH\n",prog);
+  fprintf(stderr,"   or: %s -k[D]  print the hits and misses of the result cache D\n",prog);
+  fprintf(stderr,"   or: %s -lPROG <unit>.cmi...  link units compiled with -e into PROG\n",prog);
+  exit(1);
+}
+
 main( int argc, char * argv[] )
 { TreeNode * syntaxTree;
   char pgm[120]; /* source code file name */
-  if (argc != 2)
-    { fprintf(stderr,"usage: %s <filename>\n",argv[0]);
-      exit(1);
+  char * countfile = NULL;
+  char * serverPath = NULL;
+  char * cacheDir = NULL;
+  char * linkProg = NULL;
+  char ** imports = (char **) malloc(sizeof(char *) * argc);
+  int nimports = 0;
+  int cacheMax = RCACHEMAX;
+  int argi, k;
+  for (argi = 1; argi < argc && argv[argi][0] == '-'; argi++)
+  { if (strcmp(argv[argi],"-x") == 0) Execute = TRUE;
+    else if (strcmp(argv[argi],"-I") == 0) Incremental = TRUE;
+    else if (strcmp(argv[argi],"-A") == 0) WriteAst = TRUE;
+    else if (strcmp(argv[argi],"-w") == 0) Streaming = TRUE;
+    else if (strcmp(argv[argi],"-F") == 0) PushInput = TRUE;
+    else if (strcmp(argv[argi],"-T") == 0) PushInput = ScanThread = TRUE;
+    else if (strcmp(argv[argi],"-r") == 0) HandParser = TRUE;
+    else if (strncmp(argv[argi],"-j",2) == 0)
+    { LexThreads = argv[argi][2] ? atoi(argv[argi]+2) : sysconf(_SC_NPROCESSORS_ONLN);
+      if (LexThreads < 1) usage(argv[0]);
+    }
+    else if (strncmp(argv[argi],"-s",2) == 0 && argv[argi][2]) serverPath = argv[argi]+2;
+    else if (strncmp(argv[argi],"-k",2) == 0) cacheDir = argv[argi]+2;
+    else if (strncmp(argv[argi],"-M",2) == 0 && atoi(argv[argi]+2) > 0)
+      cacheMax = atoi(argv[argi]+2);
+    else if (strcmp(argv[argi],"-m") == 0) Execute = MemoCalls = TRUE;
+    else if (strncmp(argv[argi],"-p",2) == 0)
+    { Execute = TRUE;
+      ParallelCalls = argv[argi][2] ? atoi(argv[argi]+2) : sysconf(_SC_NPROCESSORS_ONLN);
+      if (ParallelCalls < 1) usage(argv[0]);
     }
-  strcpy(pgm,argv[1]) ;
+    else if (strncmp(argv[argi],"-d",2) == 0 && atoi(argv[argi]+2) > 0)
+      ForkDepth = atoi(argv[argi]+2);
+    else if (strcmp(argv[argi],"-P") == 0) Execute = Profile = TRUE;
+    else if (strcmp(argv[argi],"-f") == 0) FoldCalls = TRUE;
+    else if (strcmp(argv[argi],"-i") == 0) InlineCalls = TRUE;
+    else if (strcmp(argv[argi],"-gdot") == 0) DumpCallGraph = 1;
+    else if (strcmp(argv[argi],"-gjson") == 0) DumpCallGraph = 2;
+    else if (strcmp(argv[argi],"-S") == 0) EmitCode = TRUE;
+    else if (strcmp(argv[argi],"-c") == 0) EmitC = TRUE;
+    else if (strcmp(argv[argi],"-e") == 0) WriteUnit = TRUE;
+    else if (strncmp(argv[argi],"-h",2) == 0 && argv[argi][2])
+      imports[nimports++] = argv[argi]+2;
+    else if (strncmp(argv[argi],"-l",2) == 0 && argv[argi][2]) linkProg = argv[argi]+2;
+    else if (strcmp(argv[argi],"-C") == 0) EmitCode = Instrument = TRUE;
+    else if (strncmp(argv[argi],"-R",2) == 0)
+    { EmitCode = ProfileUse = TRUE;
+      if (argv[argi][2]) countfile = argv[argi]+2;
+    }
+    else if (strcmp(argv[argi],"-O") == 0) EmitCode = Peephole = TRUE;
+    else if (strcmp(argv[argi],"-L") == 0) EmitCode = LoopOpt = TRUE;
+    else if (strcmp(argv[argi],"-vsse2") == 0) EmitCode = VectorISA = 1;
+    else if (strcmp(argv[argi],"-vavx2") == 0)
+    { EmitCode = TRUE;
+      VectorISA = 2;
+    }
+    else if (strncmp(argv[argi],"-u",2) == 0 && atoi(argv[argi]+2) > 0)
+    { EmitCode = LoopOpt = TRUE;
+      UnrollFactor = atoi(argv[argi]+2);
+    }
+    else usage(argv[0]);
+  }
+#if !NO_PARSE && !NO_ANALYZE
+  if (serverPath != NULL && argi == argc)
+  { serve(serverPath);
+    return 0;
+  }
+  if (cacheDir != NULL && argi == argc)
+  { rcacheReport(cacheDir,stdout);
+    return 0;
+  }
+  if (linkProg != NULL && argi < argc)
+  { listing = stdout;
+    return unitLink(linkProg,argv+argi,argc-argi) ? 0 : 1;
+  }
+#endif
+  if (argi != argc-1) usage(argv[0]);
+  /* the other options need the whole program */
+  if (Streaming && (Execute || Incremental || WriteAst || FoldCalls ||
+                    InlineCalls || DumpCallGraph || EmitCode))
+    usage(argv[0]);
+  /* the cache splices the source before it is parsed */
+  if ((PushInput || LexThreads) && Incremental) usage(argv[0]);
+  /* the hand-written parser takes its tokens from yylex */
+  if (HandParser && (PushInput || LexThreads)) usage(argv[0]);
+  /* a unit is not a whole program, and the streaming
+   * compiler cannot summarize it */
+  if ((WriteUnit || nimports) &&
+      (Execute || Incremental || Streaming || Instrument || ProfileUse))
+    usage(argv[0]);
+  strcpy(pgm,argv[argi]) ;
   if (strchr (pgm, '.') == NULL)
      strcat(pgm,".tny");
   source = fopen(pgm,"r");
@@ -62,19 +281,93 @@ main( int argc, char * argv[] )
   }
   listing = stdout; /* send listing to screen */
   lineno = 1;
+#if !NO_PARSE && !NO_ANALYZE
+  if (cacheDir != NULL && rcacheOpen(cacheDir,cacheMax,pgm,argv+1,argi-1))
+  { fclose(source);
+    return 0;
+  }
+#endif
 
 #if NO_PARSE
   fprintf(listing, "    line number           token             lexeme\n");
   fprintf(listing, "--------------------------------------------------\n");
   while (getToken()!=ENDFILE);
 #else
+#if !NO_ANALYZE
+  if (Incremental)
+  { char * cachedir;
+    int fnlen = strrchr(pgm,'.') - pgm;
+    cachedir = (char *) calloc(fnlen+8, sizeof(char));
+    strncpy(cachedir,pgm,fnlen);
+    strcat(cachedir,".cache");
+    source = incrOpen(source,cachedir);
+  }
+  for (k = 0; k < nimports; k++)
+    if (! unitImport(imports[k]))
+    { printf("Unable to import %s\n",imports[k]);
+      exit(1);
+    }
+#endif
   initParser();
-  syntaxTree = parse();
+#if !NO_ANALYZE
+  if (Streaming)
+  { char * cfile = NULL;
+#if !NO_CODE
+    if (EmitC)
+    { int fnlen = strrchr(pgm,'.') - pgm;
+      cfile = (char *) calloc(fnlen+8, sizeof(char));
+      strncpy(cfile,pgm,fnlen);
+      strcat(cfile,".gen.c");
+      code = fopen(cfile,"w");
+      if (code == NULL)
+      { printf("Unable to open %s\n",cfile);
+        exit(1);
+      }
+      transBegin(pgm,cfile);
+    }
+#endif
+    if (TraceAnalyze) fprintf(listing,"\nBuilding Symbol Table & Checking Types...\n\n");
+    beginSymtab();
+    syntaxTree = parseSource(streamDecl);
+    endSymtab();
+    if (TraceAnalyze) fprintf(listing,"\nType Checking Finished\n");
+#if !NO_CODE
+    if (EmitC)
+    { if (! Error) transEnd(cfile);
+      fclose(code);
+      if (Error) remove(cfile);
+    }
+#endif
+    if (cacheDir != NULL) rcacheStore();
+    fclose(source);
+    return 0;
+  }
+#endif
+  syntaxTree = parseSource(NULL);
+#if !NO_ANALYZE
+  if (Incremental && ! Error && (syntaxTree = incrSplice(syntaxTree)) == NULL)
+  { /* the cache does not line up with the source */
+    Incremental = FALSE;
+    source = incrSource();
+    lineno = 1;
+    initParser();
+    syntaxTree = parseSource(NULL);
+  }
+#endif
   if (TraceParse) {
     fprintf(listing,"\nSyntax tree:\n");
     printTree(syntaxTree);
   }
 #if !NO_ANALYZE
+  /* with nothing else to write, -e writes only the
+   * interface, which the declarations give as parsed;
+   * so units that refer to each other get theirs */
+  if (WriteUnit && !(EmitCode || EmitC || WriteAst || DumpCallGraph))
+  { if (! Error) writeUnit(syntaxTree,pgm);
+    if (cacheDir != NULL) rcacheStore();
+    fclose(source);
+    return 0;
+  }
   if (! Error)
   { /*if (TraceAnalyze) fprintf(listing,"\nBuilding Symbol Table...\n");
     buildSymtab(syntaxTree);
@@ -82,15 +375,83 @@ main( int argc, char * argv[] )
     //typeCheck(syntaxTree);
 		if(TraceAnalyze) fprintf(listing,"\nBuilding Symbol Table & Checking Types...\n\n");
 		buildSymtab(syntaxTree);
+    if (Incremental)
+    { incrSave();
+      incrReport(listing);
+    }
     if (TraceAnalyze) fprintf(listing,"\nType Checking Finished\n");
   }
-#if !NO_CODE
+  if (! Error && WriteAst)
+  { char * astfile;
+    AstFile * f;
+    int fnlen = strrchr(pgm,'.') - pgm;
+    astfile = (char *) calloc(fnlen+8, sizeof(char));
+    strncpy(astfile,pgm,fnlen);
+    strcat(astfile,".ast");
+    if (! writeAst(syntaxTree,astfile))
+    { printf("Unable to write %s\n",astfile);
+      exit(1);
+    }
+    /* the file mapped back must give the tree written */
+    f = mapAst(astfile);
+    if (f == NULL || checkAst(f,syntaxTree) != AST_NONE)
+    { printf("%s does not read back as the tree written\n",astfile);
+      exit(1);
+    }
+    unmapAst(f);
+  }
+  if (! Error && ProfileUse)
+  { if (countfile == NULL)
+    { int fnlen = strrchr(pgm,'.') - pgm;
+      countfile = (char *) calloc(fnlen+8, sizeof(char));
+      strncpy(countfile,pgm,fnlen);
+      strcat(countfile,".counts");
+    }
+    if (! pgoLoad(countfile))
+    { printf("Unable to open %s\n",countfile);
+      exit(1);
+    }
+  }
   if (! Error)
+  { buildCallGraph(syntaxTree);
+    if (DumpCallGraph == 1) cg_dumpDot(listing);
+    else if (DumpCallGraph == 2) cg_dumpJson(listing);
+    if (InlineCalls)
+    { inlineCalls();
+      buildCallGraph(syntaxTree);
+    }
+    syntaxTree = pruneUnreachable(syntaxTree);
+  }
+  if (! Error && (MemoCalls || FoldCalls || ParallelCalls))
+    findPure(syntaxTree);
+  if (! Error && FoldCalls)
+    foldCalls(syntaxTree);
+  if (! Error && Execute)
+  { execute(syntaxTree);
+    if (Profile)
+    { char * foldfile;
+      FILE * folded;
+      int fnlen = strrchr(pgm,'.') - pgm;
+      foldfile = (char *) calloc(fnlen+8, sizeof(char));
+      strncpy(foldfile,pgm,fnlen);
+      strcat(foldfile,".folded");
+      folded = fopen(foldfile,"w");
+      if (folded == NULL)
+      { printf("Unable to open %s\n",foldfile);
+        exit(1);
+      }
+      prof_folded(folded);
+      fclose(folded);
+    }
+  }
+#if !NO_CODE
+  if (! Error && (EmitCode || EmitC)) checkBounds(syntaxTree);
+  if (! Error && EmitCode)
   { char * codefile;
-    int fnlen = strcspn(pgm,".");
+    int fnlen = strrchr(pgm,'.') - pgm;
     codefile = (char *) calloc(fnlen+4, sizeof(char));
     strncpy(codefile,pgm,fnlen);
-    strcat(codefile,".tm");
+    strcat(codefile,".s");
     code = fopen(codefile,"w");
     if (code == NULL)
     { printf("Unable to open %s\n",codefile);
@@ -99,7 +460,23 @@ main( int argc, char * argv[] )
     codeGen(syntaxTree,codefile);
     fclose(code);
   }
+  if (! Error && EmitC)
+  { char * cfile;
+    int fnlen = strrchr(pgm,'.') - pgm;
+    cfile = (char *) calloc(fnlen+8, sizeof(char));
+    strncpy(cfile,pgm,fnlen);
+    strcat(cfile,".gen.c");
+    code = fopen(cfile,"w");
+    if (code == NULL)
+    { printf("Unable to open %s\n",cfile);
+      exit(1);
+    }
+    transpile(syntaxTree,pgm,cfile);
+    fclose(code);
+  }
 #endif
+  if (! Error && WriteUnit) writeUnit(syntaxTree,pgm);
+  if (cacheDir != NULL) rcacheStore();
 #endif
 #endif
   fclose(source);
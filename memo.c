@@ -0,0 +1,89 @@
+/****************************************************/
+/* File: memo.c                                     */
+/* Call result cache implementation for the C-      */
+/* compiler; open addressing with bounded probing   */
+/****************************************************/
+
+#include "globals.h"
+#include "memo.h"
+
+/* the list of tables, one per memoized function */
+static MemoTable tables = NULL;
+
+/* the hash function over an argument vector */
+static unsigned memo_hash(int * args, int n)
+{ unsigned h = 2166136261u;
+  int i;
+  for (i = 0; i < n; i++)
+    h = (h ^ (unsigned) args[i]) * 16777619u;
+  return h % MEMOSIZE;
+}
+
+MemoTable memo_table(TreeNode * fun)
+{ MemoTable m = tables;
+  while (m != NULL && m->fun != fun) m = m->next;
+  if (m == NULL) {
+    m = (MemoTable) malloc(sizeof(struct MemoTableRec));
+    m->fun = fun;
+    m->nargs = paramNum(fun) > 0 ? paramNum(fun) : 0;
+    m->keys = (int *) malloc(sizeof(int) * MEMOSIZE * (m->nargs + 1));
+    m->values = (int *) malloc(sizeof(int) * MEMOSIZE);
+    m->heights = (int *) malloc(sizeof(int) * MEMOSIZE);
+    m->used = (char *) calloc(MEMOSIZE, sizeof(char));
+    if (m->keys == NULL || m->values == NULL || m->heights == NULL || m->used == NULL) {
+      fprintf(listing,"Out of memory error in call cache\n");
+      exit(1);
+    }
+    m->hits = m->misses = m->evictions = 0;
+    m->next = tables;
+    tables = m;
+  }
+  return m;
+}
+
+int memo_lookup(MemoTable m, int * args, int * result, int * height)
+{ unsigned h = memo_hash(args, m->nargs);
+  int i;
+  for (i = 0; i < MEMOPROBE; i++) {
+    unsigned k = (h + i) % MEMOSIZE;
+    if (!m->used[k]) break;
+    if (memcmp(m->keys + k * m->nargs, args, sizeof(int) * m->nargs) == 0) {
+      *result = m->values[k];
+      *height = m->heights[k];
+      m->hits++;
+      return TRUE;
+    }
+  }
+  m->misses++;
+  return FALSE;
+}
+
+void memo_insert(MemoTable m, int * args, int result, int height)
+{ unsigned h = memo_hash(args, m->nargs);
+  unsigned k = h;
+  int i;
+  for (i = 0; i < MEMOPROBE; i++) {
+    k = (h + i) % MEMOSIZE;
+    if (!m->used[k]) break;
+  }
+  if (i == MEMOPROBE) { /* all slots taken: replace the home slot */
+    k = h;
+    m->evictions++;
+  }
+  memcpy(m->keys + k * m->nargs, args, sizeof(int) * m->nargs);
+  m->values[k] = result;
+  m->heights[k] = height;
+  m->used[k] = TRUE;
+}
+
+void memo_report(FILE * listing)
+{ MemoTable m;
+  fprintf(listing,"\nCall cache      Hits     Misses   Evictions Hit rate\n");
+  fprintf(listing,"--------------  -------- -------- --------- --------\n");
+  for (m = tables; m != NULL; m = m->next) {
+    long calls = m->hits + m->misses;
+    fprintf(listing,"%-14s  %-8ld %-8ld %-9ld %6.2f%%\n",
+            m->fun->attr.name, m->hits, m->misses, m->evictions,
+            calls ? 100.0 * m->hits / calls : 0.0);
+  }
+}
@@ -0,0 +1,54 @@
+/****************************************************/
+/* File: memo.h                                     */
+/* Call result cache interface for the C- compiler  */
+/* (one bounded table per pure function)            */
+/****************************************************/
+
+#ifndef _MEMO_H_
+#define _MEMO_H_
+
+/* MEMOSIZE is the number of entries of each table;
+ * it bounds the memory used per function
+ */
+#define MEMOSIZE 4096
+
+/* MEMOPROBE is the number of slots searched before
+ * an old entry is overwritten
+ */
+#define MEMOPROBE 4
+
+typedef struct MemoTableRec
+{ TreeNode * fun;
+  int nargs;
+  int * keys;   /* MEMOSIZE rows of nargs arguments */
+  int * values;
+  int * heights; /* depth of the calls each result nested */
+  char * used;
+  long hits, misses, evictions;
+  struct MemoTableRec * next;
+} * MemoTable;
+
+/* Function memo_table returns the table of function
+ * fun, creating an empty one on first use
+ */
+MemoTable memo_table(TreeNode * fun);
+
+/* Function memo_lookup returns TRUE and stores the
+ * cached result in *result if args has been seen,
+ * and in *height the depth of the calls computing it
+ * nested, the call itself counting 1
+ */
+int memo_lookup(MemoTable m, int * args, int * result, int * height);
+
+/* Procedure memo_insert records the result of a
+ * call and its height, evicting an older entry if
+ * the slots are full
+ */
+void memo_insert(MemoTable m, int * args, int result, int height);
+
+/* Procedure memo_report prints the hit rate of
+ * every table to the listing file
+ */
+void memo_report(FILE * listing);
+
+#endif
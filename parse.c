@@ -1,215 +1,439 @@
 /****************************************************/
 /* File: parse.c                                    */
-/* The parser implementation for the TINY compiler  */
+/* Hand-written parser for the C- compiler: the     */
+/* grammar of cminus.y by recursive descent, with   */
+/* the binary operators by precedence climbing. It  */
+/* builds the same trees as the Bison parser, down  */
+/* to line numbers: a node is made when Bison would */
+/* reduce it, the next token being read first only  */
+/* where Bison needs it to decide                   */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
 
+#include <setjmp.h>
 #include "globals.h"
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
 
-static TokenType token; /* holds current token */
+int yylex(void);
+
+/* NOTOKEN: the next token has not been read yet */
+#define NOTOKEN (-1)
+
+static TokenType token = NOTOKEN; /* holds current token */
+static char tokenText[STRINGSIZE]; /* its lexeme, for ID and NUM */
+
+/* the parse is abandoned at the first error, as the
+ * Bison parser does
+ */
+static jmp_buf abandon;
 
 /* function prototypes for recursive calls */
-static TreeNode * stmt_sequence(void);
+static TreeNode * declaration(void);
+static TreeNode * params(void);
+static TreeNode * compound_stmt(void);
 static TreeNode * statement(void);
-static TreeNode * if_stmt(void);
-static TreeNode * repeat_stmt(void);
-static TreeNode * assign_stmt(void);
-static TreeNode * read_stmt(void);
-static TreeNode * write_stmt(void);
-static TreeNode * exp(void);
-static TreeNode * simple_exp(void);
-static TreeNode * term(void);
+static TreeNode * expression(void);
+static TreeNode * simple_expr(TreeNode * first);
+static TreeNode * binary(TreeNode * first, int minPrec);
 static TreeNode * factor(void);
+static TreeNode * var_or_call(void);
 
-static void syntaxError(char * message)
-{ fprintf(listing,"\n>>> ");
-  fprintf(listing,"Syntax error at line %d: %s",lineno,message);
+static void syntaxError(void)
+{ fprintf(listing,"Syntax error at line %d: %s\n",lineno,"syntax error");
+  fprintf(listing,"Current token: ");
+  printToken(token,tokenString);
   Error = TRUE;
+  longjmp(abandon,1);
+}
+
+/* Function peek reads the next token if it has not
+ * been read, and returns it
+ */
+static TokenType peek(void)
+{ if (token == NOTOKEN) {
+    token = yylex();
+    /* the scanner pushes the lexeme of an ID or NUM */
+    if (token == ID || token == NUM) strcpy(tokenText,st_pop());
+  }
+  return token;
 }
 
-static void match(TokenType expected)
-{ if (token == expected) token = getToken();
+/* Procedure match takes the next token, which must
+ * be expected, copying its lexeme to text if that
+ * is not NULL
+ */
+static void match(TokenType expected, char * text)
+{ if (peek() != expected) syntaxError();
+  if (text != NULL) strcpy(text,tokenText);
+  token = NOTOKEN;
+}
+
+static TreeNode * typeNode(ExpType type)
+{ TreeNode * t = newExpNode(TypeK);
+  t->type = type;
+  return t;
+}
+
+/* Function type_spec takes int or void */
+static TreeNode * type_spec(void)
+{ if (peek() == INT) {
+    match(INT,NULL);
+    return typeNode(Integer);
+  }
+  match(VOID,NULL);
+  return typeNode(Void);
+}
+
+/* Function var_rest finishes a variable declaration
+ * after its type and name
+ */
+static TreeNode * var_rest(TreeNode * type, char * name)
+{ TreeNode * t;
+  char size[STRINGSIZE];
+  if (peek() == BOPEN) {
+    match(BOPEN,NULL);
+    match(NUM,size);
+    match(BCLOSE,NULL);
+    match(SEMI,NULL);
+    t = newDeclNode(varK);
+    declInfo(t)->array_size = atoi(size);
+  }
   else {
-    syntaxError("unexpected token -> ");
-    printToken(token,tokenString);
-    fprintf(listing,"      ");
-  }
-}
-
-TreeNode * stmt_sequence(void)
-{ TreeNode * t = statement();
-  TreeNode * p = t;
-  while ((token!=ENDFILE) && (token!=END) &&
-         (token!=ELSE) && (token!=UNTIL))
-  { TreeNode * q;
-    match(SEMI);
-    q = statement();
-    if (q!=NULL) {
-      if (t==NULL) t = p = q;
-      else /* now p cannot be NULL either */
-      { p->sibling = q;
-        p = q;
-      }
-    }
+    match(SEMI,NULL);
+    t = newDeclNode(varK);
+    declInfo(t)->array_size = 0;
   }
+  t->child[0] = type;
+  t->attr.name = copyString(name);
   return t;
 }
 
-TreeNode * statement(void)
-{ TreeNode * t = NULL;
-  switch (token) {
-    case IF : t = if_stmt(); break;
-    case REPEAT : t = repeat_stmt(); break;
-    case ID : t = assign_stmt(); break;
-    case READ : t = read_stmt(); break;
-    case WRITE : t = write_stmt(); break;
-    default : syntaxError("unexpected token -> ");
-              printToken(token,tokenString);
-              token = getToken();
-              break;
-  } /* end case */
+TreeNode * declaration(void)
+{ TreeNode * type = type_spec();
+  TreeNode * t;
+  TreeNode * p;
+  TreeNode * body;
+  char name[STRINGSIZE];
+  int line;
+  match(ID,name);
+  if (peek() != SOPEN) return var_rest(type,name);
+  line = lineno;
+  match(SOPEN,NULL);
+  p = params();
+  match(SCLOSE,NULL);
+  body = compound_stmt();
+  t = newDeclNode(funK);
+  t->child[0] = type;
+  t->child[1] = p;
+  t->child[2] = body;
+  t->attr.name = copyString(name);
+  t->lineno = line;
   return t;
 }
 
-TreeNode * if_stmt(void)
-{ TreeNode * t = newStmtNode(IfK);
-  match(IF);
-  if (t!=NULL) t->child[0] = exp();
-  match(THEN);
-  if (t!=NULL) t->child[1] = stmt_sequence();
-  if (token==ELSE) {
-    match(ELSE);
-    if (t!=NULL) t->child[2] = stmt_sequence();
+/* Function param takes a parameter whose type has
+ * been read
+ */
+static TreeNode * param(TreeNode * type)
+{ TreeNode * t;
+  char name[STRINGSIZE];
+  match(ID,name);
+  if (peek() == BOPEN) {
+    match(BOPEN,NULL);
+    match(BCLOSE,NULL);
+    t = newDeclNode(paramK);
+    declInfo(t)->array_size = 1;
   }
-  match(END);
+  else {
+    t = newDeclNode(paramK);
+    declInfo(t)->array_size = 0;
+  }
+  t->child[0] = type;
+  t->attr.name = copyString(name);
   return t;
 }
 
-TreeNode * repeat_stmt(void)
-{ TreeNode * t = newStmtNode(RepeatK);
-  match(REPEAT);
-  if (t!=NULL) t->child[0] = stmt_sequence();
-  match(UNTIL);
-  if (t!=NULL) t->child[1] = exp();
+TreeNode * params(void)
+{ TreeNode * t;
+  TreeNode * p;
+  if (peek() == VOID) {
+    match(VOID,NULL);
+    if (peek() == SCLOSE) {
+      t = newDeclNode(paramK);
+      declInfo(t)->array_size = -1;
+      t->type = Void;
+      declInfo(t)->paramnum = 0;
+      return t;
+    }
+    t = p = param(typeNode(Void));
+  }
+  else {
+    match(INT,NULL);
+    t = p = param(typeNode(Integer));
+  }
+  while (peek() == COMMA) {
+    match(COMMA,NULL);
+    p = p->sibling = param(type_spec());
+  }
   return t;
 }
 
-TreeNode * assign_stmt(void)
-{ TreeNode * t = newStmtNode(AssignK);
-  if ((t!=NULL) && (token==ID))
-    t->attr.name = copyString(tokenString);
-  match(ID);
-  match(ASSIGN);
-  if (t!=NULL) t->child[0] = exp();
+TreeNode * compound_stmt(void)
+{ TreeNode * t;
+  TreeNode * decls = NULL;
+  TreeNode * stmts = NULL;
+  TreeNode * last = NULL;
+  TreeNode * s;
+  char name[STRINGSIZE];
+  match(MOPEN,NULL);
+  while (peek() == INT || peek() == VOID) {
+    TreeNode * type = type_spec();
+    match(ID,name);
+    s = var_rest(type,name);
+    if (decls == NULL) decls = s;
+    else last->sibling = s;
+    last = s;
+  }
+  last = NULL;
+  while (peek() != MCLOSE) {
+    s = statement();
+    if (s == NULL) continue;
+    if (stmts == NULL) stmts = s;
+    else last->sibling = s;
+    last = s;
+  }
+  match(MCLOSE,NULL);
+  t = newStmtNode(CompoundK);
+  t->child[0] = decls;
+  t->child[1] = stmts;
   return t;
 }
 
-TreeNode * read_stmt(void)
-{ TreeNode * t = newStmtNode(ReadK);
-  match(READ);
-  if ((t!=NULL) && (token==ID))
-    t->attr.name = copyString(tokenString);
-  match(ID);
+TreeNode * statement(void)
+{ TreeNode * t;
+  TreeNode * e;
+  TreeNode * s;
+  switch (peek()) {
+    case SEMI:
+      match(SEMI,NULL);
+      return NULL;
+    case MOPEN:
+      return compound_stmt();
+    case IF:
+      match(IF,NULL);
+      match(SOPEN,NULL);
+      e = expression();
+      match(SCLOSE,NULL);
+      s = statement();
+      if (peek() == ELSE) {
+        TreeNode * s2;
+        match(ELSE,NULL);
+        s2 = statement();
+        t = newStmtNode(IfK);
+        t->child[2] = s2;
+      }
+      else t = newStmtNode(IfK);
+      t->child[0] = e;
+      t->child[1] = s;
+      return t;
+    case WHILE:
+      match(WHILE,NULL);
+      match(SOPEN,NULL);
+      e = expression();
+      match(SCLOSE,NULL);
+      s = statement();
+      t = newStmtNode(WhileK);
+      t->child[0] = e;
+      t->child[1] = s;
+      return t;
+    case RETURN:
+      match(RETURN,NULL);
+      if (peek() == SEMI) {
+        match(SEMI,NULL);
+        t = newStmtNode(ReturnK);
+        t->type = Void;
+        return t;
+      }
+      e = expression();
+      match(SEMI,NULL);
+      t = newStmtNode(ReturnK);
+      t->child[0] = e;
+      return t;
+    case ID: case NUM: case SOPEN:
+      e = expression();
+      match(SEMI,NULL);
+      return e;
+    default:
+      syntaxError();
+      return NULL;
+  }
+}
+
+TreeNode * expression(void)
+{ TreeNode * t;
+  TreeNode * v;
+  if (peek() != ID) return simple_expr(NULL);
+  v = var_or_call();
+  if (v->nodekind == ExpK && peek() == ASSIGN) {
+    TreeNode * e;
+    match(ASSIGN,NULL);
+    e = expression();
+    t = newStmtNode(AssignK);
+    t->child[0] = v;
+    t->child[1] = e;
+    return t;
+  }
+  return simple_expr(v);
+}
+
+static int isRelop(TokenType op)
+{ return op == LEQ || op == LES || op == BIG || op == BEQ ||
+         op == EQ || op == NEQ;
+}
+
+static TreeNode * opNode(TokenType op)
+{ TreeNode * t;
+  match(op,NULL);
+  t = newExpNode(OpK);
+  t->attr.op = op;
   return t;
 }
 
-TreeNode * write_stmt(void)
-{ TreeNode * t = newStmtNode(WriteK);
-  match(WRITE);
-  if (t!=NULL) t->child[0] = exp();
+static TreeNode * calcNode(TreeNode * left, TreeNode * op, TreeNode * right)
+{ TreeNode * t = newExpNode(CalcK);
+  t->child[0] = left;
+  t->child[1] = op;
+  t->child[2] = right;
   return t;
 }
 
-TreeNode * exp(void)
-{ TreeNode * t = simple_exp();
-  if ((token==LT)||(token==EQ)) {
-    TreeNode * p = newExpNode(OpK);
-    if (p!=NULL) {
-      p->child[0] = t;
-      p->attr.op = token;
-      t = p;
-    }
-    match(token);
-    if (t!=NULL)
-      t->child[1] = simple_exp();
+/* Function simple_expr parses a comparison of sums,
+ * first being its first factor if already parsed
+ */
+TreeNode * simple_expr(TreeNode * first)
+{ TreeNode * t = binary(first,1);
+  if (isRelop(peek())) {
+    TreeNode * op = opNode(token);
+    TreeNode * right = binary(NULL,1);
+    t = calcNode(t,op,right);
   }
   return t;
 }
 
-TreeNode * simple_exp(void)
-{ TreeNode * t = term();
-  while ((token==PLUS)||(token==MINUS))
-  { TreeNode * p = newExpNode(OpK);
-    if (p!=NULL) {
-      p->child[0] = t;
-      p->attr.op = token;
-      t = p;
-      match(token);
-      t->child[1] = term();
-    }
+/* the precedence of + - (1) and * / (2), or 0 */
+#define MAXPREC 2
+
+static int precedence(TokenType op)
+{ switch (op) {
+    case PLUS: case MINUS: return 1;
+    case MUL: case DIV: return 2;
+    default: return 0;
   }
-  return t;
 }
 
-TreeNode * term(void)
-{ TreeNode * t = factor();
-  while ((token==TIMES)||(token==OVER))
-  { TreeNode * p = newExpNode(OpK);
-    if (p!=NULL) {
-      p->child[0] = t;
-      p->attr.op = token;
-      t = p;
-      match(token);
-      p->child[1] = factor();
-    }
+/* Function binary parses operands joined by
+ * operators of precedence minPrec or more, left
+ * to right. An operand of the highest precedence is
+ * a factor and is returned without looking further,
+ * as Bison reduces a term without a lookahead
+ */
+TreeNode * binary(TreeNode * first, int minPrec)
+{ TreeNode * t = first != NULL ? first : factor();
+  int prec;
+  if (minPrec > MAXPREC) return t;
+  while ((prec = precedence(peek())) >= minPrec) {
+    TreeNode * op = opNode(token);
+    TreeNode * right = binary(NULL,prec + 1);
+    t = calcNode(t,op,right);
   }
   return t;
 }
 
 TreeNode * factor(void)
-{ TreeNode * t = NULL;
-  switch (token) {
-    case NUM :
+{ TreeNode * t;
+  char text[STRINGSIZE];
+  switch (peek()) {
+    case SOPEN:
+      match(SOPEN,NULL);
+      t = expression();
+      match(SCLOSE,NULL);
+      return t;
+    case NUM:
+      match(NUM,text);
       t = newExpNode(ConstK);
-      if ((t!=NULL) && (token==NUM))
-        t->attr.val = atoi(tokenString);
-      match(NUM);
+      t->type = Integer;
+      t->attr.val = atoi(text);
+      return t;
+    case ID:
+      return var_or_call();
+    default:
+      syntaxError();
+      return NULL;
+  }
+}
+
+/* Function var_or_call parses a variable, perhaps
+ * subscripted, or a call
+ */
+TreeNode * var_or_call(void)
+{ TreeNode * t;
+  TreeNode * e;
+  char name[STRINGSIZE];
+  match(ID,name);
+  switch (peek()) {
+    case SOPEN:
+      match(SOPEN,NULL);
+      e = NULL;
+      if (peek() != SCLOSE) {
+        TreeNode * last;
+        e = last = expression();
+        while (peek() == COMMA) {
+          match(COMMA,NULL);
+          last = last->sibling = expression();
+        }
+      }
+      match(SCLOSE,NULL);
+      t = newStmtNode(CallK);
+      t->child[0] = e;
       break;
-    case ID :
+    case BOPEN:
+      match(BOPEN,NULL);
+      e = expression();
+      match(BCLOSE,NULL);
       t = newExpNode(IdK);
-      if ((t!=NULL) && (token==ID))
-        t->attr.name = copyString(tokenString);
-      match(ID);
-      break;
-    case LPAREN :
-      match(LPAREN);
-      t = exp();
-      match(RPAREN);
+      t->child[0] = e;
+      t->subscript = 1;
+      t->type = Integer;
       break;
     default:
-      syntaxError("unexpected token -> ");
-      printToken(token,tokenString);
-      token = getToken();
+      t = newExpNode(IdK);
+      t->subscript = 0;
+      t->type = Integer;
       break;
-    }
+  }
+  t->attr.name = copyString(name);
   return t;
 }
 
 /****************************************/
 /* the primary function of the parser   */
 /****************************************/
-/* Function parse returns the newly 
- * constructed syntax tree
- */
-TreeNode * parse(void)
-{ TreeNode * t;
-  token = getToken();
-  t = stmt_sequence();
-  if (token!=ENDFILE)
-    syntaxError("Code ends before file\n");
+TreeNode * parseRD(void (* decl)(TreeNode *))
+{ TreeNode * t = NULL;
+  TreeNode * last = NULL;
+  TreeNode * d;
+  token = NOTOKEN;
+  st_clear();
+  if (setjmp(abandon) != 0) return NULL;
+  do {
+    d = declaration();
+    if (t == NULL) t = d;
+    else last->sibling = d;
+    last = d;
+    if (decl != NULL) decl(d);
+  } while (peek() != 0);  /* 0 is the end of input */
   return t;
 }
@@ -13,4 +13,30 @@
  */
 TreeNode * parse(void);
 
+/* Function parseDecls is parse, calling decl on each
+ * top-level declaration as soon as it is reduced,
+ * before the rest of the program is read
+ */
+TreeNode * parseDecls(void (* decl)(TreeNode *));
+
+/* The parser can also be handed the tokens one at a
+ * time by a caller that has them: parseBegin starts
+ * a program, calling decl as parseDecls does (decl
+ * may be NULL); parseToken takes the next token,
+ * whose lexeme an ID or NUM has pushed with st_push,
+ * and returns FALSE once the parse is over because
+ * of a syntax error; parseEnd ends the input and
+ * returns the syntax tree
+ */
+void parseBegin(void (* decl)(TreeNode *));
+int parseToken(TokenType token);
+TreeNode * parseEnd(void);
+
+/* Function parseRD is parseDecls done by the hand-
+ * written recursive-descent parser of parse.c, which
+ * builds the same tree and reports the same syntax
+ * error
+ */
+TreeNode * parseRD(void (* decl)(TreeNode *));
+
 #endif
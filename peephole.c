@@ -0,0 +1,322 @@
+/****************************************************/
+/* File: peephole.c                                 */
+/* Peephole optimizer implementation for the C-     */
+/* compiler. A table of rules is tried at every     */
+/* line of the buffered function; a rule looks at a */
+/* window of the following lines and, on a match,   */
+/* writes their replacement. Passes repeat until no */
+/* rule applies.                                    */
+/****************************************************/
+
+#include "globals.h"
+#include "code.h"
+#include "peephole.h"
+
+/* MAXPASSES bounds the passes over one function, so
+ * that a cycle of jumps cannot be followed forever
+ */
+#define MAXPASSES 8
+
+/* MAXHOPS bounds the jumps followed in one chain */
+#define MAXHOPS 8
+
+/* the lines of the pass; the output goes back to
+ * the buffer of code.c
+ */
+static AsmLine * in = NULL;
+static int nin = 0;
+static int maxin = 0;
+
+/* comments are kept but do not break a window */
+static int isNote(int k)
+{ return in[k].kind == A_TEXT && in[k].src[0] == '#'; }
+
+/* Function next returns the index of the first line
+ * after k that is not a comment, nin if none
+ */
+static int next(int k)
+{ k++;
+  while (k < nin && isNote(k)) k++;
+  return k;
+}
+
+static int isOp(int k, char * op)
+{ return k < nin && in[k].kind == A_INSTR && strcmp(in[k].op,op) == 0; }
+
+static int isMov(int k)
+{ return isOp(k,"movl") || isOp(k,"movq"); }
+
+static int isJump(int k)
+{ return k < nin && in[k].kind == A_INSTR && in[k].op[0] == 'j'; }
+
+static int isLabel(int k)
+{ return k < nin && in[k].kind == A_LABEL; }
+
+static int isRegArg(char * s)
+{ return s[0] == '%'; }
+
+static int isMemArg(char * s)
+{ return s[0] != '\0' && s[0] != '%' && s[0] != '$'; }
+
+/* Function log2Imm returns n if s is the immediate
+ * 2 to the n, and -1 otherwise
+ */
+static int log2Imm(char * s)
+{ int v, n = 0;
+  if (s[0] != '$') return -1;
+  v = atoi(s+1);
+  if (v <= 0 || (v & (v - 1)) != 0) return -1;
+  while (v > 1) { v >>= 1; n++; }
+  return n;
+}
+
+/* Function labelFollows is TRUE if label name is
+ * among the labels directly after line k
+ */
+static int labelFollows(int k, char * name)
+{ for (k = next(k); isLabel(k); k = next(k))
+    if (strcmp(in[k].src,name) == 0) return TRUE;
+  return FALSE;
+}
+
+/* Function chainEnd follows jumps from label name
+ * and returns the label finally reached, or NULL
+ * if the first one is not a jump
+ */
+static char * chainEnd(char * name)
+{ char * end = NULL;
+  int hops, k;
+  for (hops = 0; hops < MAXHOPS; hops++) {
+    for (k = 0; k < nin; k++)
+      if (in[k].kind == A_LABEL && strcmp(in[k].src,name) == 0) break;
+    if (k == nin) break;
+    while (isLabel(k)) k = next(k);
+    if (!isOp(k,"jmp") || strcmp(in[k].src,name) == 0) break;
+    end = name = in[k].src;
+  }
+  return end;
+}
+
+static int referenced(char * name)
+{ int k;
+  for (k = 0; k < nin; k++)
+    if (in[k].kind == A_INSTR && strcmp(in[k].src,name) == 0) return TRUE;
+  return FALSE;
+}
+
+/* the condition testing the opposite relation */
+static struct { char * jcc, * inv; } invTable[] =
+{ { "je", "jne" }, { "jne", "je" }, { "jl", "jge" }, { "jge", "jl" },
+  { "jle", "jg" }, { "jg", "jle" }, { NULL, NULL } };
+
+static char * invert(char * jcc)
+{ int i;
+  for (i = 0; invTable[i].jcc != NULL; i++)
+    if (strcmp(invTable[i].jcc,jcc) == 0) return invTable[i].inv;
+  return NULL;
+}
+
+/* The rules. Each is tried at line k and returns 0
+ * if it does not match; otherwise it emits the
+ * replacement and returns the index of the first
+ * line not consumed. Comments inside a matched
+ * window are dropped.
+ */
+
+/* mov a, b; mov b, a: the second move is redundant */
+static int storeReload(int k)
+{ int j = next(k);
+  if (!isMov(k) || !isOp(j,in[k].op)) return 0;
+  if (strcmp(in[j].src,in[k].dst) || strcmp(in[j].dst,in[k].src)) return 0;
+  emitAsmLine(&in[k]);
+  return j + 1;
+}
+
+/* mov r, m; mov m, s: take the value from r */
+static int loadForward(int k)
+{ int j = next(k);
+  if (!isMov(k) || !isOp(j,in[k].op)) return 0;
+  if (!isRegArg(in[k].src) || !isMemArg(in[k].dst)) return 0;
+  if (strcmp(in[j].src,in[k].dst) || !isRegArg(in[j].dst)) return 0;
+  emitAsmLine(&in[k]);
+  emitAsm(in[k].op,in[k].src,in[j].dst);
+  return j + 1;
+}
+
+/* pushq x; popq y: a move through the stack */
+static int pushPop(int k)
+{ int j = next(k);
+  if (!isOp(k,"pushq") || !isOp(j,"popq")) return 0;
+  if (isMemArg(in[k].src) && isMemArg(in[j].src)) return 0;
+  if (strcmp(in[k].src,in[j].src) != 0)
+    emitAsm("movq",in[k].src,in[j].src);
+  return j + 1;
+}
+
+static int selfMove(int k)
+{ if (!isOp(k,"movq") || strcmp(in[k].src,in[k].dst) != 0) return 0;
+  return k + 1;
+}
+
+/* imull $2^n, r becomes a shift */
+static int mulPow2(int k)
+{ int n;
+  char buf[ASMARGLEN];
+  if (!isOp(k,"imull") || !isRegArg(in[k].dst)) return 0;
+  if ((n = log2Imm(in[k].src)) < 0) return 0;
+  if (n > 0) {
+    sprintf(buf,"$%d",n);
+    emitAsm("sall",buf,in[k].dst);
+  }
+  return k + 1;
+}
+
+/* cltd; movl $2^n, %r11d; idivl %r11d becomes an
+ * arithmetic shift, biased by 2^n-1 for negative
+ * dividends so that the quotient rounds to zero
+ */
+static int divPow2(int k)
+{ int j = next(k), m = next(j), n;
+  char buf[ASMARGLEN];
+  if (!isOp(k,"cltd") || !isOp(j,"movl") || !isOp(m,"idivl")) return 0;
+  if (strcmp(in[j].dst,"%r11d") || strcmp(in[m].src,"%r11d")) return 0;
+  if ((n = log2Imm(in[j].src)) < 0) return 0;
+  if (n > 0) {
+    emitAsm("cltd",NULL,NULL);
+    sprintf(buf,"$%d",32 - n);
+    emitAsm("shrl",buf,"%edx");
+    emitAsm("addl","%edx","%eax");
+    sprintf(buf,"$%d",n);
+    emitAsm("sarl",buf,"%eax");
+  }
+  return m + 1;
+}
+
+/* instructions after jmp or ret up to a label */
+static int unreachable(int k)
+{ int p = asmCount - 1;
+  if (in[k].kind != A_INSTR) return 0;
+  while (p >= 0 && asmCode[p].kind == A_TEXT && asmCode[p].src[0] == '#') p--;
+  if (p < 0 || asmCode[p].kind != A_INSTR) return 0;
+  if (strcmp(asmCode[p].op,"jmp") && strcmp(asmCode[p].op,"ret")) return 0;
+  return k + 1;
+}
+
+/* jmp L; L: */
+static int jumpNext(int k)
+{ if (!isOp(k,"jmp") || !labelFollows(k,in[k].src)) return 0;
+  return k + 1;
+}
+
+/* jcc L1; jmp L2; L1: becomes jncc L2; L1: */
+static int branchOverJump(int k)
+{ int j = next(k);
+  char * inv;
+  if (!isJump(k) || isOp(k,"jmp") || !isOp(j,"jmp")) return 0;
+  if ((inv = invert(in[k].op)) == NULL || !labelFollows(j,in[k].src)) return 0;
+  emitAsm(inv,in[j].src,NULL);
+  return j + 1;
+}
+
+/* a jump to a jump goes to the final target */
+static int jumpChain(int k)
+{ char * end;
+  if (!isJump(k) || (end = chainEnd(in[k].src)) == NULL) return 0;
+  emitAsm(in[k].op,end,NULL);
+  return k + 1;
+}
+
+/* local labels nothing jumps to */
+static int deadLabel(int k)
+{ if (!isLabel(k) || strncmp(in[k].src,".L",2) != 0) return 0;
+  if (referenced(in[k].src)) return 0;
+  return k + 1;
+}
+
+static struct
+{ char * name;
+  int (*apply)(int k);
+  int hits;
+} rules[] =
+{ { "store-reload", storeReload, 0 },
+  { "load-forward", loadForward, 0 },
+  { "push-pop", pushPop, 0 },
+  { "self-move", selfMove, 0 },
+  { "mul-pow2", mulPow2, 0 },
+  { "div-pow2", divPow2, 0 },
+  { "unreachable", unreachable, 0 },
+  { "jump-next", jumpNext, 0 },
+  { "branch-over-jump", branchOverJump, 0 },
+  { "jump-chain", jumpChain, 0 },
+  { "dead-label", deadLabel, 0 },
+  { NULL, NULL, 0 } };
+
+/* instruction counts of the optimized functions */
+typedef struct PeepStatRec
+{ char * name;
+  int before, after;
+  struct PeepStatRec * next;
+} * PeepStat;
+
+static PeepStat stats = NULL;
+static PeepStat * lastStat = &stats;
+
+static int countInstrs(void)
+{ int k, n = 0;
+  for (k = 0; k < asmCount; k++)
+    if (asmCode[k].kind == A_INSTR) n++;
+  return n;
+}
+
+void peephole(char * name)
+{ int pass, changed, k, n, r;
+  PeepStat st = (PeepStat) malloc(sizeof(struct PeepStatRec));
+  st->name = name;
+  st->before = countInstrs();
+  for (pass = 0; pass < MAXPASSES; pass++) {
+    if (asmCount > maxin) {
+      maxin = asmCount;
+      in = (AsmLine *) realloc(in, sizeof(AsmLine) * maxin);
+    }
+    memcpy(in,asmCode,sizeof(AsmLine) * asmCount);
+    nin = asmCount;
+    asmCount = 0;
+    changed = FALSE;
+    k = 0;
+    while (k < nin) {
+      n = 0;
+      if (!isNote(k))
+        for (r = 0; rules[r].name != NULL; r++)
+          if ((n = rules[r].apply(k)) != 0) {
+            rules[r].hits++;
+            changed = TRUE;
+            break;
+          }
+      if (n) k = n;
+      else emitAsmLine(&in[k++]);
+    }
+    if (!changed) break;
+  }
+  st->after = countInstrs();
+  st->next = NULL;
+  *lastStat = st;
+  lastStat = &st->next;
+}
+
+void peepholeReport(FILE * out)
+{ PeepStat st, next;
+  int r;
+  fprintf(out,"\nFunction        Before   After\n");
+  fprintf(out,"--------------  -------- --------\n");
+  for (st = stats; st != NULL; st = next) {
+    next = st->next;
+    fprintf(out,"%-14s  %-8d %d\n",st->name,st->before,st->after);
+    free(st);
+  }
+  stats = NULL;
+  lastStat = &stats;
+  fprintf(out,"\nPeephole rule     Applied\n");
+  fprintf(out,"----------------  --------\n");
+  for (r = 0; rules[r].name != NULL; r++)
+    fprintf(out,"%-16s  %d\n",rules[r].name,rules[r].hits);
+}
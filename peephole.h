@@ -0,0 +1,22 @@
+/****************************************************/
+/* File: peephole.h                                 */
+/* Peephole optimizer interface for the C- compiler */
+/* Works on the buffered instructions of code.c     */
+/****************************************************/
+
+#ifndef _PEEPHOLE_H_
+#define _PEEPHOLE_H_
+
+/* Procedure peephole rewrites the buffered code of
+ * function name with the rules of its table until
+ * none applies, and records the instruction counts
+ * before and after
+ */
+void peephole(char * name);
+
+/* Procedure peepholeReport prints the counts per
+ * function and how often each rule applied
+ */
+void peepholeReport(FILE * out);
+
+#endif
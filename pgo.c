@@ -0,0 +1,240 @@
+/****************************************************/
+/* File: pgo.c                                      */
+/* Profile-guided optimization for the C- compiler  */
+/* The counts file has one record per line,         */
+/* "function<TAB>line<TAB>kind<TAB>count". Lines    */
+/* are taken relative to the entry of the function, */
+/* and ifs and loops also by their place in it, so  */
+/* edits elsewhere in the file or a few lines away  */
+/* leave a record usable.                           */
+/****************************************************/
+
+#include <stdarg.h>
+#include "globals.h"
+#include "util.h"
+#include "pgo.h"
+
+/* record kinds, in the order of kindName */
+#define K_ENTRY 0
+#define K_LINE  1
+#define NKINDS  5
+
+static char * kindName[NKINDS] = { "entry", "line", "then", "else", "loop" };
+
+typedef struct
+{ int lineno;
+  int kind;
+  int nth;   /* place of an if or loop, -1 for others */
+  long count;
+} Record;
+
+/* the records of one function */
+typedef struct FunProfRec
+{ char * name;
+  int lineno;         /* of the entry, -1 if not recorded */
+  Record * recs;
+  int nrecs, maxrecs;
+  int seen[NKINDS];   /* ifs and loops read in this run */
+  int used;           /* TRUE once looked up */
+  struct FunProfRec * next;
+} * FunProf;
+
+static FunProf funs = NULL;
+static char * profName = NULL;
+static int nruns = 0;
+static int nrecords = 0;
+static int nbad = 0;
+static long maxCount = 0;
+static int nmatched = 0, nmissed = 0;
+
+/* a decision the profile changed */
+typedef struct NoteRec
+{ char * fun;
+  int lineno;
+  char * text;
+  struct NoteRec * next;
+} * Note;
+
+static Note notes = NULL;
+static Note * lastNote = &notes;
+
+static FunProf findFun(char * name)
+{ FunProf p;
+  for (p = funs; p != NULL; p = p->next)
+    if (strcmp(p->name,name) == 0) return p;
+  return NULL;
+}
+
+static int kindOf(char * name)
+{ int k;
+  for (k = 0; k < NKINDS; k++)
+    if (strcmp(kindName[k],name) == 0) return k;
+  return -1;
+}
+
+/* Procedure addRecord adds count to the record of p
+ * at lineno, creating it if this is a new one
+ */
+static void addRecord(FunProf p, int lineno, int kind, long count)
+{ Record * r;
+  int nth = -1;
+  int k;
+  if (kind == K_ENTRY) {
+    nth = 0;
+    p->lineno = lineno;
+  }
+  else if (kind != K_LINE) nth = p->seen[kind]++;
+  for (k = 0; k < p->nrecs; k++) {
+    r = &p->recs[k];
+    if (r->kind == kind && r->nth == nth && r->lineno == lineno) {
+      r->count += count;
+      if (r->count > maxCount) maxCount = r->count;
+      return;
+    }
+  }
+  if (p->nrecs == p->maxrecs) {
+    p->maxrecs = p->maxrecs ? 2 * p->maxrecs : 16;
+    p->recs = (Record *) realloc(p->recs, sizeof(Record) * p->maxrecs);
+  }
+  r = &p->recs[p->nrecs++];
+  r->lineno = lineno;
+  r->kind = kind;
+  r->nth = nth;
+  r->count = count;
+  if (count > maxCount) maxCount = count;
+  nrecords++;
+}
+
+int pgoLoad(char * file)
+{ FILE * in = fopen(file,"r");
+  char buf[256];
+  char name[STRINGSIZE + 16];
+  char kind[16];
+  int lineno, k;
+  long count;
+  FunProf p;
+  if (in == NULL) return FALSE;
+  profName = copyString(file);
+  while (fgets(buf,sizeof(buf),in) != NULL) {
+    if (buf[0] == '#') {
+      /* a header starts the records of another run */
+      if (strncmp(buf,"# C- execution counts",21) == 0) {
+        nruns++;
+        for (p = funs; p != NULL; p = p->next)
+          memset(p->seen,0,sizeof(p->seen));
+      }
+      continue;
+    }
+    if (buf[strspn(buf," \t\r\n")] == '\0') continue;
+    if (sscanf(buf,"%40s %d %15s %ld",name,&lineno,kind,&count) != 4 || count < 0) {
+      nbad++;
+      continue;
+    }
+    /* kinds added by later versions are skipped */
+    if ((k = kindOf(kind)) < 0) continue;
+    if ((p = findFun(name)) == NULL) {
+      p = (FunProf) calloc(1, sizeof(struct FunProfRec));
+      p->name = copyString(name);
+      p->lineno = -1;
+      p->next = funs;
+      funs = p;
+    }
+    addRecord(p,lineno,k,count);
+  }
+  fclose(in);
+  if (nruns == 0) nruns = 1;
+  return TRUE;
+}
+
+long pgoCount(TreeNode * fun, int lineno, char * kind, int nth)
+{ FunProf p = findFun(fun->attr.name);
+  Record * r;
+  Record * best = NULL;
+  int k, want, dist, bestDist = PGOSLACK + 1;
+  if (p == NULL || (k = kindOf(kind)) < 0) return -1;
+  p->used = TRUE;
+  /* the line where the record would be now that
+   * the function starts at fun->lineno */
+  want = p->lineno >= 0 ? lineno - fun->lineno + p->lineno : lineno;
+  for (r = p->recs; r < p->recs + p->nrecs; r++) {
+    if (r->kind != k) continue;
+    dist = r->lineno > want ? r->lineno - want : want - r->lineno;
+    /* the if or loop at the same place wins over a
+     * nearer one */
+    if (nth >= 0 && r->nth == nth && dist <= PGOSLACK) {
+      best = r;
+      break;
+    }
+    if (dist < bestDist) {
+      best = r;
+      bestDist = dist;
+    }
+  }
+  if (best == NULL) {
+    nmissed++;
+    return -1;
+  }
+  nmatched++;
+  return best->count;
+}
+
+int pgoHot(long count)
+{ return count > 0 && count * PGOHOT >= maxCount; }
+
+int pgoUnroll(long iters, long runs, int factor)
+{ long trip;
+  if (factor <= 1) return factor;
+  /* code never run is kept small */
+  if (iters == 0) return 1;
+  trip = runs > 0 ? iters / runs : iters;
+  if (trip < 2) return 1;
+  while (factor > trip) factor /= 2;
+  if (pgoHot(iters) && trip >= 4 * factor && 2 * factor <= PGOMAXUNROLL)
+    factor *= 2;
+  return factor;
+}
+
+void pgoNote(TreeNode * fun, int lineno, char * fmt, ...)
+{ Note n = (Note) malloc(sizeof(struct NoteRec));
+  char buf[160];
+  va_list ap;
+  va_start(ap,fmt);
+  vsnprintf(buf,sizeof(buf),fmt,ap);
+  va_end(ap);
+  n->fun = fun->attr.name;
+  n->lineno = lineno;
+  n->text = copyString(buf);
+  n->next = NULL;
+  *lastNote = n;
+  lastNote = &n->next;
+}
+
+void pgoReport(FILE * out)
+{ FunProf p;
+  Note n, next;
+  int nfuns = 0, nstale = 0;
+  for (p = funs; p != NULL; p = p->next) {
+    nfuns++;
+    if (!p->used) nstale++;
+  }
+  fprintf(out,"\nProfile %s: %d records of %d functions from %d runs\n",
+          profName,nrecords,nfuns,nruns);
+  if (nbad > 0) fprintf(out,"  %d malformed lines skipped\n",nbad);
+  if (nstale > 0) {
+    fprintf(out,"  not compiled:");
+    for (p = funs; p != NULL; p = p->next)
+      if (!p->used) fprintf(out," %s",p->name);
+    fprintf(out,"\n");
+  }
+  fprintf(out,"  %d lookups matched, %d found no record\n",nmatched,nmissed);
+  fprintf(out,"\nDecisions changed by the profile:\n");
+  if (notes == NULL) fprintf(out,"  none\n");
+  for (n = notes; n != NULL; n = next) {
+    next = n->next;
+    fprintf(out,"  %s line %d: %s\n",n->fun,n->lineno,n->text);
+    free(n->text);
+    free(n);
+  }
+  notes = NULL;
+  lastNote = &notes;
+}
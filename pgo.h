@@ -0,0 +1,66 @@
+/****************************************************/
+/* File: pgo.h                                      */
+/* Profile-guided optimization interface for the C- */
+/* compiler: reads the counts written by programs   */
+/* compiled with -C                                 */
+/****************************************************/
+
+#ifndef _PGO_H_
+#define _PGO_H_
+
+/* PGOSLACK is how many lines a statement may have
+ * moved within its function since the profile was
+ * taken and still find its count
+ */
+#define PGOSLACK 3
+
+/* a block is hot when it ran at least 1/PGOHOT as
+ * often as the hottest block of the program
+ */
+#define PGOHOT 100
+
+/* the side of an if running PGOBIAS times less
+ * often than the other is moved out of line
+ */
+#define PGOBIAS 4
+
+/* PGOMAXUNROLL bounds the unroll factor chosen for
+ * hot loops
+ */
+#define PGOMAXUNROLL 16
+
+/* Function pgoLoad reads the counts of file; the
+ * records of several runs (files concatenated with
+ * their headers) are added up. It returns FALSE if
+ * the file cannot be read
+ */
+int pgoLoad(char * file);
+
+/* Function pgoCount returns the count recorded for
+ * the kind (entry, line, then, else or loop) of
+ * function fun at lineno, or -1 if there is none;
+ * nth is the place of the if or loop among those of
+ * the function, or -1 for entry and line records
+ */
+long pgoCount(TreeNode * fun, int lineno, char * kind, int nth);
+
+/* Function pgoHot is TRUE if count makes a block hot */
+int pgoHot(long count);
+
+/* Function pgoUnroll returns the unroll factor for a
+ * loop whose body ran iters times in runs entries,
+ * given the factor used without a profile
+ */
+int pgoUnroll(long iters, long runs, int factor);
+
+/* Procedure pgoNote records a decision of function
+ * fun at lineno that the profile changed
+ */
+void pgoNote(TreeNode * fun, int lineno, char * fmt, ...);
+
+/* Procedure pgoReport prints how the profile matched
+ * the program and the decisions it changed
+ */
+void pgoReport(FILE * out);
+
+#endif
@@ -0,0 +1,234 @@
+/****************************************************/
+/* File: plex.c                                     */
+/* Parallel scanner for the C- compiler. A chunk    */
+/* starts after a newline, so the only state it can */
+/* start in besides the initial one is inside a     */
+/* comment; each thread guesses that state for its  */
+/* chunk, and a chunk guessed wrong is scanned      */
+/* again when the chunks are joined. Line numbers   */
+/* are counted from the chunk start and rebased     */
+/* then                                             */
+/****************************************************/
+
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "globals.h"
+#include "util.h"
+#include "parse.h"
+#include "push.h"
+#include "plex.h"
+
+/* a token of a chunk: its line counts from the
+ * start of the chunk, its lexeme (ID or NUM) is
+ * len bytes at offset text in the source
+ */
+typedef struct
+{ int token;
+  int line;
+  int len;
+  long text;
+} Lexeme;
+
+typedef struct
+{ char * start;
+  char * end;          /* just after a newline or at EOF */
+  int comment;         /* TRUE if scanned as starting in a comment */
+  int endComment;      /* TRUE if it ended in a comment */
+  int lines;           /* the newlines in the chunk */
+  Lexeme * tokens;
+  int ntokens, maxtokens;
+  pthread_t thread;
+  int started;
+} Chunk;
+
+/* the mapped source */
+static char * text;
+
+static void add(Chunk * c, int token, int line, char * p, int len)
+{ Lexeme * t;
+  if (c->ntokens == c->maxtokens) {
+    c->maxtokens = c->maxtokens ? 2 * c->maxtokens : 1024;
+    c->tokens = (Lexeme *) realloc(c->tokens, sizeof(Lexeme) * c->maxtokens);
+  }
+  t = &c->tokens[c->ntokens++];
+  t->token = token;
+  t->line = line;
+  t->text = p - text;
+  t->len = len;
+}
+
+static TokenType reserved(char * p, int len)
+{ static struct { char * str; TokenType tok; } words[] =
+    { {"if",IF}, {"else",ELSE}, {"int",INT}, {"return",RETURN},
+      {"void",VOID}, {"while",WHILE}, {NULL,0} };
+  int i;
+  for (i = 0; words[i].str != NULL; i++)
+    if (strncmp(p,words[i].str,len) == 0 && words[i].str[len] == '\0')
+      return words[i].tok;
+  return ID;
+}
+
+/* Procedure scanChunk scans c from the state in
+ * c->comment, as cminus.l does
+ */
+static void scanChunk(Chunk * c)
+{ char * p = c->start;
+  char * q;
+  int line = 0, inComment = c->comment, star = FALSE, eq;
+  c->ntokens = 0;
+  while (p < c->end) {
+    if (inComment) {
+      if (star && *p == '/') inComment = FALSE;
+      else {
+        if (*p == '\n') line++;
+        star = *p == '*';
+      }
+      p++;
+      continue;
+    }
+    if (isalpha((unsigned char) *p)) {
+      for (q = p; q < c->end && isalpha((unsigned char) *q); q++)
+        ;
+      add(c,reserved(p,q - p),line,p,q - p);
+      p = q;
+      continue;
+    }
+    if (isdigit((unsigned char) *p)) {
+      for (q = p; q < c->end && isdigit((unsigned char) *q); q++)
+        ;
+      add(c,NUM,line,p,q - p);
+      p = q;
+      continue;
+    }
+    /* a chunk ends after a newline, so no token is
+     * cut at its end */
+    eq = p + 1 < c->end && p[1] == '=';
+    switch (*p) {
+      case '<': if (eq) add(c,LEQ,line,p++,2); else add(c,LES,line,p,1); break;
+      case '>': if (eq) add(c,BEQ,line,p++,2); else add(c,BIG,line,p,1); break;
+      case '=': if (eq) add(c,EQ,line,p++,2); else add(c,ASSIGN,line,p,1); break;
+      case '!': if (eq) add(c,NEQ,line,p++,2); else add(c,ERROR,line,p,1); break;
+      case '/':
+        if (p + 1 < c->end && p[1] == '*') {
+          inComment = TRUE;
+          star = FALSE;
+          p++;
+        }
+        else add(c,DIV,line,p,1);
+        break;
+      case '\n': line++; break;
+      case ' ': case '\t': break;
+      case '+': add(c,PLUS,line,p,1); break;
+      case '-': add(c,MINUS,line,p,1); break;
+      case '*': add(c,MUL,line,p,1); break;
+      case ';': add(c,SEMI,line,p,1); break;
+      case ',': add(c,COMMA,line,p,1); break;
+      case '(': add(c,SOPEN,line,p,1); break;
+      case ')': add(c,SCLOSE,line,p,1); break;
+      case '{': add(c,MOPEN,line,p,1); break;
+      case '}': add(c,MCLOSE,line,p,1); break;
+      case '[': add(c,BOPEN,line,p,1); break;
+      case ']': add(c,BCLOSE,line,p,1); break;
+      default: add(c,ERROR,line,p,1); break;
+    }
+    p++;
+  }
+  c->endComment = inComment;
+  c->lines = line;
+}
+
+/* Function guessComment guesses whether a chunk
+ * starts inside a comment: it does if a comment
+ * ends in it before one begins
+ */
+static int guessComment(Chunk * c)
+{ char * p;
+  for (p = c->start; p + 1 < c->end; p++) {
+    if (p[0] == '/' && p[1] == '*') return FALSE;
+    if (p[0] == '*' && p[1] == '/') return TRUE;
+  }
+  return FALSE;
+}
+
+static void * scanner(void * arg)
+{ Chunk * c = (Chunk *) arg;
+  c->comment = c->start != text && guessComment(c);
+  scanChunk(c);
+  return NULL;
+}
+
+TreeNode * parallelParse(int fd, int nthreads, void (* decl)(TreeNode *))
+{ struct stat st;
+  Chunk * chunks;
+  char * p;
+  char * end;
+  char lexeme[STRINGSIZE];
+  int n, i, k, len, line, comment, parsing;
+  long size;
+  if (fstat(fd,&st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    return pushParse(fd,decl);
+  size = st.st_size;
+  text = (char *) mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+  if (text == MAP_FAILED) return pushParse(fd,decl);
+  end = text + size;
+  /* cut the source after newlines */
+  n = size / PLEXMIN;
+  if (n > nthreads) n = nthreads;
+  if (n < 1) n = 1;
+  chunks = (Chunk *) calloc(n, sizeof(Chunk));
+  p = text;
+  for (i = 0; i < n && p < end; i++) {
+    chunks[i].start = p;
+    if (i == n - 1) p = end;
+    else {
+      p += size / n;
+      if (p >= end) p = end;
+      else {
+        p = memchr(p,'\n',end - p);
+        p = p == NULL ? end : p + 1;
+      }
+    }
+    chunks[i].end = p;
+  }
+  n = i;
+  for (i = 0; i < n; i++)
+    chunks[i].started =
+      pthread_create(&chunks[i].thread,NULL,scanner,&chunks[i]) == 0;
+  /* join the chunks in order, handing their tokens
+   * to the parser */
+  parseBegin(decl);
+  line = lineno;
+  comment = FALSE;
+  parsing = TRUE;
+  for (i = 0; i < n; i++) {
+    Chunk * c = &chunks[i];
+    if (c->started) pthread_join(c->thread,NULL);
+    else scanner(c);
+    if (parsing && c->comment != comment) {
+      /* guessed wrong */
+      c->comment = comment;
+      scanChunk(c);
+    }
+    for (k = 0; k < c->ntokens && parsing; k++) {
+      Lexeme * t = &c->tokens[k];
+      lineno = line + t->line;
+      if (t->token == ID || t->token == NUM) {
+        len = t->len < STRINGSIZE ? t->len : STRINGSIZE - 1;
+        memcpy(lexeme,text + t->text,len);
+        lexeme[len] = '\0';
+        st_push(lexeme);
+      }
+      parsing = parseToken(t->token);
+    }
+    line += c->lines;
+    comment = c->endComment;
+    free(c->tokens);
+  }
+  lineno = line;
+  if (comment && parsing) parseToken(ERROR);  /* unterminated comment */
+  free(chunks);
+  munmap(text,size);
+  return parseEnd();
+}
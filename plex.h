@@ -0,0 +1,26 @@
+/****************************************************/
+/* File: plex.h                                     */
+/* Parallel scanner for the C- compiler: a source   */
+/* file is cut into chunks that are scanned on      */
+/* several threads at once                          */
+/****************************************************/
+
+#ifndef _PLEX_H_
+#define _PLEX_H_
+
+/* PLEXMIN is the smallest chunk worth a thread */
+#define PLEXMIN (256 * 1024)
+
+/* Function parallelParse parses the source file fd
+ * as parse does, calling decl on each top-level
+ * declaration as parseDecls. The file is cut after
+ * newlines into up to nthreads chunks, which are
+ * scanned at the same time into token arrays; the
+ * arrays are then handed to the parser in order,
+ * giving the tokens and line numbers of the
+ * sequential scanner. A source that cannot be
+ * mapped is parsed with pushParse
+ */
+TreeNode * parallelParse(int fd, int nthreads, void (* decl)(TreeNode *));
+
+#endif
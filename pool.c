@@ -0,0 +1,197 @@
+/****************************************************/
+/* File: pool.c                                     */
+/* Work-stealing thread pool for the C- compiler's  */
+/* interpreter. Every thread owns a deque of tasks: */
+/* it pushes and pops at the bottom, idle threads   */
+/* steal the oldest task at the top. Threads with   */
+/* nothing to steal sleep until a task is queued.   */
+/****************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include "globals.h"
+#include "pool.h"
+
+typedef struct
+{ pthread_mutex_t lock;
+  Task * tasks[POOLDEQUE];
+  int top, bottom; /* tasks[top..bottom-1] wait */
+} Deque;
+
+/* top and bottom change under the lock, but are
+ * also read without it to skip empty deques
+ */
+#define SET(x,v) __atomic_store_n(&(x),(v),__ATOMIC_RELAXED)
+#define GET(x) __atomic_load_n(&(x),__ATOMIC_RELAXED)
+
+static Deque * deques = NULL;
+static pthread_t * threads = NULL;
+static int nthreads = 0;
+
+/* the deque of the running thread */
+static __thread int self = 0;
+
+/* queued counts the waiting tasks of all deques,
+ * sleepers the threads waiting for one
+ */
+static int queued = 0;
+static int sleepers = 0;
+static int stopping = FALSE;
+static pthread_mutex_t idleLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idleCond = PTHREAD_COND_INITIALIZER;
+
+static long spawned = 0;
+static long stolen = 0;
+
+/* Function popTask takes task t off the bottom of
+ * the own deque if it is still there
+ */
+static int popTask(Task * t)
+{ Deque * d = &deques[self];
+  int found = FALSE;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom > d->top && d->tasks[d->bottom - 1] == t) {
+    SET(d->bottom,d->bottom - 1);
+    found = TRUE;
+  }
+  pthread_mutex_unlock(&d->lock);
+  if (found) __sync_fetch_and_sub(&queued,1);
+  return found;
+}
+
+/* Function stealTask takes the oldest task of
+ * another thread, or returns NULL
+ */
+static Task * stealTask(void)
+{ Deque * d;
+  Task * t = NULL;
+  int i;
+  for (i = 1; i < nthreads && t == NULL; i++) {
+    d = &deques[(self + i) % nthreads];
+    if (GET(d->bottom) == GET(d->top)) continue;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top) {
+      t = d->tasks[d->top];
+      SET(d->top,d->top + 1);
+    }
+    if (d->top == d->bottom) {
+      SET(d->top,0);
+      SET(d->bottom,0);
+    }
+    pthread_mutex_unlock(&d->lock);
+  }
+  if (t != NULL) {
+    __sync_fetch_and_sub(&queued,1);
+    __sync_fetch_and_add(&stolen,1);
+  }
+  return t;
+}
+
+static void runTask(Task * t)
+{ t->run(t);
+  __atomic_store_n(&t->done,TRUE,__ATOMIC_RELEASE);
+}
+
+static void * worker(void * arg)
+{ Task * t;
+  self = (int) (long) arg;
+  for (;;) {
+    if ((t = stealTask()) != NULL) {
+      runTask(t);
+      continue;
+    }
+    pthread_mutex_lock(&idleLock);
+    __sync_fetch_and_add(&sleepers,1);
+    while (!stopping && __sync_fetch_and_add(&queued,0) == 0)
+      pthread_cond_wait(&idleCond,&idleLock);
+    __sync_fetch_and_sub(&sleepers,1);
+    pthread_mutex_unlock(&idleLock);
+    if (stopping) break;
+  }
+  return NULL;
+}
+
+void pool_start(int n)
+{ pthread_attr_t attr;
+  int i;
+  nthreads = n > 0 ? n : 1;
+  deques = (Deque *) calloc(nthreads, sizeof(Deque));
+  threads = (pthread_t *) calloc(nthreads, sizeof(pthread_t));
+  if (deques == NULL || threads == NULL) {
+    fprintf(listing,"Out of memory error in thread pool\n");
+    exit(1);
+  }
+  for (i = 0; i < nthreads; i++)
+    pthread_mutex_init(&deques[i].lock,NULL);
+  self = 0;
+  stopping = FALSE;
+  spawned = stolen = 0;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr,POOLSTACK);
+  for (i = 1; i < nthreads; i++)
+    if (pthread_create(&threads[i],&attr,worker,(void *) (long) i) != 0) {
+      /* fewer threads: the deques of the missing
+       * ones stay empty */
+      fprintf(listing,"Warning: could only start %d threads\n",i);
+      nthreads = i;
+      break;
+    }
+  pthread_attr_destroy(&attr);
+}
+
+void pool_stop(void)
+{ int i;
+  pthread_mutex_lock(&idleLock);
+  stopping = TRUE;
+  pthread_cond_broadcast(&idleCond);
+  pthread_mutex_unlock(&idleLock);
+  for (i = 1; i < nthreads; i++) pthread_join(threads[i],NULL);
+  for (i = 0; i < nthreads; i++) pthread_mutex_destroy(&deques[i].lock);
+  free(deques);
+  free(threads);
+  deques = NULL;
+  threads = NULL;
+  nthreads = 0;
+}
+
+int pool_spawn(Task * t)
+{ Deque * d = &deques[self];
+  int ok = FALSE;
+  t->done = FALSE;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom < POOLDEQUE) {
+    d->tasks[d->bottom] = t;
+    SET(d->bottom,d->bottom + 1);
+    __sync_fetch_and_add(&queued,1);
+    ok = TRUE;
+  }
+  pthread_mutex_unlock(&d->lock);
+  if (!ok) return FALSE;
+  __sync_fetch_and_add(&spawned,1);
+  /* queued went up before sleepers is read, and the
+   * other way round in worker, so that either the
+   * task is seen or the sleeper is woken */
+  if (__sync_fetch_and_add(&sleepers,0) > 0) {
+    pthread_mutex_lock(&idleLock);
+    pthread_cond_signal(&idleCond);
+    pthread_mutex_unlock(&idleLock);
+  }
+  return TRUE;
+}
+
+void pool_join(Task * t)
+{ Task * u;
+  if (popTask(t)) {
+    runTask(t);
+    return;
+  }
+  while (!__atomic_load_n(&t->done,__ATOMIC_ACQUIRE)) {
+    if ((u = stealTask()) != NULL) runTask(u);
+    else sched_yield();
+  }
+}
+
+void pool_report(FILE * listing)
+{ fprintf(listing,"\nFork-join: %d threads, %ld tasks spawned, %ld stolen\n",
+          nthreads,spawned,stolen);
+}
@@ -0,0 +1,54 @@
+/****************************************************/
+/* File: pool.h                                     */
+/* Work-stealing thread pool interface for the C-   */
+/* compiler's interpreter                           */
+/****************************************************/
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+/* POOLDEQUE is the number of tasks a thread can
+ * have waiting; further spawns are refused and run
+ * by the caller
+ */
+#define POOLDEQUE 256
+
+/* POOLSTACK is the stack size of a worker thread,
+ * enough for MAXCALLDEPTH levels of C- calls
+ */
+#define POOLSTACK (64 * 1024 * 1024)
+
+/* a task is embedded at the start of a larger
+ * record holding its arguments and results
+ */
+typedef struct TaskRec
+{ void (*run)(struct TaskRec *);
+  int done;
+} Task;
+
+/* Procedure pool_start starts the pool with n
+ * threads, the calling thread being the first
+ */
+void pool_start(int n);
+
+/* Procedure pool_stop stops the worker threads */
+void pool_stop(void);
+
+/* Function pool_spawn queues task t on the calling
+ * thread, where idle threads can steal it; it
+ * returns FALSE if the queue is full
+ */
+int pool_spawn(Task * t);
+
+/* Procedure pool_join returns when task t is done,
+ * running it if nobody stole it and running stolen
+ * tasks while it waits
+ */
+void pool_join(Task * t);
+
+/* Procedure pool_report prints the number of tasks
+ * spawned and stolen to the listing file
+ */
+void pool_report(FILE * listing);
+
+#endif
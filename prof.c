@@ -0,0 +1,275 @@
+/****************************************************/
+/* File: prof.c                                     */
+/* Sampling profiler for the C- compiler's          */
+/* interpreter. A CPU-time timer raises SIGPROF;    */
+/* the handler copies the chain of calls of the     */
+/* interrupted thread, with the line each one is    */
+/* at, into a preallocated buffer. The profiles are */
+/* built from the buffer after the run.             */
+/****************************************************/
+
+#include <signal.h>
+#include <sys/time.h>
+#include "globals.h"
+#include "prof.h"
+
+__thread ProfFrame * volatile profTop = NULL;
+
+typedef struct
+{ TreeNode * fun;
+  int lineno;
+} Site;
+
+/* a sample: frames[0] is the innermost call */
+typedef struct
+{ int depth;
+  int cut; /* TRUE if outer calls were dropped */
+  Site frames[PROFDEPTH];
+} Sample;
+
+static Sample * samples = NULL;
+static int nsamples = 0;
+/* ticks outside C- code, such as idle threads */
+static int nidle = 0;
+
+static struct sigaction oldAction;
+
+static void sample(int sig)
+{ ProfFrame * p = profTop;
+  Sample * s;
+  int k, n = 0;
+  (void) sig;
+  if (p == NULL) {
+    __sync_fetch_and_add(&nidle,1);
+    return;
+  }
+  k = __sync_fetch_and_add(&nsamples,1);
+  if (k >= PROFSAMPLES) return;
+  s = &samples[k];
+  for (; p != NULL && n < PROFDEPTH; p = p->up, n++) {
+    s->frames[n].fun = p->fun;
+    s->frames[n].lineno = p->lineno;
+  }
+  s->depth = n;
+  s->cut = p != NULL;
+}
+
+void prof_start(void)
+{ struct sigaction sa;
+  struct itimerval it;
+  if (samples == NULL)
+    samples = (Sample *) malloc(sizeof(Sample) * PROFSAMPLES);
+  if (samples == NULL) {
+    fprintf(listing,"Out of memory error in profiler\n");
+    exit(1);
+  }
+  nsamples = nidle = 0;
+  memset(&sa,0,sizeof(sa));
+  sa.sa_handler = sample;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGPROF,&sa,&oldAction);
+  it.it_interval.tv_sec = 0;
+  it.it_interval.tv_usec = 1000000 / PROFHZ;
+  it.it_value = it.it_interval;
+  setitimer(ITIMER_PROF,&it,NULL);
+}
+
+void prof_stop(void)
+{ struct itimerval it;
+  memset(&it,0,sizeof(it));
+  setitimer(ITIMER_PROF,&it,NULL);
+  sigaction(SIGPROF,&oldAction,NULL);
+}
+
+/* the call-path tree; the children of a node are
+ * the calls made from its line
+ */
+typedef struct PathRec
+{ Site site;
+  int total, self;
+  struct PathRec * child;
+  struct PathRec * sibling;
+} * Path;
+
+static Path newPath(TreeNode * fun, int lineno)
+{ Path p = (Path) calloc(1, sizeof(struct PathRec));
+  p->site.fun = fun;
+  p->site.lineno = lineno;
+  return p;
+}
+
+/* Function step returns the child of p at site s,
+ * adding it if needed
+ */
+static Path step(Path p, Site * s)
+{ Path c;
+  for (c = p->child; c != NULL; c = c->sibling)
+    if (c->site.fun == s->fun && c->site.lineno == s->lineno) return c;
+  c = newPath(s->fun,s->lineno);
+  c->sibling = p->child;
+  p->child = c;
+  return c;
+}
+
+static Path buildPaths(int n)
+{ Path root = newPath(NULL,0);
+  Path p;
+  Site cut;
+  int k, i;
+  cut.fun = NULL;
+  cut.lineno = 0;
+  for (k = 0; k < n; k++) {
+    p = root;
+    p->total++;
+    if (samples[k].cut) {
+      p = step(p,&cut);
+      p->total++;
+    }
+    for (i = samples[k].depth - 1; i >= 0; i--) {
+      p = step(p,&samples[k].frames[i]);
+      p->total++;
+    }
+    p->self++;
+  }
+  return root;
+}
+
+static void freePaths(Path p)
+{ Path next;
+  for (; p != NULL; p = next) {
+    next = p->sibling;
+    freePaths(p->child);
+    free(p);
+  }
+}
+
+static char * siteName(Site * s)
+{ return s->fun != NULL ? s->fun->attr.name : "[...]"; }
+
+static int heavier(const void * a, const void * b)
+{ return (*(Path *) b)->total - (*(Path *) a)->total; }
+
+/* Procedure printPaths prints the subtree p with
+ * the heaviest calls first, leaving out those under
+ * one percent of all samples
+ */
+static void printPaths(FILE * out, Path p, int indent, int n)
+{ Path c;
+  Path * sorted;
+  int nchild = 0, k, i;
+  for (c = p->child; c != NULL; c = c->sibling) nchild++;
+  if (nchild == 0) return;
+  sorted = (Path *) malloc(sizeof(Path) * nchild);
+  for (k = 0, c = p->child; c != NULL; c = c->sibling) sorted[k++] = c;
+  qsort(sorted,nchild,sizeof(Path),heavier);
+  for (k = 0; k < nchild && 100 * sorted[k]->total >= n; k++) {
+    c = sorted[k];
+    i = fprintf(out,"%*s%s:%d",2 * indent,"",siteName(&c->site),c->site.lineno);
+    fprintf(out,"%*s %-8d %6.2f%%\n",i < 40 ? 40 - i : 0,"",c->total,100.0 * c->total / n);
+    printPaths(out,c,indent + 1,n);
+  }
+  free(sorted);
+}
+
+/* the flat profile of one function */
+typedef struct
+{ TreeNode * fun;
+  int self, total;
+} FunCount;
+
+static int busier(const void * a, const void * b)
+{ return ((FunCount *) b)->self - ((FunCount *) a)->self; }
+
+void prof_report(FILE * listing)
+{ int n = nsamples < PROFSAMPLES ? nsamples : PROFSAMPLES;
+  FunCount * funs = NULL;
+  int * lines;
+  TreeNode ** lineFun;
+  int nfuns = 0, maxfuns = 0, maxline = 0;
+  int k, i, j, f;
+  Path root;
+  fprintf(listing,"\nProfile: %d samples at %d Hz",nsamples,PROFHZ);
+  if (nsamples > n) fprintf(listing,", %d not kept",nsamples - n);
+  fprintf(listing,", %d outside C- code\n",nidle);
+  for (k = 0; k < n; k++)
+    for (i = 0; i < samples[k].depth; i++) {
+      Site * s = &samples[k].frames[i];
+      if (s->lineno > maxline) maxline = s->lineno;
+      for (f = 0; f < nfuns && funs[f].fun != s->fun; f++) ;
+      if (f == nfuns) {
+        if (nfuns == maxfuns) {
+          maxfuns = maxfuns ? 2 * maxfuns : 16;
+          funs = (FunCount *) realloc(funs, sizeof(FunCount) * maxfuns);
+        }
+        funs[nfuns].fun = s->fun;
+        funs[nfuns].self = funs[nfuns].total = 0;
+        nfuns++;
+      }
+      if (i == 0) funs[f].self++;
+      /* a recursive function counts once per sample */
+      for (j = 0; j < i && samples[k].frames[j].fun != s->fun; j++) ;
+      if (j == i) funs[f].total++;
+    }
+  /* lines counts per function and line, functions
+   * inlined or linked from other units sharing line
+   * numbers; lineFun keeps the functions unsorted */
+  lines = (int *) calloc((size_t) nfuns * (maxline + 1) + 1, sizeof(int));
+  lineFun = (TreeNode **) malloc(sizeof(TreeNode *) * (nfuns + 1));
+  for (f = 0; f < nfuns; f++) lineFun[f] = funs[f].fun;
+  for (k = 0; k < n; k++)
+    if (samples[k].depth > 0) {
+      Site * s = &samples[k].frames[0];
+      for (f = 0; lineFun[f] != s->fun; f++) ;
+      lines[f * (maxline + 1) + s->lineno]++;
+    }
+  if (nfuns > 0) qsort(funs,nfuns,sizeof(FunCount),busier);
+  fprintf(listing,"\nFunction        Self     Total    Self %%\n");
+  fprintf(listing,"--------------  -------- -------- --------\n");
+  for (f = 0; f < nfuns; f++)
+    fprintf(listing,"%-14s  %-8d %-8d %6.2f%%\n",funs[f].fun->attr.name,
+            funs[f].self,funs[f].total,100.0 * funs[f].self / n);
+  fprintf(listing,"\nLine    Function        Samples  %%\n");
+  fprintf(listing,"------  --------------  -------- --------\n");
+  for (i = 0; i <= maxline; i++)
+    for (f = 0; f < nfuns; f++) {
+      j = lines[f * (maxline + 1) + i];
+      if (j > 0)
+        fprintf(listing,"%-6d  %-14s  %-8d %6.2f%%\n",i,lineFun[f]->attr.name,
+                j,100.0 * j / n);
+    }
+  fprintf(listing,"\nCall path (function:line)                Samples  %%\n");
+  fprintf(listing,"---------------------------------------- -------- --------\n");
+  root = buildPaths(n);
+  printPaths(listing,root,0,n);
+  freePaths(root);
+  free(funs);
+  free(lines);
+  free(lineFun);
+}
+
+/* Procedure foldPaths writes the stacks ending in
+ * the subtree p; chain[0..len-1] is the path to p
+ */
+static void foldPaths(FILE * out, Path p, Path * chain, int len)
+{ Path c;
+  int i;
+  for (c = p->child; c != NULL; c = c->sibling) {
+    chain[len] = c;
+    if (c->self > 0) {
+      for (i = 0; i <= len; i++)
+        fprintf(out,"%s%s:%d",i ? ";" : "",siteName(&chain[i]->site),chain[i]->site.lineno);
+      fprintf(out," %d\n",c->self);
+    }
+    foldPaths(out,c,chain,len + 1);
+  }
+}
+
+void prof_folded(FILE * out)
+{ int n = nsamples < PROFSAMPLES ? nsamples : PROFSAMPLES;
+  /* PROFDEPTH calls and the mark of a cut stack */
+  Path chain[PROFDEPTH + 1];
+  Path root = buildPaths(n);
+  foldPaths(out,root,chain,0);
+  freePaths(root);
+}
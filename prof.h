@@ -0,0 +1,56 @@
+/****************************************************/
+/* File: prof.h                                     */
+/* Sampling profiler interface for the C- compiler's */
+/* interpreter                                      */
+/****************************************************/
+
+#ifndef _PROF_H_
+#define _PROF_H_
+
+/* PROFHZ is the number of samples per second of
+ * CPU time
+ */
+#define PROFHZ 1000
+
+/* PROFSAMPLES bounds the samples kept; later ones
+ * are only counted
+ */
+#define PROFSAMPLES 16384
+
+/* PROFDEPTH is the number of innermost calls kept
+ * in a sample; deeper stacks are cut at the root
+ */
+#define PROFDEPTH 32
+
+/* a C- call in progress and the line it is at;
+ * the interpreter links them from the innermost
+ */
+typedef struct ProfFrameRec
+{ TreeNode * fun;
+  int lineno;
+  struct ProfFrameRec * up;
+} ProfFrame;
+
+/* profTop is the innermost call of the running
+ * thread, read by the timer signal
+ */
+extern __thread ProfFrame * volatile profTop;
+
+/* Procedure prof_start starts taking samples */
+void prof_start(void);
+
+/* Procedure prof_stop stops the timer */
+void prof_stop(void);
+
+/* Procedure prof_report prints the flat profile by
+ * function and by line, and the call-path profile
+ */
+void prof_report(FILE * listing);
+
+/* Procedure prof_folded writes one line per distinct
+ * stack, "main:9;fib:3 count", as read by flame
+ * graph tools
+ */
+void prof_folded(FILE * out);
+
+#endif
@@ -0,0 +1,249 @@
+/****************************************************/
+/* File: push.c                                     */
+/* Chunk scanner for the C- compiler. It takes the  */
+/* tokens of cminus.l, but from pieces of source of */
+/* any size: a token or comment cut by the end of a */
+/* piece is carried over to the next one            */
+/****************************************************/
+
+#include <unistd.h>
+#include <pthread.h>
+#include "globals.h"
+#include "util.h"
+#include "parse.h"
+#include "ring.h"
+#include "push.h"
+
+/* PUSHCHUNK is the size of the reads of pushParse */
+#define PUSHCHUNK 65536
+
+/* the token being scanned when a piece ended: the
+ * letters of an ID or digits of a NUM in lexeme, or
+ * the first character of < <= > >= = == != / or a
+ * comment, or NONE
+ */
+static enum { NONE, WORD, NUMBER, OPERATOR } pending;
+static char lexeme[STRINGSIZE];
+static int lexlen;
+
+/* inComment is TRUE inside a comment, and star TRUE
+ * if its last character was *
+ */
+static int inComment, star;
+
+/* the line being scanned, which is lineno only once
+ * a token reaches the parser
+ */
+static int line;
+
+/* FALSE once the parser has stopped */
+static int parsing;
+
+/* Procedure send hands a token and its lexeme (NULL
+ * but for ID and NUM) to the parser or the ring
+ */
+static void (* send)(TokenType t, char * text);
+
+static void parseSend(TokenType t, char * text)
+{ lineno = line;
+  if (text != NULL) st_push(text);
+  parsing = parseToken(t);
+}
+
+static void ringSend(TokenType t, char * text)
+{ parsing = ring_put(t,text,line);
+}
+
+static void token(TokenType t)
+{ if (parsing) send(t,NULL);
+}
+
+/* Procedure word sends the ID or reserved word in
+ * lexeme
+ */
+static void word(void)
+{ static struct { char * str; TokenType tok; } reserved[MAXRESERVED] =
+    { {"if",IF}, {"else",ELSE}, {"int",INT}, {"return",RETURN},
+      {"void",VOID}, {"while",WHILE} };
+  int i;
+  lexeme[lexlen] = '\0';
+  for (i = 0; i < MAXRESERVED && reserved[i].str != NULL; i++)
+    if (strcmp(lexeme,reserved[i].str) == 0) {
+      token(reserved[i].tok);
+      return;
+    }
+  if (parsing) send(ID,lexeme);
+}
+
+static void number(void)
+{ lexeme[lexlen] = '\0';
+  if (parsing) send(NUM,lexeme);
+}
+
+/* Procedure operator sends the one-character token
+ * lexeme[0], which no = or * followed
+ */
+static void operator(void)
+{ switch (lexeme[0]) {
+    case '<': token(LES); break;
+    case '>': token(BIG); break;
+    case '=': token(ASSIGN); break;
+    case '/': token(DIV); break;
+    default: token(ERROR); break;  /* ! alone */
+  }
+}
+
+static void scanBegin(void (* to)(TokenType, char *))
+{ pending = NONE;
+  lexlen = 0;
+  inComment = star = FALSE;
+  line = lineno;
+  parsing = TRUE;
+  send = to;
+}
+
+/* Procedure scanEnd sends what is left at the end of
+ * the source, then the end of input
+ */
+static void scanEnd(void)
+{ if (pending == WORD) word();
+  else if (pending == NUMBER) number();
+  else if (pending == OPERATOR) operator();
+  pending = NONE;
+  if (inComment) token(ERROR);  /* unterminated comment */
+  inComment = FALSE;
+  token(0);
+}
+
+void pushBegin(void (* decl)(TreeNode *))
+{ parseBegin(decl);
+  scanBegin(parseSend);
+}
+
+int pushChunk(const char * buf, int len)
+{ int i, c;
+  for (i = 0; i < len && parsing; i++) {
+    c = (unsigned char) buf[i];
+    if (inComment) {
+      if (star && c == '/') inComment = FALSE;
+      else {
+        if (c == '\n') line++;
+        star = c == '*';
+      }
+      continue;
+    }
+    /* finish the token cut off before c */
+    if (pending == WORD) {
+      if (isalpha(c)) {
+        if (lexlen < STRINGSIZE - 1) lexeme[lexlen++] = c;
+        continue;
+      }
+      word();
+    }
+    else if (pending == NUMBER) {
+      if (isdigit(c)) {
+        if (lexlen < STRINGSIZE - 1) lexeme[lexlen++] = c;
+        continue;
+      }
+      number();
+    }
+    else if (pending == OPERATOR) {
+      pending = NONE;
+      if (c == '=' && lexeme[0] != '/') {
+        switch (lexeme[0]) {
+          case '<': token(LEQ); break;
+          case '>': token(BEQ); break;
+          case '=': token(EQ); break;
+          default: token(NEQ); break;
+        }
+        continue;
+      }
+      if (c == '*' && lexeme[0] == '/') {
+        inComment = TRUE;
+        star = FALSE;
+        continue;
+      }
+      operator();
+    }
+    pending = NONE;
+    lexlen = 0;
+    if (isalpha(c)) {
+      pending = WORD;
+      lexeme[lexlen++] = c;
+      continue;
+    }
+    if (isdigit(c)) {
+      pending = NUMBER;
+      lexeme[lexlen++] = c;
+      continue;
+    }
+    switch (c) {
+      case '<': case '>': case '=': case '!': case '/':
+        pending = OPERATOR;
+        lexeme[0] = c;
+        break;
+      case '\n': line++; break;
+      case ' ': case '\t': break;
+      case '+': token(PLUS); break;
+      case '-': token(MINUS); break;
+      case '*': token(MUL); break;
+      case ';': token(SEMI); break;
+      case ',': token(COMMA); break;
+      case '(': token(SOPEN); break;
+      case ')': token(SCLOSE); break;
+      case '{': token(MOPEN); break;
+      case '}': token(MCLOSE); break;
+      case '[': token(BOPEN); break;
+      case ']': token(BCLOSE); break;
+      default: token(ERROR); break;
+    }
+  }
+  return parsing;
+}
+
+TreeNode * pushEnd(void)
+{ scanEnd();
+  return parseEnd();
+}
+
+TreeNode * pushParse(int fd, void (* decl)(TreeNode *))
+{ static char buf[PUSHCHUNK];
+  int n;
+  pushBegin(decl);
+  while ((n = read(fd,buf,sizeof(buf))) > 0)
+    if (! pushChunk(buf,n)) break;
+  return pushEnd();
+}
+
+/* the source of the scanner thread */
+static int scanFd;
+
+static void * scanner(void * arg)
+{ static char buf[PUSHCHUNK];
+  int n;
+  (void) arg;
+  while ((n = read(scanFd,buf,sizeof(buf))) > 0)
+    if (! pushChunk(buf,n)) break;
+  scanEnd();
+  return NULL;
+}
+
+TreeNode * pipeParse(int fd, void (* decl)(TreeNode *))
+{ pthread_t thread;
+  char text[STRINGSIZE];
+  TokenRec r;
+  parseBegin(decl);
+  ring_start();
+  scanBegin(ringSend);
+  scanFd = fd;
+  if (pthread_create(&thread,NULL,scanner,NULL) != 0)
+    return pushParse(fd,decl);
+  do {
+    r = ring_get(text);
+    lineno = r.line;
+    if (r.text >= 0) st_push(text);
+  } while (parseToken(r.token) && r.token != 0);
+  ring_stop();
+  pthread_join(thread,NULL);
+  return parseEnd();
+}
@@ -0,0 +1,42 @@
+/****************************************************/
+/* File: push.h                                     */
+/* Chunk scanner for the C- compiler: source text   */
+/* is handed over in pieces as it is produced, and  */
+/* each token goes to the parser as soon as it is   */
+/* complete                                         */
+/****************************************************/
+
+#ifndef _PUSH_H_
+#define _PUSH_H_
+
+/* Procedure pushBegin starts a program; decl is
+ * called on each top-level declaration as soon as
+ * it is parsed, as by parseDecls
+ */
+void pushBegin(void (* decl)(TreeNode *));
+
+/* Function pushChunk scans the len bytes of buf,
+ * which may end in the middle of a token or comment.
+ * It returns FALSE once a syntax error has ended
+ * the parse, when the rest need not be sent
+ */
+int pushChunk(const char * buf, int len);
+
+/* Function pushEnd ends the source and returns the
+ * syntax tree, as parse does
+ */
+TreeNode * pushEnd(void);
+
+/* Function pushParse parses the source read from fd
+ * in chunks of whatever has arrived, so that a pipe
+ * is parsed while it is being written
+ */
+TreeNode * pushParse(int fd, void (* decl)(TreeNode *));
+
+/* Function pipeParse is pushParse with the reading
+ * and scanning on a thread of its own, which hands
+ * the tokens to the parser through the token ring
+ */
+TreeNode * pipeParse(int fd, void (* decl)(TreeNode *));
+
+#endif
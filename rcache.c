@@ -0,0 +1,454 @@
+/****************************************************/
+/* File: rcache.c                                   */
+/* Result cache for the C- compiler. An entry is    */
+/* one file named by the 128-bit FNV-1a hash of the */
+/* compiler, the options, the source name and its   */
+/* text; it holds the listing and the files the     */
+/* compilation wrote. Entries are written to a      */
+/* temporary file and renamed into place, so a      */
+/* process never reads one half written. Their      */
+/* modification times order them for eviction: a    */
+/* hit touches its entry. The counters in the file  */
+/* stats are updated under a lock on it             */
+/****************************************************/
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <utime.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "globals.h"
+#include "rcache.h"
+
+#define RCACHEHEADER "# C- result cache 1"
+
+/* a temporary file older than this many seconds was
+ * left by a process that died
+ */
+#define STALE 3600
+
+typedef unsigned __int128 Hash;
+
+#define FNVBASIS (((Hash) 0x6c62272e07bb0142UL << 64) | 0x62b821756295c58dUL)
+#define FNVPRIME (((Hash) 1 << 88) | 0x13b)
+
+static Hash hashBytes(Hash h, const char * s, long n)
+{ while (n-- > 0) h = (h ^ (unsigned char) *s++) * FNVPRIME;
+  return h;
+}
+
+static Hash hashLong(Hash h, long v)
+{ return hashBytes(h,(char *) &v,sizeof(v)); }
+
+/* the files a compilation may write, by suffix */
+static struct { char * suffix; int * flag; } outputs[] =
+  { { ".s", &EmitCode }, { ".gen.c", &EmitC }, { ".ast", &WriteAst },
+    { ".cmi", &WriteUnit }, { NULL, NULL } };
+
+typedef struct
+{ long hits, misses, uncacheable;
+  long entries, bytes;
+} Stats;
+
+static char dirName[1024];
+static char entryName[1100];
+static char keyText[33];
+static char * pgmName;        /* the source */
+static long maxBytes;
+
+/* the listing is caught in catchFile while the
+ * real standard output waits in savedOut */
+static int catching = FALSE;
+static FILE * catchFile;
+static int savedOut;
+
+/* Procedure setDir names the cache directory dir,
+ * or ~/.cmcache if dir is empty
+ */
+static void setDir(char * dir)
+{ if (*dir != '\0') strncpy(dirName,dir,sizeof(dirName) - 1);
+  else sprintf(dirName,"%.1000s/.cmcache",getenv("HOME") ? getenv("HOME") : ".");
+}
+
+/* Function outName returns the name of the file
+ * with suffix written for the source pgm
+ */
+static char * outName(char * pgm, char * suffix)
+{ int fnlen = strrchr(pgm,'.') - pgm;
+  char * name = (char *) calloc(fnlen + strlen(suffix) + 1, sizeof(char));
+  strncpy(name,pgm,fnlen);
+  strcat(name,suffix);
+  return name;
+}
+
+/* Function readAll reads the whole file name into a
+ * buffer, setting *len; it returns NULL if it cannot
+ */
+static char * readAll(char * name, long * len)
+{ FILE * f = fopen(name,"rb");
+  struct stat st;
+  char * buf;
+  if (f == NULL) return NULL;
+  if (fstat(fileno(f),&st) != 0 || !S_ISREG(st.st_mode)) {
+    fclose(f);
+    return NULL;
+  }
+  buf = (char *) malloc(st.st_size + 1);
+  *len = fread(buf,1,st.st_size,f);
+  fclose(f);
+  if (*len != st.st_size) {
+    free(buf);
+    return NULL;
+  }
+  buf[*len] = '\0';
+  return buf;
+}
+
+/* Function lockStats locks the counters of the
+ * cache and reads them into s; it returns the file
+ * to give to unlockStats, or -1
+ */
+static int lockStats(Stats * s)
+{ char name[1100];
+  char buf[256];
+  int fd, n;
+  sprintf(name,"%s/stats",dirName);
+  memset(s,0,sizeof(Stats));
+  fd = open(name,O_RDWR | O_CREAT,0666);
+  if (fd < 0) return -1;
+  if (flock(fd,LOCK_EX) != 0) {
+    close(fd);
+    return -1;
+  }
+  n = pread(fd,buf,sizeof(buf) - 1,0);
+  if (n > 0) {
+    buf[n] = '\0';
+    sscanf(buf,"hits %ld\nmisses %ld\nuncacheable %ld\nentries %ld\nbytes %ld",
+           &s->hits,&s->misses,&s->uncacheable,&s->entries,&s->bytes);
+  }
+  return fd;
+}
+
+static void unlockStats(int fd, Stats * s)
+{ char buf[256];
+  int n;
+  if (fd < 0) return;
+  n = sprintf(buf,"hits %ld\nmisses %ld\nuncacheable %ld\nentries %ld\nbytes %ld\n",
+              s->hits,s->misses,s->uncacheable,s->entries,s->bytes);
+  if (ftruncate(fd,0) == 0) pwrite(fd,buf,n,0);
+  close(fd);  /* and unlock */
+}
+
+/* a file of the cache, for eviction */
+typedef struct
+{ char * name;
+  time_t used;
+  long size;
+} Victim;
+
+static int byUse(const void * a, const void * b)
+{ time_t x = ((Victim *) a)->used, y = ((Victim *) b)->used;
+  return x < y ? -1 : x > y;
+}
+
+/* Procedure evict counts the entries of the cache
+ * again and removes those used least recently until
+ * their size is down to RCACHEKEEP percent of the
+ * bound; the stats are locked
+ */
+static void evict(Stats * s)
+{ DIR * top;
+  DIR * sub;
+  struct dirent * d;
+  struct dirent * e;
+  struct stat st;
+  Victim * v = NULL;
+  int n = 0, max = 0, k;
+  char name[2200];
+  time_t now = time(NULL);
+  top = opendir(dirName);
+  if (top == NULL) return;
+  s->entries = s->bytes = 0;
+  while ((d = readdir(top)) != NULL) {
+    if (strlen(d->d_name) != 2 || !isxdigit((unsigned char) d->d_name[0])) continue;
+    sprintf(name,"%s/%s",dirName,d->d_name);
+    if ((sub = opendir(name)) == NULL) continue;
+    while ((e = readdir(sub)) != NULL) {
+      if (e->d_name[0] == '.') continue;
+      sprintf(name,"%s/%s/%s",dirName,d->d_name,e->d_name);
+      if (stat(name,&st) != 0 || !S_ISREG(st.st_mode)) continue;
+      if (strchr(e->d_name,'.') != NULL) {
+        /* a temporary file */
+        if (now - st.st_mtime > STALE) unlink(name);
+        continue;
+      }
+      if (n == max) {
+        max = max ? 2 * max : 256;
+        v = (Victim *) realloc(v, sizeof(Victim) * max);
+      }
+      v[n].name = strdup(name);
+      v[n].used = st.st_mtime;
+      v[n].size = st.st_size;
+      s->entries++;
+      s->bytes += st.st_size;
+      n++;
+    }
+    closedir(sub);
+  }
+  closedir(top);
+  qsort(v,n,sizeof(Victim),byUse);
+  for (k = 0; k < n; k++) {
+    if (s->bytes <= maxBytes / 100 * RCACHEKEEP) break;
+    if (unlink(v[k].name) == 0) {
+      s->entries--;
+      s->bytes -= v[k].size;
+    }
+  }
+  for (k = 0; k < n; k++) free(v[k].name);
+  free(v);
+}
+
+/* Function nextLine copies the line at *p, before
+ * end, to buf (size bytes) without its newline and
+ * moves *p past it; it returns FALSE if there is no
+ * such line
+ */
+static int nextLine(char ** p, char * end, char * buf, int size)
+{ char * nl = memchr(*p,'\n',end - *p);
+  if (nl == NULL || nl - *p >= size) return FALSE;
+  memcpy(buf,*p,nl - *p);
+  buf[nl - *p] = '\0';
+  *p = nl + 1;
+  return TRUE;
+}
+
+/* Function hit gives back the compilation in the
+ * entry text (len bytes); it returns FALSE, having
+ * given back nothing, if the entry is not whole
+ */
+static int hit(char * text, long len)
+{ char * p = text;
+  char * end = text + len;
+  char line[80];
+  char suffix[16];
+  char * listText;
+  long listLen, n;
+  char * files[8];
+  char * fileText[8];
+  long fileLen[8];
+  int nfiles = 0, k;
+  FILE * f;
+  if (!nextLine(&p,end,line,sizeof(line)) || strcmp(line,RCACHEHEADER) != 0 ||
+      !nextLine(&p,end,line,sizeof(line)) || strncmp(line,"key ",4) != 0 ||
+      strcmp(line + 4,keyText) != 0 ||
+      !nextLine(&p,end,line,sizeof(line)) || sscanf(line,"listing %ld",&listLen) != 1 ||
+      listLen < 0 || listLen > end - p)
+    return FALSE;
+  listText = p;
+  p += listLen;
+  for (;;) {
+    if (!nextLine(&p,end,line,sizeof(line))) return FALSE;
+    if (strcmp(line,"end") == 0) break;
+    if (nfiles == 8 || sscanf(line,"file %15s %ld",suffix,&n) != 2 || n < 0 || n > end - p)
+      return FALSE;
+    for (k = 0; outputs[k].suffix != NULL && strcmp(outputs[k].suffix,suffix) != 0; k++)
+      ;
+    if (outputs[k].suffix == NULL) return FALSE;
+    files[nfiles] = outputs[k].suffix;
+    fileText[nfiles] = p;
+    fileLen[nfiles++] = n;
+    p += n;
+  }
+  if (p != end) return FALSE;
+  fwrite(listText,1,listLen,stdout);
+  for (k = 0; k < nfiles; k++) {
+    char * name = outName(pgmName,files[k]);
+    f = fopen(name,"w");
+    if (f == NULL) printf("Unable to open %s\n",name);
+    else {
+      fwrite(fileText[k],1,fileLen[k],f);
+      fclose(f);
+    }
+    free(name);
+  }
+  return TRUE;
+}
+
+/* Procedure release prints the listing caught if the
+ * compilation ends before it is stored
+ */
+static void release(void)
+{ char buf[BUFSIZ];
+  int n;
+  if (!catching) return;
+  catching = FALSE;
+  fflush(stdout);
+  dup2(savedOut,1);
+  close(savedOut);
+  rewind(catchFile);
+  while ((n = fread(buf,1,sizeof(buf),catchFile)) > 0) fwrite(buf,1,n,stdout);
+  fclose(catchFile);
+  fflush(stdout);
+}
+
+int rcacheOpen(char * dir, int maxmb, char * pgm, char ** opts, int nopts)
+{ Hash h = FNVBASIS;
+  Stats s;
+  struct stat st;
+  char * text;
+  char * counts = NULL;
+  long len;
+  int k, fd;
+  setDir(dir);
+  mkdir(dirName,0777);
+  maxBytes = (long) maxmb * 1024 * 1024;
+  pgmName = pgm;
+  /* what the program does when it runs is not known */
+  if (Execute || Incremental || (text = readAll(pgm,&len)) == NULL) {
+    fd = lockStats(&s);
+    s.uncacheable++;
+    unlockStats(fd,&s);
+    return FALSE;
+  }
+  h = hashBytes(h,RCACHEHEADER,strlen(RCACHEHEADER));
+  if (stat("/proc/self/exe",&st) == 0)
+    h = hashLong(hashLong(h,st.st_size),st.st_mtime);
+  for (k = 0; k < nopts; k++) {
+    if (strncmp(opts[k],"-k",2) == 0 || strncmp(opts[k],"-M",2) == 0) continue;
+    h = hashBytes(h,opts[k],strlen(opts[k]) + 1);
+    if (strncmp(opts[k],"-R",2) == 0 && opts[k][2]) counts = opts[k] + 2;
+  }
+  h = hashBytes(h,pgm,strlen(pgm) + 1);
+  h = hashBytes(hashLong(h,len),text,len);
+  free(text);
+  if (ProfileUse) {
+    /* the counts are part of the input */
+    counts = counts != NULL ? strdup(counts) : outName(pgm,".counts");
+    text = readAll(counts,&len);
+    free(counts);
+    if (text == NULL) {
+      fd = lockStats(&s);
+      s.uncacheable++;
+      unlockStats(fd,&s);
+      return FALSE;
+    }
+    h = hashBytes(hashLong(h,len),text,len);
+    free(text);
+  }
+  /* and so are the interfaces imported */
+  for (k = 0; k < nopts; k++) {
+    if (strncmp(opts[k],"-h",2) != 0 || !opts[k][2]) continue;
+    if ((text = readAll(opts[k] + 2,&len)) == NULL) {
+      fd = lockStats(&s);
+      s.uncacheable++;
+      unlockStats(fd,&s);
+      return FALSE;
+    }
+    h = hashBytes(hashLong(h,len),text,len);
+    free(text);
+  }
+  sprintf(keyText,"%016lx%016lx",(unsigned long) (h >> 64),(unsigned long) h);
+  sprintf(entryName,"%s/%.2s",dirName,keyText);
+  mkdir(entryName,0777);
+  sprintf(entryName,"%s/%.2s/%s",dirName,keyText,keyText + 2);
+  text = readAll(entryName,&len);
+  if (text != NULL && hit(text,len)) {
+    free(text);
+    utime(entryName,NULL);
+    fd = lockStats(&s);
+    s.hits++;
+    unlockStats(fd,&s);
+    return TRUE;
+  }
+  free(text);
+  fd = lockStats(&s);
+  s.misses++;
+  unlockStats(fd,&s);
+  /* catch the listing */
+  catchFile = tmpfile();
+  if (catchFile == NULL) return FALSE;
+  fflush(stdout);
+  savedOut = dup(1);
+  dup2(fileno(catchFile),1);
+  catching = TRUE;
+  atexit(release);
+  return FALSE;
+}
+
+void rcacheStore(void)
+{ char tmp[1200];
+  char * name;
+  char * text;
+  char buf[BUFSIZ];
+  long len, listLen, size = 0;
+  struct stat st;
+  Stats s;
+  FILE * out;
+  int k, n, fd, ok;
+  if (!catching) return;
+  fflush(stdout);
+  listLen = ftell(catchFile);
+  sprintf(tmp,"%s.%d.tmp",entryName,(int) getpid());
+  out = fopen(tmp,"w");
+  ok = out != NULL;
+  if (ok) {
+    fprintf(out,"%s\nkey %s\nlisting %ld\n",RCACHEHEADER,keyText,listLen);
+    rewind(catchFile);
+    while ((n = fread(buf,1,sizeof(buf),catchFile)) > 0) fwrite(buf,1,n,out);
+    /* the files are written only by a compilation
+     * without errors */
+    for (k = 0; outputs[k].suffix != NULL && ok; k++) {
+      if (!*outputs[k].flag || Error) continue;
+      name = outName(pgmName,outputs[k].suffix);
+      text = readAll(name,&len);
+      free(name);
+      if (text == NULL) ok = FALSE;
+      else {
+        fprintf(out,"file %s %ld\n",outputs[k].suffix,len);
+        fwrite(text,1,len,out);
+        free(text);
+      }
+    }
+    fprintf(out,"end\n");
+    size = ftell(out);
+    ok = fclose(out) == 0 && ok;
+  }
+  release();
+  if (!ok) {
+    remove(tmp);
+    return;
+  }
+  fd = lockStats(&s);
+  if (stat(entryName,&st) == 0) s.bytes -= st.st_size;
+  else s.entries++;
+  if (rename(tmp,entryName) != 0) {
+    remove(tmp);
+    unlockStats(fd,&s);
+    return;
+  }
+  s.bytes += size;
+  if (s.bytes > maxBytes) evict(&s);
+  unlockStats(fd,&s);
+}
+
+void rcacheReport(char * dir, FILE * out)
+{ Stats s;
+  int fd;
+  long looked;
+  setDir(dir);
+  fd = lockStats(&s);
+  if (fd < 0) {
+    fprintf(out,"No result cache %s\n",dirName);
+    return;
+  }
+  unlockStats(fd,&s);
+  looked = s.hits + s.misses;
+  fprintf(out,"Result cache %s\n",dirName);
+  fprintf(out,"  hits         %ld (%ld%%)\n",s.hits,looked ? 100 * s.hits / looked : 0);
+  fprintf(out,"  misses       %ld\n",s.misses);
+  fprintf(out,"  uncacheable  %ld\n",s.uncacheable);
+  fprintf(out,"  entries      %ld\n",s.entries);
+  fprintf(out,"  size         %ld KB\n",(s.bytes + 1023) / 1024);
+}
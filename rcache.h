@@ -0,0 +1,43 @@
+/****************************************************/
+/* File: rcache.h                                   */
+/* Result cache interface for the C- compiler: the  */
+/* listing and files of a compilation are kept in a */
+/* directory under a hash of the source and the     */
+/* options, and given back when they come again     */
+/****************************************************/
+
+#ifndef _RCACHE_H_
+#define _RCACHE_H_
+
+/* RCACHEMAX is the default bound, in megabytes, on
+ * the size of the cache; past it the entries used
+ * least recently are removed until it is down to
+ * RCACHEKEEP percent of the bound
+ */
+#define RCACHEMAX 64
+#define RCACHEKEEP 90
+
+/* Function rcacheOpen looks up the compilation of the
+ * source file pgm with the options opts (nopts of
+ * them) in the cache directory dir, which is made if
+ * need be. On a hit the listing is printed, the files
+ * are written, and TRUE is returned. On a miss the
+ * listing is caught from then on for rcacheStore, and
+ * FALSE is returned; so it is when the compilation
+ * cannot be cached, when it runs the program
+ */
+int rcacheOpen(char * dir, int maxmb, char * pgm, char ** opts, int nopts);
+
+/* Procedure rcacheStore puts the listing caught since
+ * rcacheOpen and the files written into the cache,
+ * printing the listing. A compilation that exits
+ * before it is stored prints its listing all the same
+ */
+void rcacheStore(void);
+
+/* Procedure rcacheReport prints the hits, misses and
+ * size of the cache in dir
+ */
+void rcacheReport(char * dir, FILE * out);
+
+#endif
@@ -0,0 +1,324 @@
+/****************************************************/
+/* File: regalloc.c                                 */
+/* Linear-scan register allocation for the C-       */
+/* compiler (Poletto and Sarkar); live intervals    */
+/* come from block level liveness                   */
+/****************************************************/
+
+#include "globals.h"
+#include "pgo.h"
+#include "regalloc.h"
+
+/* caller-saved registers come first so values not
+ * live across calls need no save and restore
+ */
+char * regName64[NREGS] =
+{ "%rcx", "%rsi", "%rdi", "%r8", "%r9", "%r10",
+  "%rbx", "%r12", "%r13", "%r14", "%r15" };
+char * regName32[NREGS] =
+{ "%ecx", "%esi", "%edi", "%r8d", "%r9d", "%r10d",
+  "%ebx", "%r12d", "%r13d", "%r14d", "%r15d" };
+int regCallee[NREGS] =
+{ FALSE, FALSE, FALSE, FALSE, FALSE, FALSE,
+  TRUE, TRUE, TRUE, TRUE, TRUE };
+
+/* MAXWEIGHTDEPTH caps the loop depth used in spill
+ * weights, which grow eightfold per level
+ */
+#define MAXWEIGHTDEPTH 6
+
+typedef struct
+{ int vreg;
+  int start, end;
+  long weight;      /* from the profile when it has one */
+  long loopWeight;  /* from loop depths only */
+  int crossesCall;
+  int lineno;       /* of the first instruction using it */
+} Interval;
+
+/* statistics line of one function */
+typedef struct StatRec
+{ char * name;
+  int values, spilled, callee;
+  struct StatRec * next;
+} * Stat;
+
+static Stat stats = NULL;
+static Stat * lastStat = &stats;
+
+/* bit sets over vregs */
+#define WORDBITS 32
+#define SETWORDS(n) (((n) + WORDBITS - 1) / WORDBITS)
+#define INSET(s,i) ((s)[(i) / WORDBITS] >> ((i) % WORDBITS) & 1)
+#define ADDSET(s,i) ((s)[(i) / WORDBITS] |= 1u << ((i) % WORDBITS))
+#define DELSET(s,i) ((s)[(i) / WORDBITS] &= ~(1u << ((i) % WORDBITS)))
+
+typedef struct
+{ int first, last;     /* instruction range */
+  int succ[2], nsucc;
+  unsigned * use, * def, * in, * out;
+} Block;
+
+static int isJump(IrInstr * i)
+{ return i->op == I_JMP || i->op == I_BR || i->op == I_RET; }
+
+/* Function buildBlocks splits f into basic blocks
+ * and links them; it returns their number
+ */
+static int buildBlocks(IrFunc f, Block ** blocksp)
+{ Block * b;
+  int * blockOfLabel;
+  int maxlabel = 0;
+  int n = 0, k, j;
+  for (k = 0; k < f->ncode; k++)
+    if (f->code[k].label > maxlabel) maxlabel = f->code[k].label;
+  blockOfLabel = (int *) malloc(sizeof(int) * (maxlabel + 1));
+  b = (Block *) calloc(f->ncode + 1, sizeof(Block));
+  for (k = 0; k < f->ncode; k++) {
+    if (k == 0 || f->code[k].op == I_LABEL || isJump(&f->code[k-1])) {
+      if (k > 0) b[n-1].last = k - 1;
+      b[n++].first = k;
+    }
+    if (f->code[k].op == I_LABEL) blockOfLabel[f->code[k].label] = n - 1;
+  }
+  if (n > 0) b[n-1].last = f->ncode - 1;
+  for (j = 0; j < n; j++) {
+    IrInstr * i = &f->code[b[j].last];
+    if (i->op == I_JMP) b[j].succ[b[j].nsucc++] = blockOfLabel[i->label];
+    else if (i->op != I_RET) {
+      if (i->op == I_BR) b[j].succ[b[j].nsucc++] = blockOfLabel[i->label];
+      if (j + 1 < n) b[j].succ[b[j].nsucc++] = j + 1;
+    }
+  }
+  free(blockOfLabel);
+  *blocksp = b;
+  return n;
+}
+
+/* Procedure liveness computes the live-in and
+ * live-out sets of every block
+ */
+static void liveness(IrFunc f, Block * b, int n)
+{ int words = SETWORDS(f->nvregs) + 1;
+  int regs[64 + 3];
+  int changed = TRUE;
+  int j, k, u, nu, d, s, w;
+  unsigned x;
+  for (j = 0; j < n; j++) {
+    b[j].use = (unsigned *) calloc(words, sizeof(unsigned));
+    b[j].def = (unsigned *) calloc(words, sizeof(unsigned));
+    b[j].in = (unsigned *) calloc(words, sizeof(unsigned));
+    b[j].out = (unsigned *) calloc(words, sizeof(unsigned));
+    for (k = b[j].first; k <= b[j].last; k++) {
+      IrInstr * i = &f->code[k];
+      int * r = i->nargs + 3 <= 67 ? regs : (int *) malloc(sizeof(int) * (i->nargs + 3));
+      nu = irUses(i,r);
+      for (u = 0; u < nu; u++)
+        if (!INSET(b[j].def,r[u])) ADDSET(b[j].use,r[u]);
+      if ((d = irDef(i)) >= 0) ADDSET(b[j].def,d);
+      if (r != regs) free(r);
+    }
+  }
+  while (changed) {
+    changed = FALSE;
+    for (j = n - 1; j >= 0; j--) {
+      for (w = 0; w < words; w++) {
+        x = 0;
+        for (s = 0; s < b[j].nsucc; s++) x |= b[b[j].succ[s]].in[w];
+        b[j].out[w] = x;
+        x = b[j].use[w] | (x & ~b[j].def[w]);
+        if (x != b[j].in[w]) {
+          b[j].in[w] = x;
+          changed = TRUE;
+        }
+      }
+    }
+  }
+}
+
+static void extend(Interval * iv, int pos)
+{ if (iv->start < 0 || pos < iv->start) iv->start = pos;
+  if (pos > iv->end) iv->end = pos;
+}
+
+static long depthWeight(int depth)
+{ return 1L << (3 * (depth < MAXWEIGHTDEPTH ? depth : MAXWEIGHTDEPTH)); }
+
+/* Procedure addUse weighs an access of interval iv
+ * by instruction i: by its count in the profile if
+ * known, else by its loop depth
+ */
+static void addUse(Interval * iv, IrInstr * i)
+{ iv->loopWeight += depthWeight(i->depth);
+  iv->weight += i->freq >= 0 ? i->freq + 1 : depthWeight(i->depth);
+  if (iv->lineno == 0) iv->lineno = i->lineno;
+}
+
+/* Procedure buildIntervals gives each vreg the
+ * range from its first to its last live point;
+ * instruction k is at point k+1, point 0 is entry
+ */
+static void buildIntervals(IrFunc f, Block * b, int n, Interval * iv)
+{ int regs[64 + 3];
+  int j, k, u, nu, d, v;
+  for (v = 0; v < f->nvregs; v++) {
+    iv[v].vreg = v;
+    iv[v].start = -1;
+    iv[v].end = -1;
+    iv[v].weight = iv[v].loopWeight = 0;
+    iv[v].crossesCall = FALSE;
+    iv[v].lineno = 0;
+  }
+  /* parameters arrive at entry */
+  for (v = 0; v < f->nparams; v++) extend(&iv[f->params[v]],0);
+  for (j = 0; j < n; j++) {
+    for (v = 0; v < f->nvregs; v++) {
+      if (INSET(b[j].in,v)) extend(&iv[v],b[j].first + 1);
+      if (INSET(b[j].out,v)) extend(&iv[v],b[j].last + 1);
+    }
+    for (k = b[j].first; k <= b[j].last; k++) {
+      IrInstr * i = &f->code[k];
+      int * r = i->nargs + 3 <= 67 ? regs : (int *) malloc(sizeof(int) * (i->nargs + 3));
+      nu = irUses(i,r);
+      for (u = 0; u < nu; u++) {
+        extend(&iv[r[u]],k + 1);
+        addUse(&iv[r[u]],i);
+      }
+      if ((d = irDef(i)) >= 0) {
+        extend(&iv[d],k + 1);
+        addUse(&iv[d],i);
+      }
+      if (r != regs) free(r);
+    }
+  }
+  for (k = 0; k < f->ncode; k++)
+    if (f->code[k].op == I_CALL)
+      for (v = 0; v < f->nvregs; v++)
+        if (iv[v].start >= 0 && iv[v].start < k + 1 && iv[v].end > k + 1)
+          iv[v].crossesCall = TRUE;
+}
+
+static int byStart(const void * x, const void * y)
+{ const Interval * a = (const Interval *) x;
+  const Interval * b = (const Interval *) y;
+  if (a->start != b->start) return a->start - b->start;
+  return a->vreg - b->vreg;
+}
+
+/* Procedure linearScan assigns the intervals iv of
+ * the nv vregs, sorted by start, to registers and
+ * spill slots
+ */
+static void linearScan(Interval * iv, int nv, RegAssign * ra)
+{ Interval * active[NREGS];  /* interval holding each register */
+  int k, r, victim, best;
+  ra->nspills = 0;
+  ra->calleeUsed = 0;
+  ra->nintervals = 0;
+  for (r = 0; r < NREGS; r++) active[r] = NULL;
+  for (k = 0; k < nv; k++) {
+    Interval * cur = &iv[k];
+    ra->loc[cur->vreg] = LOC_NONE;
+    if (cur->start < 0) continue;
+    ra->nintervals++;
+    /* expire intervals ending before this one */
+    for (r = 0; r < NREGS; r++)
+      if (active[r] != NULL && active[r]->end < cur->start) active[r] = NULL;
+    /* a free register, caller-saved preferred */
+    best = -1;
+    for (r = 0; r < NREGS && best < 0; r++)
+      if (active[r] == NULL && (regCallee[r] || !cur->crossesCall)) best = r;
+    if (best < 0) {
+      /* spill the cheapest of the candidates; on
+       * equal weight the one ending last */
+      victim = -1;
+      for (r = 0; r < NREGS; r++) {
+        if (active[r] == NULL || (!regCallee[r] && cur->crossesCall)) continue;
+        if (victim < 0 || active[r]->weight < active[victim]->weight ||
+            (active[r]->weight == active[victim]->weight &&
+             active[r]->end > active[victim]->end))
+          victim = r;
+      }
+      if (victim >= 0 && (active[victim]->weight < cur->weight ||
+                          (active[victim]->weight == cur->weight &&
+                           active[victim]->end > cur->end))) {
+        ra->loc[active[victim]->vreg] = -(++ra->nspills);
+        best = victim;
+      }
+      else {
+        ra->loc[cur->vreg] = -(++ra->nspills);
+        continue;
+      }
+    }
+    active[best] = cur;
+    ra->loc[cur->vreg] = best;
+    if (regCallee[best]) ra->calleeUsed |= 1 << best;
+  }
+}
+
+/* Procedure compareSpills notes the values that the
+ * weights of the profile kept in a register or
+ * spilled, against the weights of loop depths
+ */
+static void compareSpills(IrFunc f, Interval * iv, RegAssign * ra)
+{ RegAssign plain;
+  int k, v, was, now;
+  plain.loc = (int *) malloc(sizeof(int) * (f->nvregs + 1));
+  for (k = 0; k < f->nvregs; k++) iv[k].weight = iv[k].loopWeight;
+  linearScan(iv,f->nvregs,&plain);
+  for (k = 0; k < f->nvregs; k++) {
+    v = iv[k].vreg;
+    if (ra->loc[v] == LOC_NONE) continue;
+    was = plain.loc[v] < 0;
+    now = ra->loc[v] < 0;
+    if (was != now)
+      pgoNote(f->fun,iv[k].lineno,"value v%d %s",v,now ? "spilled" : "kept in a register");
+  }
+  free(plain.loc);
+}
+
+void allocRegisters(IrFunc f, RegAssign * ra)
+{ Block * b;
+  Interval * iv;
+  int n, k, r, profiled = FALSE;
+  Stat st;
+
+  ra->loc = (int *) malloc(sizeof(int) * (f->nvregs + 1));
+  n = buildBlocks(f,&b);
+  liveness(f,b,n);
+  iv = (Interval *) malloc(sizeof(Interval) * (f->nvregs + 1));
+  buildIntervals(f,b,n,iv);
+  for (k = 0; k < n; k++) {
+    free(b[k].use); free(b[k].def); free(b[k].in); free(b[k].out);
+  }
+  free(b);
+  qsort(iv,f->nvregs,sizeof(Interval),byStart);
+  linearScan(iv,f->nvregs,ra);
+  for (k = 0; k < f->ncode; k++)
+    if (f->code[k].freq >= 0) profiled = TRUE;
+  if (profiled) compareSpills(f,iv,ra);
+  free(iv);
+  st = (Stat) malloc(sizeof(struct StatRec));
+  st->name = f->fun->attr.name;
+  st->values = ra->nintervals;
+  st->spilled = ra->nspills;
+  st->callee = 0;
+  for (r = 0; r < NREGS; r++)
+    if (ra->calleeUsed & (1 << r)) st->callee++;
+  st->next = NULL;
+  *lastStat = st;
+  lastStat = &st->next;
+}
+
+void regallocReport(FILE * out)
+{ Stat st, next;
+  fprintf(out,"\nFunction        Values   Spilled  Callee-saved\n");
+  fprintf(out,"--------------  -------- -------- ------------\n");
+  for (st = stats; st != NULL; st = next) {
+    next = st->next;
+    fprintf(out,"%-14s  %-8d %-8d %d\n",st->name,st->values,st->spilled,st->callee);
+    free(st);
+  }
+  stats = NULL;
+  lastStat = &stats;
+}
@@ -0,0 +1,48 @@
+/****************************************************/
+/* File: regalloc.h                                 */
+/* Linear-scan register allocator interface for     */
+/* the C- compiler's native backend                 */
+/****************************************************/
+
+#ifndef _REGALLOC_H_
+#define _REGALLOC_H_
+
+#include "ir.h"
+
+/* NREGS is the number of allocatable registers;
+ * %rax, %rdx and %r11 are kept as scratch
+ */
+#define NREGS 11
+
+/* register names, 64 and 32 bit */
+extern char * regName64[NREGS];
+extern char * regName32[NREGS];
+
+/* regCallee[r] is TRUE for callee-saved registers */
+extern int regCallee[NREGS];
+
+/* LOC_NONE is the location of a vreg never used */
+#define LOC_NONE (-1000000)
+
+/* the result of allocating one function */
+typedef struct
+{ int * loc;        /* per vreg: register, -slot if spilled, or LOC_NONE */
+  int nspills;      /* spill slots used */
+  int calleeUsed;   /* bit r set if callee-saved r is used */
+  int nintervals;   /* vregs with a live interval */
+} RegAssign;
+
+/* Procedure allocRegisters assigns a register or a
+ * spill slot to every vreg of f; values live across
+ * a call only get callee-saved registers and spill
+ * choice is by use count weighted by loop depth, or
+ * by the counts of the profile when there is one
+ */
+void allocRegisters(IrFunc f, RegAssign * ra);
+
+/* Procedure regallocReport prints the statistics
+ * gathered over all allocated functions
+ */
+void regallocReport(FILE * out);
+
+#endif
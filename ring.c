@@ -0,0 +1,85 @@
+/****************************************************/
+/* File: ring.c                                     */
+/* Token ring for the C- compiler. The writer owns  */
+/* head and textHead, the reader tail and textTail; */
+/* each publishes its own with a release store and  */
+/* reads the other's with an acquire load, so no    */
+/* lock is taken. A side that must wait yields      */
+/****************************************************/
+
+#include <sched.h>
+#include "globals.h"
+#include "ring.h"
+
+#define PUT(x,v) __atomic_store_n(&(x),(v),__ATOMIC_RELEASE)
+#define GET(x) __atomic_load_n(&(x),__ATOMIC_ACQUIRE)
+
+static TokenRec tokens[RINGSIZE];
+static char texts[RINGTEXT];
+
+/* the counters only grow; each side's are on a cache
+ * line of their own
+ */
+#define CACHELINE __attribute__ ((aligned (64)))
+
+static struct
+{ unsigned head, textHead;
+  unsigned tail, textTail;  /* last seen by the writer */
+} writer CACHELINE;
+
+static struct
+{ unsigned tail, textTail;
+  int stopped;
+} reader CACHELINE;
+
+void ring_start(void)
+{ writer.head = writer.textHead = 0;
+  writer.tail = writer.textTail = 0;
+  reader.tail = reader.textTail = 0;
+  reader.stopped = FALSE;
+}
+
+int ring_put(TokenType token, char * text, int line)
+{ TokenRec * r;
+  int len = text == NULL ? 0 : strlen(text) + 1;
+  int i;
+  if (len > STRINGSIZE) len = STRINGSIZE;
+  while (writer.head - writer.tail == RINGSIZE ||
+         writer.textHead + len - writer.textTail > RINGTEXT) {
+    if (GET(reader.stopped)) return FALSE;
+    sched_yield();
+    writer.tail = GET(reader.tail);
+    writer.textTail = GET(reader.textTail);
+  }
+  r = &tokens[writer.head % RINGSIZE];
+  r->token = token;
+  r->line = line;
+  r->text = -1;
+  if (len > 0) {
+    r->text = writer.textHead % RINGTEXT;
+    for (i = 0; i < len - 1; i++)
+      texts[(writer.textHead + i) % RINGTEXT] = text[i];
+    texts[(writer.textHead + i) % RINGTEXT] = '\0';
+    writer.textHead += len;
+  }
+  PUT(writer.head,writer.head + 1);
+  return TRUE;
+}
+
+TokenRec ring_get(char * text)
+{ TokenRec r;
+  int i = 0;
+  while (GET(writer.head) == reader.tail)
+    sched_yield();
+  r = tokens[reader.tail % RINGSIZE];
+  if (r.text >= 0) {
+    while ((text[i] = texts[(r.text + i) % RINGTEXT]) != '\0') i++;
+    PUT(reader.textTail,reader.textTail + i + 1);
+  }
+  PUT(reader.tail,reader.tail + 1);
+  return r;
+}
+
+void ring_stop(void)
+{ PUT(reader.stopped,TRUE);
+}
@@ -0,0 +1,46 @@
+/****************************************************/
+/* File: ring.h                                     */
+/* Token ring for the C- compiler: a lock-free      */
+/* queue from one scanner thread to one parser      */
+/* thread                                           */
+/****************************************************/
+
+#ifndef _RING_H_
+#define _RING_H_
+
+/* RINGSIZE is the number of tokens the ring holds,
+ * a power of 2, and RINGTEXT the number of bytes of
+ * their lexemes
+ */
+#define RINGSIZE 4096
+#define RINGTEXT (16 * RINGSIZE)
+
+/* a token as the scanner found it */
+typedef struct
+{ int token;
+  int line;
+  int text;    /* lexeme offset in the text ring, or -1 */
+} TokenRec;
+
+/* Procedure ring_start empties the ring */
+void ring_start(void);
+
+/* Function ring_put adds a token, text being the
+ * lexeme of an ID or NUM or else NULL. It waits while
+ * the ring is full and returns FALSE once the reader
+ * has called ring_stop
+ */
+int ring_put(TokenType token, char * text, int line);
+
+/* Function ring_get waits for the next token and
+ * copies its lexeme, if any, to text, which has room
+ * for STRINGSIZE bytes
+ */
+TokenRec ring_get(char * text);
+
+/* Procedure ring_stop tells the writer that no more
+ * tokens will be read
+ */
+void ring_stop(void);
+
+#endif
@@ -19,4 +19,9 @@ extern char tokenString[MAXTOKENLEN+1];
  */
 TokenType getToken(void);
 
+/* Procedure initParser points the scanner at the
+ * start of source
+ */
+void initParser(void);
+
 #endif
@@ -0,0 +1,379 @@
+/****************************************************/
+/* File: server.c                                   */
+/* Compiler server for the C- compiler              */
+/* Each open document keeps its text, its analyzed  */
+/* tree and the diagnostics and symbol listing of   */
+/* its last analysis, so that queries are answered  */
+/* without compiling again and an update costs a    */
+/* parse and analysis of the document only.         */
+/****************************************************/
+
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "parse.h"
+#include "analyze.h"
+#include "server.h"
+
+/* an open document */
+typedef struct DocRec
+{ char * name;
+  char * text;
+  int len;
+  TreeNode * tree;      /* NULL after a syntax error */
+  char * diagnostics;
+  char * symbols;
+  struct DocRec * next;
+} * Doc;
+
+static Doc docs = NULL;
+static int ndocs = 0;
+
+/* the requests, in the order of commandName */
+#define C_OPEN 0
+#define C_CHANGE 1
+#define C_DIAGNOSTICS 2
+#define C_SYMBOLS 3
+#define C_REFERENCES 4
+#define C_CLOSE 5
+#define C_STATS 6
+#define C_SHUTDOWN 7
+#define NCOMMANDS 8
+
+static char * commandName[NCOMMANDS] =
+  { "open", "change", "diagnostics", "symbols", "references", "close", "stats", "shutdown" };
+
+/* latencies by request, in microseconds */
+static long ncalls[NCOMMANDS];
+static double totalUsec[NCOMMANDS], maxUsec[NCOMMANDS];
+static long nanalyses = 0;
+static double analysisUsec = 0;
+
+/* the answer being built */
+static FILE * answer;
+static char * answerText;
+static size_t answerSize;
+
+/* the nodes of a tree in preorder, for references */
+static TreeNode ** nodes = NULL;
+static int nnodes = 0, maxnodes = 0;
+
+static double now(void)
+{ struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static Doc findDoc(char * name)
+{ Doc d;
+  for (d = docs; d != NULL; d = d->next)
+    if (strcmp(d->name,name) == 0) return d;
+  return NULL;
+}
+
+/* Function isRow is TRUE if line belongs to the
+ * symbol table listing
+ */
+static int isRow(char * line)
+{ if (strncmp(line,"Scope ",6) == 0 || strncmp(line,"-----",5) == 0) return TRUE;
+  if (*line == '-') line++;
+  return isdigit((unsigned char) *line);
+}
+
+/* Procedure analyzeDoc parses and analyzes d, and
+ * splits the listing into diagnostics and symbols
+ */
+static void analyzeDoc(Doc d)
+{ FILE * diag, * syms;
+  char * out, * line, * end;
+  size_t size, diagSize, symSize;
+  double start = now();
+  if (d->tree != NULL) freeTree(d->tree);
+  free(d->diagnostics);
+  free(d->symbols);
+  source = d->len > 0 ? fmemopen(d->text,d->len,"r") : tmpfile();
+  listing = open_memstream(&out,&size);
+  lineno = 1;
+  Error = FALSE;
+  initParser();
+  d->tree = parse();
+  if (! Error && d->tree != NULL) buildSymtab(d->tree);
+  fclose(listing);
+  fclose(source);
+  listing = stdout;
+  diag = open_memstream(&d->diagnostics,&diagSize);
+  syms = open_memstream(&d->symbols,&symSize);
+  for (line = out; *line; line = end) {
+    if ((end = strchr(line,'\n')) == NULL) end = line + strlen(line);
+    else end++;
+    if (isRow(line)) fwrite(line,1,end - line,syms);
+    else if (line[strspn(line," \t\n")] != '\0') fwrite(line,1,end - line,diag);
+  }
+  fclose(diag);
+  fclose(syms);
+  free(out);
+  nanalyses++;
+  analysisUsec += now() - start;
+}
+
+/* Function lineStart returns the offset of line n of
+ * d, or -1 if d has fewer lines; the line after the
+ * last is at the end of the text
+ */
+static int lineStart(Doc d, int n)
+{ int off = 0;
+  if (n < 1) return -1;
+  while (--n > 0) {
+    while (off < d->len && d->text[off] != '\n') off++;
+    if (off == d->len) return -1;
+    off++;
+  }
+  return off;
+}
+
+static void collect(TreeNode * t)
+{ int i;
+  while (t != NULL) {
+    if (nnodes == maxnodes) {
+      maxnodes = maxnodes ? 2 * maxnodes : 1024;
+      nodes = (TreeNode **) realloc(nodes, sizeof(TreeNode *) * maxnodes);
+    }
+    nodes[nnodes++] = t;
+    for (i = 0; i < MAXCHILDREN; i++) collect(t->child[i]);
+    t = t->sibling;
+  }
+}
+
+/* Procedure references answers with each declaration
+ * of name, "decl LINE SCOPE", followed by the lines
+ * referring to it, "ref LINE"; uses of an undeclared
+ * name come under "decl 0 -2"
+ */
+static void references(Doc d, char * name)
+{ TreeNode ** decls;
+  TreeNode * t;
+  int ndecls = 0, k, j;
+  nnodes = 0;
+  collect(d->tree);
+  decls = (TreeNode **) malloc(sizeof(TreeNode *) * (nnodes + 1));
+  for (k = 0; k < nnodes; k++) {
+    t = nodes[k];
+    if (t->nodekind == DeclK) {
+      if (t->kind == paramK && arraySize(t) < 0) continue;
+    }
+    else if (!(t->nodekind == ExpK && t->kind == IdK) &&
+             !(t->nodekind == StmtK && t->kind == CallK))
+      continue;
+    if (strcmp(t->attr.name,name) != 0) continue;
+    if (t->nodekind != DeclK) t = t->decl;
+    for (j = 0; j < ndecls && decls[j] != t; j++)
+      ;
+    if (j == ndecls) decls[ndecls++] = t;
+  }
+  for (j = 0; j < ndecls; j++) {
+    if (decls[j] == NULL) fprintf(answer,"decl 0 -2\n");
+    else fprintf(answer,"decl %d %d\n",decls[j]->lineno,decls[j]->scope);
+    for (k = 0; k < nnodes; k++) {
+      t = nodes[k];
+      if (((t->nodekind == ExpK && t->kind == IdK) ||
+           (t->nodekind == StmtK && t->kind == CallK)) &&
+          t->decl == decls[j] && (decls[j] != NULL || strcmp(t->attr.name,name) == 0))
+        fprintf(answer,"ref %d\n",t->lineno);
+    }
+  }
+  free(decls);
+}
+
+static void stats(void)
+{ int c;
+  fprintf(answer,"request      count   mean us    max us\n");
+  for (c = 0; c < NCOMMANDS; c++)
+    if (ncalls[c] > 0)
+      fprintf(answer,"%-12s %5ld %9.0f %9.0f\n",commandName[c],ncalls[c],
+              totalUsec[c] / ncalls[c],maxUsec[c]);
+  fprintf(answer,"documents %d, analyses %ld, %.0f us each\n",ndocs,nanalyses,
+          nanalyses ? analysisUsec / nanalyses : 0.0);
+}
+
+/* Function readText reads the len bytes following a
+ * request; it returns NULL if they are not there
+ */
+static char * readText(FILE * in, int len)
+{ char * text;
+  if (len < 0 || len > MAXDOCSIZE) return NULL;
+  text = (char *) malloc(len + 1);
+  if ((int) fread(text,1,len,in) != len) {
+    free(text);
+    return NULL;
+  }
+  text[len] = '\0';
+  return text;
+}
+
+/* Function bad answers with the message of a bad
+ * request and returns FALSE
+ */
+static int bad(char * fmt, ...)
+{ va_list ap;
+  va_start(ap,fmt);
+  vfprintf(answer,fmt,ap);
+  va_end(ap);
+  return FALSE;
+}
+
+/* Function request answers the request of line, with
+ * text read from in if it has any. It returns FALSE
+ * for a bad request, the answer being the message
+ */
+static int request(char * line, FILE * in, int * command)
+{ char name[256], id[STRINGSIZE], word[16];
+  char * text, * edited;
+  int len, first, last, a, b;
+  Doc d;
+  *command = NCOMMANDS;
+  if (sscanf(line,"%15s",word) != 1) return bad("empty request\n");
+  for (*command = 0; *command < NCOMMANDS; (*command)++)
+    if (strcmp(word,commandName[*command]) == 0) break;
+  switch (*command) {
+  case C_OPEN:
+    if (sscanf(line,"%*s %255s %d",name,&len) != 2 || (text = readText(in,len)) == NULL)
+      return bad("usage: open NAME LEN\n");
+    if ((d = findDoc(name)) == NULL) {
+      d = (Doc) calloc(1, sizeof(struct DocRec));
+      d->name = copyString(name);
+      d->next = docs;
+      docs = d;
+      ndocs++;
+    }
+    else free(d->text);
+    d->text = text;
+    d->len = len;
+    analyzeDoc(d);
+    fputs(d->diagnostics,answer);
+    return TRUE;
+  case C_CHANGE:
+    if (sscanf(line,"%*s %255s %d %d %d",name,&first,&last,&len) != 4 ||
+        (text = readText(in,len)) == NULL)
+      return bad("usage: change NAME FIRST LAST LEN\n");
+    if ((d = findDoc(name)) == NULL) {
+      free(text);
+      return bad("%s is not open\n",name);
+    }
+    if (last < first - 1 || (a = lineStart(d,first)) < 0 || (b = lineStart(d,last + 1)) < 0) {
+      free(text);
+      return bad("no lines %d to %d in %s\n",first,last,name);
+    }
+    edited = (char *) malloc(d->len - (b - a) + len + 1);
+    memcpy(edited,d->text,a);
+    memcpy(edited + a,text,len);
+    memcpy(edited + a + len,d->text + b,d->len - b);
+    d->len += len - (b - a);
+    edited[d->len] = '\0';
+    free(d->text);
+    free(text);
+    d->text = edited;
+    analyzeDoc(d);
+    fputs(d->diagnostics,answer);
+    return TRUE;
+  case C_DIAGNOSTICS:
+  case C_SYMBOLS:
+  case C_REFERENCES:
+  case C_CLOSE:
+    if (*command == C_REFERENCES ? sscanf(line,"%*s %255s %49s",name,id) != 2
+                                 : sscanf(line,"%*s %255s",name) != 1)
+      return bad("usage: %s NAME%s\n",word,*command == C_REFERENCES ? " ID" : "");
+    if ((d = findDoc(name)) == NULL)
+      return bad("%s is not open\n",name);
+    if (*command == C_DIAGNOSTICS) fputs(d->diagnostics,answer);
+    else if (*command == C_SYMBOLS) fputs(d->symbols,answer);
+    else if (*command == C_REFERENCES) references(d,id);
+    else {
+      Doc * p;
+      for (p = &docs; *p != d; p = &(*p)->next)
+        ;
+      *p = d->next;
+      if (d->tree != NULL) freeTree(d->tree);
+      free(d->name);
+      free(d->text);
+      free(d->diagnostics);
+      free(d->symbols);
+      free(d);
+      ndocs--;
+    }
+    return TRUE;
+  case C_STATS:
+    stats();
+    return TRUE;
+  case C_SHUTDOWN:
+    return TRUE;
+  }
+  return bad("unknown request %s\n",word);
+}
+
+/* Function session answers the requests of one
+ * connection. It returns FALSE after a shutdown
+ */
+static int session(int fd)
+{ FILE * in = fdopen(fd,"r");
+  FILE * out = fdopen(dup(fd),"w");
+  char line[1024];
+  int ok = FALSE, command = NCOMMANDS;
+  double start, usec;
+  while (fgets(line,sizeof(line),in) != NULL) {
+    start = now();
+    answer = open_memstream(&answerText,&answerSize);
+    ok = request(line,in,&command);
+    fclose(answer);
+    usec = now() - start;
+    if (command < NCOMMANDS) {
+      ncalls[command]++;
+      totalUsec[command] += usec;
+      if (usec > maxUsec[command]) maxUsec[command] = usec;
+    }
+    fprintf(out,"%s %lu %.0f\n",ok ? "ok" : "error",(unsigned long) answerSize,usec);
+    fwrite(answerText,1,answerSize,out);
+    fflush(out);
+    free(answerText);
+    if (ok && command == C_SHUTDOWN) break;
+  }
+  fclose(in);
+  fclose(out);
+  return !(ok && command == C_SHUTDOWN);
+}
+
+void serve(char * path)
+{ struct sockaddr_un addr;
+  struct stat st;
+  int fd, client, ok = TRUE;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr,"Socket path %s is too long\n",path);
+    exit(1);
+  }
+  /* a socket left by an earlier server goes */
+  if (stat(path,&st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path,path);
+  if ((fd = socket(AF_UNIX,SOCK_STREAM,0)) < 0 ||
+      bind(fd,(struct sockaddr *) &addr,sizeof(addr)) < 0 || listen(fd,8) < 0) {
+    fprintf(stderr,"Unable to listen on %s\n",path);
+    exit(1);
+  }
+  signal(SIGPIPE,SIG_IGN);
+  TraceAnalyze = TRUE;
+  Incremental = FALSE;
+  listing = stdout;
+  do {
+    if ((client = accept(fd,NULL,NULL)) < 0) continue;
+    ok = session(client);
+  } while (ok);
+  close(fd);
+  unlink(path);
+}
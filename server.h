@@ -0,0 +1,40 @@
+/****************************************************/
+/* File: server.h                                   */
+/* Compiler server interface for the C- compiler:   */
+/* editors keep one process running and send it     */
+/* the documents they edit over a Unix socket       */
+/****************************************************/
+
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+/* MAXDOCSIZE bounds the text of a document */
+#define MAXDOCSIZE (64 * 1024 * 1024)
+
+/* Procedure serve listens on the Unix socket path
+ * and answers requests, one connection at a time,
+ * until a shutdown request. A request is one line,
+ * followed by text for open and change:
+ *
+ *   open NAME LEN          the document is the LEN
+ *                          bytes that follow
+ *   change NAME FIRST LAST LEN
+ *                          lines FIRST to LAST of
+ *                          the document are replaced
+ *                          by the LEN bytes that follow
+ *                          (LAST = FIRST-1 inserts)
+ *   diagnostics NAME       syntax and type errors
+ *   symbols NAME           the symbol table listing
+ *   references NAME ID     the declarations of ID and
+ *                          the lines referring to each
+ *   close NAME
+ *   stats                  request counts and latencies
+ *   shutdown
+ *
+ * open and change answer with the diagnostics. Each
+ * answer is a line "ok LEN USEC" or "error LEN USEC",
+ * USEC being the time taken, followed by LEN bytes
+ */
+void serve(char * path);
+
+#endif
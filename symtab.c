@@ -13,6 +13,7 @@
 #include "globals.h"
 #include "symtab.h"
 #include "util.h"
+#include "incr.h"
 
 /* Procedure st_insert inserts line numbers and
  * memory locations into the symbol table
@@ -38,9 +39,10 @@ void st_insert( TreeNode *t, int loc, int addflag )
 
       l->tnode_p = t;
       l->lines->next = NULL;
+      l->last = l->lines;
       l->next = hashTable[h];
 
-      if(t->kind.decl == funK){
+      if(t->kind == funK){
 	if(t->child[0]->type == Void){
 	  t->type = Void;
 	}
@@ -49,8 +51,8 @@ void st_insert( TreeNode *t, int loc, int addflag )
 	}
 
 	//if(t->child[1]->type == Void){
-	if(t->child[1]->array_size == -1){//void
-	  t->paramnum = 0;
+	if(arraySize(t->child[1]) == -1){//void
+	  declInfo(t)->paramnum = 0;
 	}
 	else{
 	  tmp = 0;
@@ -59,19 +61,19 @@ void st_insert( TreeNode *t, int loc, int addflag )
 	    tmp++;
 	    s = s->sibling;
 	  }
-	  t->paramnum = tmp;
+	  declInfo(t)->paramnum = tmp;
 	}
       }
       else{
-	t->paramnum = -1;
+	declInfo(t)->paramnum = -1;
       }
       hashTable[h] = l;
     } else /* found in table, so just add line number */
-    { LineList ll = l->lines;
-      while (ll->next != NULL) ll = ll->next;
+    { LineList ll = l->last;
       ll->next = (LineList) malloc(sizeof(struct LineListRec));
       ll->next->lineno = t->lineno;
       ll->next->next = NULL;
+      l->last = ll->next;
     }
 } /* st_insert */
 
@@ -85,7 +87,7 @@ void st_delete ( int scope ) {
       hashTable[i] = l->next;
       fprintf(listing,"%-5d  %-14s %-8d ",l->scope,l->name,l->memloc);
       //if(l->tnode_p->paramnum != -1){//function
-      if(l->tnode_p->kind.decl == funK){
+      if(l->tnode_p->kind == funK){
 	if(l->tnode_p->child[0]->type == Void){
 	  fprintf(listing,"%-5s ","void");
 	}
@@ -94,16 +96,16 @@ void st_delete ( int scope ) {
 	}
 	fprintf(listing,"%-4s %-9d %-4s %-7s  ","no",0,"yes","no");
       }
-      else if(l->tnode_p->kind.decl == paramK){
-	if(l->tnode_p->array_size > 0){//array
-	  fprintf(listing,"%-5s %-4s %-9d %-4s %-7s  ","int","yes",l->tnode_p->array_size,"no","yes");
+      else if(l->tnode_p->kind == paramK){
+	if(arraySize(l->tnode_p) > 0){//array
+	  fprintf(listing,"%-5s %-4s %-9d %-4s %-7s  ","int","yes",arraySize(l->tnode_p),"no","yes");
 	}
 	else{
 	  fprintf(listing,"%-5s %-4s %-9d %-4s %-7s  ","int","no",0,"no","yes");
 	}
       }
-      else if(l->tnode_p->array_size > 0){//array
-	fprintf(listing,"%-5s %-4s %-9d %-4s %-7s  ","int","yes",l->tnode_p->array_size,"no","no");
+      else if(arraySize(l->tnode_p) > 0){//array
+	fprintf(listing,"%-5s %-4s %-9d %-4s %-7s  ","int","yes",arraySize(l->tnode_p),"no","no");
       }
       else{
 	fprintf(listing,"%-5s %-4s %-9d %-4s %-7s  ","int","no",0,"no","no");
@@ -112,7 +114,8 @@ void st_delete ( int scope ) {
       LineList t = l->lines;
       while(t != NULL) {
 	LineList next = t->next;
-	fprintf(listing,"%4d ",t->lineno);
+	listLine(t->lineno,4);
+	fprintf(listing," ");
 	free(t);
 	t = next;
       }
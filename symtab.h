@@ -44,6 +44,7 @@ typedef struct LineListRec
 typedef struct BucketListRec
 { char * name;
   LineList lines;
+  LineList last; /* end of lines, where uses are added */
   int scope;
   TreeNode *tnode_p;
   int memloc ; /* memory location for variable */
@@ -0,0 +1,39 @@
+/* branch kernel: a rarely taken if and a short
+   counted loop inside a loop of 3000000 iterations;
+   build with -C, run, then build with -R */
+int a[100];
+
+int sumn(int v[], int n) {
+  int i;
+  int s;
+  i = 0;
+  s = 0;
+  while (i < n) {
+    s = s + v[i];
+    i = i + 1;
+  }
+  return s;
+}
+
+void main(void) {
+  int i;
+  int t;
+  i = 0;
+  while (i < 100) {
+    a[i] = i;
+    i = i + 1;
+  }
+  i = 0;
+  t = 0;
+  while (i < 3000000) {
+    if (i - (i / 1000) * 1000 == 7) {
+      t = t + i / 1000;
+      t = t - a[i / 30000];
+    }
+    else
+      t = t + 1;
+    t = t + sumn(a, 3);
+    i = i + 1;
+  }
+  output(t);
+}
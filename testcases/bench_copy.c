@@ -0,0 +1,30 @@
+/* array-copy kernel: copies a 1000 element
+   array back and forth 200000 times */
+int a[1000];
+int b[1000];
+
+void copy(int d[], int s[], int n) {
+  int i;
+  i = 0;
+  while (i < n) {
+    d[i] = s[i];
+    i = i + 1;
+  }
+}
+
+void main(void) {
+  int i;
+  int r;
+  i = 0;
+  while (i < 1000) {
+    a[i] = i;
+    i = i + 1;
+  }
+  r = 0;
+  while (r < 200000) {
+    copy(b, a, 1000);
+    copy(a, b, 1000);
+    r = r + 1;
+  }
+  output(a[999] + b[500]);
+}
@@ -0,0 +1,33 @@
+/* array-sum kernel: adds up a 1000 element
+   array 200000 times */
+int a[1000];
+
+int sum(int v[], int n) {
+  int i;
+  int s;
+  i = 0;
+  s = 0;
+  while (i < n) {
+    s = s + v[i];
+    i = i + 1;
+  }
+  return s;
+}
+
+void main(void) {
+  int i;
+  int r;
+  int t;
+  i = 0;
+  while (i < 1000) {
+    a[i] = i;
+    i = i + 1;
+  }
+  r = 0;
+  t = 0;
+  while (r < 200000) {
+    t = t + sum(a, 1000) / 1000;
+    r = r + 1;
+  }
+  output(t);
+}
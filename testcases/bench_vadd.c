@@ -0,0 +1,31 @@
+/* vector-add kernel: adds two 1000 element
+   arrays into a third 200000 times */
+int a[1000];
+int b[1000];
+int c[1000];
+
+void vadd(int d[], int x[], int y[], int n) {
+  int i;
+  i = 0;
+  while (i < n) {
+    d[i] = x[i] + y[i];
+    i = i + 1;
+  }
+}
+
+void main(void) {
+  int i;
+  int r;
+  i = 0;
+  while (i < 1000) {
+    a[i] = i;
+    b[i] = 3 * i;
+    i = i + 1;
+  }
+  r = 0;
+  while (r < 200000) {
+    vadd(c, a, b, 1000);
+    r = r + 1;
+  }
+  output(c[999] + c[1]);
+}
@@ -0,0 +1,528 @@
+/****************************************************/
+/* File: unit.c                                     */
+/* Separate compilation for the C- compiler: the    */
+/* interface summaries of units, read and written   */
+/* in the format of unit.h, and the link step that  */
+/* resolves the symbols of each unit in the others  */
+/****************************************************/
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "unit.h"
+
+/* a symbol as a summary holds it */
+typedef struct
+{ char * name;
+  int kind;            /* varK or funK */
+  int returns;         /* TRUE if the function returns int */
+  int size;            /* array size, or number of parameters */
+  char * arrays;       /* per parameter, TRUE for an array */
+} Symbol;
+
+typedef struct
+{ char * file;         /* the summary */
+  char * source;
+  char * code;
+  int flags;
+  Symbol * exports;
+  int nexports;
+  Symbol * imports;
+  int nimports;
+} Unit;
+
+/* the declarations imported, in order */
+static TreeNode * imports = NULL;
+static TreeNode * lastImport = NULL;
+
+/********************************************/
+/* the summary written, built up in memory  */
+/********************************************/
+
+typedef struct
+{ char * text;
+  long len, max;
+} Buffer;
+
+static void putBytes(Buffer * b, char * p, long n)
+{ if (b->len + n > b->max) {
+    b->max = 2 * (b->len + n) + 256;
+    b->text = (char *) realloc(b->text, b->max);
+  }
+  memcpy(b->text + b->len,p,n);
+  b->len += n;
+}
+
+static void put8(Buffer * b, int v)
+{ char c = v;
+  putBytes(b,&c,1);
+}
+
+static void put32(Buffer * b, long v)
+{ int k;
+  for (k = 0; k < 4; k++) put8(b,(v >> (8 * k)) & 0xff);
+}
+
+static void putString(Buffer * b, char * s)
+{ int n = strlen(s);
+  put8(b,n & 0xff);
+  put8(b,(n >> 8) & 0xff);
+  putBytes(b,s,n);
+}
+
+/* Procedure putSymbol writes the declaration t */
+static void putSymbol(Buffer * b, TreeNode * t)
+{ TreeNode * p;
+  int n = 0;
+  putString(b,t->attr.name);
+  put8(b,t->kind == funK);
+  if (t->kind == varK) {
+    put8(b,TRUE);
+    put32(b,arraySize(t) > 0 ? arraySize(t) : 0);
+    return;
+  }
+  /* the type of t is only set by the analysis */
+  put8(b,t->child[0]->type != Void);
+  for (p = t->child[1]; p != NULL; p = p->sibling)
+    if (arraySize(p) >= 0) n++;
+  put32(b,n);
+  for (p = t->child[1]; p != NULL; p = p->sibling)
+    if (arraySize(p) >= 0) put8(b,arraySize(p) > 0);
+}
+
+/********************************************/
+/* the summaries read                       */
+/********************************************/
+
+typedef struct
+{ unsigned char * p;
+  unsigned char * end;
+  int ok;
+} Reader;
+
+static int get8(Reader * r)
+{ if (r->p >= r->end) {
+    r->ok = FALSE;
+    return 0;
+  }
+  return *r->p++;
+}
+
+static long get32(Reader * r)
+{ unsigned long v = 0;
+  int k;
+  for (k = 0; k < 4; k++) v |= (unsigned long) get8(r) << (8 * k);
+  return (long) v;
+}
+
+static char * getString(Reader * r)
+{ int n = get8(r);
+  char * s;
+  n |= get8(r) << 8;
+  if (!r->ok || n > r->end - r->p) {
+    r->ok = FALSE;
+    return copyString("");
+  }
+  s = (char *) malloc(n + 1);
+  memcpy(s,r->p,n);
+  s[n] = '\0';
+  r->p += n;
+  return s;
+}
+
+/* Function getSymbols reads a count and as many
+ * symbols, setting *n
+ */
+static Symbol * getSymbols(Reader * r, int * n)
+{ Symbol * s;
+  int k, j;
+  *n = get32(r);
+  /* a symbol takes eight bytes at least */
+  if (*n < 0 || *n > (r->end - r->p) / 8) {
+    r->ok = FALSE;
+    *n = 0;
+  }
+  s = (Symbol *) calloc(*n + 1, sizeof(Symbol));
+  for (k = 0; k < *n && r->ok; k++) {
+    s[k].name = getString(r);
+    s[k].kind = get8(r) ? funK : varK;
+    s[k].returns = get8(r);
+    s[k].size = get32(r);
+    if (s[k].kind == funK && (s[k].size < 0 || s[k].size > r->end - r->p)) {
+      r->ok = FALSE;
+      break;
+    }
+    if (s[k].kind == funK) {
+      s[k].arrays = (char *) malloc(s[k].size + 1);
+      for (j = 0; j < s[k].size; j++) s[k].arrays[j] = get8(r);
+    }
+  }
+  return s;
+}
+
+/* Function readUnit reads the summary file into u;
+ * it returns FALSE if it is not a whole summary
+ */
+static int readUnit(char * file, Unit * u)
+{ FILE * f = fopen(file,"rb");
+  unsigned char * text;
+  long len;
+  Reader r;
+  memset(u,0,sizeof(Unit));
+  u->file = file;
+  if (f == NULL) return FALSE;
+  fseek(f,0,SEEK_END);
+  len = ftell(f);
+  rewind(f);
+  text = (unsigned char *) malloc(len > 0 ? len : 1);
+  if (len < 0 || fread(text,1,len,f) != (size_t) len) len = 0;
+  fclose(f);
+  r.p = text;
+  r.end = text + len;
+  r.ok = len >= 4 && memcmp(text,UNITMAGIC,4) == 0;
+  if (r.ok) {
+    r.p += 4;
+    u->flags = get32(&r);
+    u->source = getString(&r);
+    u->code = getString(&r);
+    u->exports = getSymbols(&r,&u->nexports);
+    u->imports = getSymbols(&r,&u->nimports);
+    r.ok = r.ok && r.p == r.end;
+  }
+  free(text);
+  return r.ok;
+}
+
+/* Function sameSymbol returns TRUE if a and b are
+ * declared alike
+ */
+static int sameSymbol(Symbol * a, Symbol * b)
+{ return a->kind == b->kind && a->returns == b->returns && a->size == b->size &&
+         (a->kind == varK || memcmp(a->arrays,b->arrays,a->size) == 0);
+}
+
+/* Function declOf makes the declaration of the
+ * imported symbol s, as builtinFun of analyze.c does
+ */
+static TreeNode * declOf(Symbol * s)
+{ TreeNode * t = newDeclNode(s->kind);
+  TreeNode * p;
+  TreeNode * last = NULL;
+  int k;
+  t->attr.name = s->name;
+  t->child[0] = newExpNode(TypeK);
+  t->child[0]->type = s->returns ? Integer : Void;
+  t->type = t->child[0]->type;
+  t->flags = F_EXTERN;
+  if (s->kind == varK) {
+    declInfo(t)->array_size = s->size;
+    return t;
+  }
+  if (s->size == 0) {
+    t->child[1] = newDeclNode(paramK);
+    declInfo(t->child[1])->array_size = -1;
+    t->child[1]->type = Void;
+  }
+  for (k = 0; k < s->size; k++) {
+    p = newDeclNode(paramK);
+    p->attr.name = "x";
+    p->child[0] = newExpNode(TypeK);
+    p->child[0]->type = Integer;
+    p->type = Integer;
+    declInfo(p)->array_size = s->arrays[k] ? 1 : 0;
+    if (last == NULL) t->child[1] = p;
+    else last->sibling = p;
+    last = p;
+  }
+  return t;
+}
+
+int unitImport(char * file)
+{ Unit u;
+  TreeNode * t;
+  BucketList l;
+  int k;
+  if (!readUnit(file,&u)) return FALSE;
+  for (k = 0; k < u.nexports; k++) {
+    l = st_type_lookup(u.exports[k].name);
+    if (l != NULL && (l->tnode_p->flags & F_EXTERN)) {
+      fprintf(listing,"Import error: %s of %s is imported already\n",u.exports[k].name,file);
+      return FALSE;
+    }
+    t = declOf(&u.exports[k]);
+    /* listed nowhere, but global to the backends */
+    t->scope = -1;
+    st_insert(t, 0, 1);
+    t->scope = 0;
+    if (lastImport == NULL) imports = t;
+    else lastImport->sibling = t;
+    lastImport = t;
+  }
+  return TRUE;
+}
+
+TreeNode * unitImports(void)
+{ return imports; }
+
+/* Procedure markLinked marks (F_LINKED) the imports
+ * referred to in the tree t
+ */
+static void markLinked(TreeNode * t)
+{ int i;
+  while (t != NULL) {
+    if (t->decl != NULL && (t->decl->flags & F_EXTERN)) t->decl->flags |= F_LINKED;
+    for (i = 0; i < MAXCHILDREN; i++) markLinked(t->child[i]);
+    t = t->sibling;
+  }
+}
+
+int unitExport(TreeNode * syntaxTree, char * pgm, char * file, char * codefile)
+{ Buffer b;
+  TreeNode * t;
+  FILE * f;
+  char * old;
+  char * tmp;
+  long len, nexports = 0, nimports = 0;
+  int flags = 0, same, ok;
+  b.text = NULL;
+  b.len = b.max = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && (t->kind == varK || t->kind == funK)) {
+      nexports++;
+      if (t->kind == funK && strcmp(t->attr.name,"main") == 0) flags |= UNITMAIN;
+    }
+  markLinked(syntaxTree);
+  for (t = imports; t != NULL; t = t->sibling)
+    if (t->flags & F_LINKED) nimports++;
+  putBytes(&b,UNITMAGIC,4);
+  put32(&b,flags);
+  putString(&b,pgm);
+  putString(&b,codefile != NULL ? codefile : "");
+  put32(&b,nexports);
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && (t->kind == varK || t->kind == funK)) putSymbol(&b,t);
+  put32(&b,nimports);
+  for (t = imports; t != NULL; t = t->sibling)
+    if (t->flags & F_LINKED) putSymbol(&b,t);
+  /* the summary is compared with the one there */
+  same = FALSE;
+  f = fopen(file,"rb");
+  if (f != NULL) {
+    old = (char *) malloc(b.len + 1);
+    len = fread(old,1,b.len + 1,f);
+    same = len == b.len && memcmp(old,b.text,len) == 0;
+    free(old);
+    fclose(f);
+  }
+  /* units compiled at the same time may be reading
+   * it, so it is replaced whole */
+  if (!same) {
+    tmp = (char *) malloc(strlen(file) + 32);
+    sprintf(tmp,"%s.%ld.tmp",file,(long) getpid());
+    f = fopen(tmp,"wb");
+    ok = f != NULL && fwrite(b.text,1,b.len,f) == (size_t) b.len;
+    if (f != NULL && fclose(f) != 0) ok = FALSE;
+    if (ok && rename(tmp,file) != 0) ok = FALSE;
+    if (!ok) remove(tmp);
+    free(tmp);
+    if (!ok) {
+      free(b.text);
+      return FALSE;
+    }
+  }
+  fprintf(listing,"Interface %s: %ld exports, %ld imports%s\n",
+          file,nexports,nimports,same ? ", unchanged" : "");
+  free(b.text);
+  return TRUE;
+}
+
+/********************************************/
+/* the link step                            */
+/********************************************/
+
+#define LINKSLOTS 4093
+
+/* an exported symbol and the unit defining it */
+typedef struct ExportRec
+{ Symbol * sym;
+  Unit * unit;
+  struct ExportRec * next;
+} * Export;
+
+static Export exportTable[LINKSLOTS];
+
+static int linkHash(char * name)
+{ unsigned h = 0;
+  while (*name) h = h * 31 + (unsigned char) *name++;
+  return h % LINKSLOTS;
+}
+
+static Export findExport(char * name)
+{ Export e;
+  for (e = exportTable[linkHash(name)]; e != NULL; e = e->next)
+    if (strcmp(e->sym->name,name) == 0) return e;
+  return NULL;
+}
+
+static void linkError(void)
+{ fprintf(listing,"Link error: ");
+  Error = TRUE;
+}
+
+/* Function startCommand prints and starts argv,
+ * returning its process or -1
+ */
+static pid_t startCommand(char ** argv)
+{ pid_t pid;
+  int k;
+  for (k = 0; argv[k] != NULL; k++) fprintf(listing,k ? " %s" : "%s",argv[k]);
+  fprintf(listing,"\n");
+  fflush(listing);
+  pid = fork();
+  if (pid == 0) {
+    execvp(argv[0],argv);
+    _exit(127);
+  }
+  return pid;
+}
+
+/* Function stale returns TRUE if the file made
+ * from code is missing or older than it
+ */
+static int stale(char * made, char * code)
+{ struct stat m, c;
+  if (stat(made,&m) != 0 || stat(code,&c) != 0) return TRUE;
+  return m.st_mtim.tv_sec < c.st_mtim.tv_sec ||
+         (m.st_mtim.tv_sec == c.st_mtim.tv_sec && m.st_mtim.tv_nsec < c.st_mtim.tv_nsec);
+}
+
+/* Function objName returns the name of the object
+ * file made from the code file code
+ */
+static char * objName(char * code)
+{ int n = strlen(code);
+  char * obj = (char *) malloc(n + 3);
+  strcpy(obj,code);
+  if (n > 6 && strcmp(code + n - 6,".gen.c") == 0) n -= 6;
+  else if (n > 2 && strcmp(code + n - 2,".s") == 0) n -= 2;
+  strcpy(obj + n,".o");
+  return obj;
+}
+
+/* Function runCompiler hands the code files of the
+ * n units u to the C compiler to make prog. The
+ * object file of a unit is kept next to its code
+ * and made again only when the code is newer, up to
+ * one per core at a time, so a program of which one
+ * unit was rebuilt is only relinked
+ */
+static int runCompiler(char * prog, Unit * u, int n)
+{ char * cc = getenv("CC") != NULL ? getenv("CC") : "cc";
+  char ** argv = (char **) malloc(sizeof(char *) * (n + 7));
+  char ** objs = (char **) malloc(sizeof(char *) * n);
+  int k, running = 0, failed = FALSE, status;
+  int cores = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+  pid_t pid;
+  for (k = 0; k < n; k++) objs[k] = objName(u[k].code);
+  for (k = 0; k < n && !failed; k++) {
+    if (!stale(objs[k],u[k].code)) continue;
+    if (running >= cores) {
+      if (wait(&status) < 0 || status != 0) failed = TRUE;
+      running--;
+    }
+    argv[0] = cc;
+    argv[1] = "-O2";
+    argv[2] = "-c";
+    argv[3] = "-o";
+    argv[4] = objs[k];
+    argv[5] = u[k].code;
+    argv[6] = NULL;
+    if (startCommand(argv) < 0) failed = TRUE;
+    else running++;
+  }
+  for (; running > 0; running--)
+    if (wait(&status) < 0 || status != 0) failed = TRUE;
+  if (!failed) {
+    argv[0] = cc;
+    argv[1] = "-o";
+    argv[2] = prog;
+    for (k = 0; k < n; k++) argv[k + 3] = objs[k];
+    argv[n + 3] = NULL;
+    pid = startCommand(argv);
+    if (pid < 0 || waitpid(pid,&status,0) != pid || status != 0) failed = TRUE;
+  }
+  for (k = 0; k < n; k++) free(objs[k]);
+  free(objs);
+  free(argv);
+  if (failed) {
+    linkError();
+    fprintf(listing,"the C compiler failed\n");
+    return FALSE;
+  }
+  return TRUE;
+}
+
+int unitLink(char * prog, char ** files, int nfiles)
+{ Unit * units = (Unit *) calloc(nfiles, sizeof(Unit));
+  Unit * mainUnit = NULL;
+  Unit * u;
+  Symbol * s;
+  Export e;
+  int k, j, resolved = 0;
+  fprintf(listing,"Linking %d units into %s\n",nfiles,prog);
+  for (k = 0; k < nfiles; k++) {
+    u = &units[k];
+    if (!readUnit(files[k],u)) {
+      linkError();
+      fprintf(listing,"%s is not an interface summary\n",files[k]);
+      continue;
+    }
+    if (*u->code == '\0' || access(u->code,R_OK) != 0) {
+      linkError();
+      fprintf(listing,"%s has no code; compile it with -e and -S or -c\n",u->source);
+    }
+    /* a second main is defined twice, as below */
+    if (u->flags & UNITMAIN) mainUnit = u;
+    for (j = 0; j < u->nexports; j++) {
+      s = &u->exports[j];
+      if ((e = findExport(s->name)) != NULL) {
+        linkError();
+        fprintf(listing,"%s is defined in %s and %s\n",s->name,e->unit->source,u->source);
+        continue;
+      }
+      e = (Export) malloc(sizeof(struct ExportRec));
+      e->sym = s;
+      e->unit = u;
+      e->next = exportTable[linkHash(s->name)];
+      exportTable[linkHash(s->name)] = e;
+    }
+  }
+  if (mainUnit == NULL && !Error) {
+    linkError();
+    fprintf(listing,"no unit defines main\n");
+  }
+  /* every import must be what it was when the
+   * unit importing it was compiled */
+  for (k = 0; k < nfiles && !Error; k++) {
+    u = &units[k];
+    for (j = 0; j < u->nimports; j++) {
+      s = &u->imports[j];
+      if ((e = findExport(s->name)) == NULL) {
+        linkError();
+        fprintf(listing,"%s, imported by %s, is not defined\n",s->name,u->source);
+      }
+      else if (!sameSymbol(s,e->sym)) {
+        linkError();
+        fprintf(listing,"%s has changed in %s since %s was compiled\n",
+                s->name,e->unit->source,u->source);
+      }
+      else if (e->unit != u) resolved++;
+    }
+  }
+  if (Error) return FALSE;
+  fprintf(listing,"Symbols resolved across units: %d\n",resolved);
+  return runCompiler(prog,units,nfiles);
+}
@@ -0,0 +1,67 @@
+/****************************************************/
+/* File: unit.h                                     */
+/* Separate compilation for the C- compiler: a unit */
+/* writes a summary of its interface that other     */
+/* units import instead of its source, and the      */
+/* summaries are checked against each other when    */
+/* the units are linked into a program              */
+/****************************************************/
+
+#ifndef _UNIT_H_
+#define _UNIT_H_
+
+/* An interface summary (<name>.cmi) is binary, the
+ * numbers 4 bytes little-endian and a string a 2
+ * byte length and its bytes:
+ *
+ *   "CMI1"  flags (1: the unit defines main)
+ *   source  code (the .s or .gen.c file, or "")
+ *   n  n exported symbols
+ *   n  n imported symbols the unit refers to, as
+ *      they were imported (none if only parsed)
+ *
+ * and a symbol is its name, a byte 0 for a variable
+ * or 1 for a function, a byte 1 if the function
+ * returns int, the array size of the variable or the
+ * number of parameters of the function, then for a
+ * function a byte per parameter, 1 for an array
+ */
+#define UNITMAGIC "CMI1"
+#define UNITMAIN 1
+
+/* Function unitImport reads the summary file and
+ * declares what it exports (F_EXTERN), below the
+ * global scope as the predefined functions are;
+ * it returns FALSE if the file cannot be read or
+ * declares a name imported already
+ */
+int unitImport(char * file);
+
+/* Function unitImports returns the declarations
+ * imported, linked through sibling
+ */
+TreeNode * unitImports(void);
+
+/* Function unitExport writes the summary file of the
+ * program syntaxTree from source pgm, parsed or
+ * analyzed, whose code is in codefile (NULL if
+ * none). It is replaced whole, and a summary that
+ * would not change is not written again, so what
+ * depends on it need not be rebuilt; it returns
+ * FALSE if the file cannot be written
+ */
+int unitExport(TreeNode * syntaxTree, char * pgm, char * file, char * codefile);
+
+/* Function unitLink links the units whose summaries
+ * are in files (nfiles of them) into the program
+ * prog: every import must be exported by exactly one
+ * unit as it was when imported, and one unit must
+ * define main. The code files are then compiled by
+ * the C compiler ($CC, or cc) into object files next
+ * to them, those not newer than their code being
+ * kept, and the objects linked. It returns FALSE on
+ * an error, which is printed to the listing
+ */
+int unitLink(char * prog, char ** files, int nfiles);
+
+#endif
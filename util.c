@@ -112,9 +112,14 @@ TreeNode * newStmtNode(StmtKind kind)
     for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
     t->sibling = NULL;
     t->nodekind = StmtK;
-    t->kind.stmt = kind;
+    t->kind = kind;
     t->lineno = lineno;
-		t->paramnum = -1;
+    t->attr.val = 0;
+    t->subscript = 0;
+    t->scope = 0;
+    t->type = Void;
+    t->flags = 0;
+    t->decl = NULL;
   }
   return t;
 }
@@ -131,10 +136,14 @@ TreeNode * newExpNode(ExpKind kind)
     for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
     t->sibling = NULL;
     t->nodekind = ExpK;
-    t->kind.exp = kind;
+    t->kind = kind;
     t->lineno = lineno;
+    t->attr.val = 0;
+    t->subscript = 0;
+    t->scope = 0;
     t->type = Void;
-		t->paramnum = -1;
+    t->flags = 0;
+    t->decl = NULL;
   }
   return t;
 }
@@ -143,7 +152,7 @@ TreeNode * newExpNode(ExpKind kind)
  * node for syntax tree construction
  */
 TreeNode * newDeclNode(DeclKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
+{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode) + sizeof(DeclInfo));
   int i;
   if (t==NULL)
     fprintf(listing,"Out of memory error at line %d\n",lineno);
@@ -151,9 +160,17 @@ TreeNode * newDeclNode(DeclKind kind)
     for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
     t->sibling = NULL;
     t->nodekind = DeclK;
-    t->kind.decl = kind;
+    t->kind = kind;
     t->lineno = lineno;
-		t->paramnum = -1;
+    t->attr.val = 0;
+    t->subscript = 0;
+    t->scope = 0;
+    t->type = Void;
+    t->flags = 0;
+    t->decl = NULL;
+    declInfo(t)->paramnum = -1;
+    declInfo(t)->array_size = 0;
+    declInfo(t)->offset = 0;
   }
   return t;
 }
@@ -173,6 +190,24 @@ char * copyString(char * s)
   return t;
 }
 
+/* Procedure freeTree releases a node list and all
+ * of its subtrees
+ */
+void freeTree( TreeNode * t )
+{ TreeNode * next;
+  int i;
+  while (t != NULL) {
+    for (i=0;i<MAXCHILDREN;i++) freeTree(t->child[i]);
+    if ((t->nodekind==DeclK && arraySize(t)!=-1) ||
+        (t->nodekind==ExpK && t->kind==IdK) ||
+        (t->nodekind==StmtK && t->kind==CallK))
+      free(t->attr.name);
+    next = t->sibling;
+    free(t);
+    t = next;
+  }
+}
+
 /* Variable indentno is used by printTree to
  * store current number of spaces to indent
  */
@@ -198,7 +233,7 @@ void printTree( TreeNode * tree )
   while (tree != NULL) {
     printSpaces();
     if (tree->nodekind==StmtK)
-    { switch (tree->kind.stmt) {
+    { switch (tree->kind) {
       case IfK:
         fprintf(listing,"If\n");
         break;
@@ -223,7 +258,7 @@ void printTree( TreeNode * tree )
       }
     }
     else if (tree->nodekind==ExpK)
-    { switch (tree->kind.exp) {
+    { switch (tree->kind) {
       case OpK:
         fprintf(listing,"Op: ");
         printToken(tree->attr.op,"\0");
@@ -249,10 +284,10 @@ void printTree( TreeNode * tree )
       }
     }
     else if (tree->nodekind==DeclK)
-      { switch (tree->kind.decl) {
+      { switch (tree->kind) {
         case varK :
-          if (tree->array_size)
-            fprintf(listing, "A Variable Declared: %s[%d]\n", tree->attr.name, tree->array_size);
+          if (arraySize(tree))
+            fprintf(listing, "A Variable Declared: %s[%d]\n", tree->attr.name, arraySize(tree));
           else {
             fprintf(listing, "A Variable Declared: %s\n", tree->attr.name);
           }
@@ -261,9 +296,9 @@ void printTree( TreeNode * tree )
           fprintf(listing, "Function Declared: %s\n", tree->attr.name);
           break;
         case paramK :
-          if (tree->array_size == -1)
+          if (arraySize(tree) == -1)
             fprintf(listing, "Void Parameter\n");
-          else if (tree->array_size == 0)
+          else if (arraySize(tree) == 0)
             fprintf(listing, "Parameter : %s\n", tree->attr.name);
           else
             fprintf(listing, "Parameter : %s[]\n", tree->attr.name);
@@ -288,3 +323,7 @@ void st_push(char *str) {
 char *st_pop() {
   return stack[top--];
 }
+
+void st_clear(void) {
+  top = 0;
+}
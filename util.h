@@ -26,6 +26,11 @@ TreeNode * newDeclNode(DeclKind);
  */
 char * copyString( char * );
 
+/* Procedure freeTree releases a node list and all
+ * of its subtrees
+ */
+void freeTree( TreeNode * );
+
 /* procedure printTree prints a syntax tree to the 
  * listing file using indentation to indicate subtrees
  */
@@ -34,4 +39,10 @@ void printTree( TreeNode * );
 void st_push(char *);
 char* st_pop();
 
+/* Procedure st_clear empties the stack of pushed
+ * names and numbers, which a syntax error can leave
+ * behind
+ */
+void st_clear(void);
+
 #endif